@@ -150,14 +150,37 @@ to exclude the API function. */
   }
 */
 
-// Queue monitoring
-#ifdef DEBUG_QUEUE_MONITOR
-    #undef traceQUEUE_SEND
-    #undef traceQUEUE_SEND_FAILED
-    #define traceQUEUE_SEND(xQueue) qm_traceQUEUE_SEND(xQueue)
-    void qm_traceQUEUE_SEND(void* xQueue);
-    #define traceQUEUE_SEND_FAILED(xQueue) qm_traceQUEUE_SEND_FAILED(xQueue)
-    void qm_traceQUEUE_SEND_FAILED(void* xQueue);
-#endif // DEBUG_QUEUE_MONITOR
+// Queue monitoring, see queuemonitor.h. Only queues registered in the queue
+// monitor have a non zero queue number.
+#define QM_QUEUE(xQueue) ((xQUEUE *) (xQueue))
+#define QM_TRACE_SEND(xQueue) \
+  if (QM_QUEUE(xQueue)->uxQueueNumber) { \
+    qm_traceQUEUE_SEND(QM_QUEUE(xQueue)->uxQueueNumber, QM_QUEUE(xQueue)->uxMessagesWaiting, QM_QUEUE(xQueue)->uxLength); \
+  }
+#define QM_TRACE(function, xQueue) \
+  if (QM_QUEUE(xQueue)->uxQueueNumber) { \
+    function(QM_QUEUE(xQueue)->uxQueueNumber); \
+  }
+
+#undef traceQUEUE_SEND
+#undef traceQUEUE_SEND_FAILED
+// FreeRTOS leaves the queue number of new queues and mutexes uninitialized
+#define traceQUEUE_CREATE(xQueue) QM_QUEUE(xQueue)->uxQueueNumber = 0
+#define traceCREATE_MUTEX(xQueue) QM_QUEUE(xQueue)->uxQueueNumber = 0
+#define traceQUEUE_SEND(xQueue) do { \
+    ITM_SEND(3, ITM_QUEUE_SEND | QM_QUEUE(xQueue)->uxQueueNumber); \
+    QM_TRACE_SEND(xQueue) \
+  } while (0)
+#define traceQUEUE_SEND_FROM_ISR(xQueue) do { QM_TRACE_SEND(xQueue) } while (0)
+#define traceQUEUE_SEND_FAILED(xQueue) do { \
+    ITM_SEND(3, ITM_QUEUE_FAILED | QM_QUEUE(xQueue)->uxQueueNumber); \
+    QM_TRACE(qm_traceQUEUE_SEND_FAILED, xQueue) \
+  } while (0)
+#define traceQUEUE_SEND_FROM_ISR_FAILED(xQueue) do { QM_TRACE(qm_traceQUEUE_SEND_FAILED, xQueue) } while (0)
+#define traceQUEUE_RECEIVE(xQueue) do { QM_TRACE(qm_traceQUEUE_RECEIVE, xQueue) } while (0)
+#define traceQUEUE_RECEIVE_FROM_ISR(xQueue) do { QM_TRACE(qm_traceQUEUE_RECEIVE, xQueue) } while (0)
+void qm_traceQUEUE_SEND(unsigned int queueNumber, unsigned int waiting, unsigned int length);
+void qm_traceQUEUE_SEND_FAILED(unsigned int queueNumber);
+void qm_traceQUEUE_RECEIVE(unsigned int queueNumber);
 
 #endif /* FREERTOS_CONFIG_H */
@@ -54,7 +54,16 @@
   #define CONFIG_BLOCK_ADDRESS    (2048 * (64-1))
   #define MCU_ID_ADDRESS          0x1FFF7A10
   #define MCU_FLASH_SIZE_ADDRESS  0x1FFF7A22
+#ifdef STATIC_MEM
+  // The stacks of the tasks that are always created are reserved in .bss
+  // instead: system, crtp tx/rx, log, mem, param, high level commander,
+  // stabilizer, pm, usblink and syslink, 16 minimal stacks of 4 byte words.
+  // Optional tasks and the uSD log buffers are reserved in .bss too but are
+  // not taken off the heap, they are not used in every configuration.
+  #define FREERTOS_HEAP_SIZE      (40000 - 16 * FREERTOS_MIN_STACK_SIZE * 4)
+#else
   #define FREERTOS_HEAP_SIZE      40000
+#endif
   #define FREERTOS_MIN_STACK_SIZE 150       // M4-FPU register setup is bigger so stack needs to be bigger
   #define FREERTOS_MCU_CLOCK_HZ   168000000
 
@@ -67,6 +76,8 @@
 // Task priorities. Higher number higher priority
 #define STABILIZER_TASK_PRI     5
 #define SENSORS_TASK_PRI        4
+// The outer stabilizer loops must not be delayed by the link and deck tasks
+#define STABILIZER_OUTER_TASK_PRI 4
 #define ADC_TASK_PRI            3
 #define FLOW_TASK_PRI           3
 #define MULTIRANGER_TASK_PRI    3
@@ -85,6 +96,8 @@
 #define USDWRITE_TASK_PRI       0
 #define PCA9685_TASK_PRI        3
 #define CMD_HIGH_LEVEL_TASK_PRI 2
+#define DYN_NOTCH_TASK_PRI      1
+#define BARO_TASK_PRI           1
 
 #define SYSLINK_TASK_PRI        3
 #define USBLINK_TASK_PRI        3
@@ -108,6 +121,7 @@
 #define PARAM_TASK_NAME         "PARAM"
 #define SENSORS_TASK_NAME       "SENSORS"
 #define STABILIZER_TASK_NAME    "STABILIZER"
+#define STABILIZER_OUTER_TASK_NAME "STABOUTER"
 #define NRF24LINK_TASK_NAME     "NRF24LINK"
 #define ESKYLINK_TASK_NAME      "ESKYLINK"
 #define SYSLINK_TASK_NAME       "SYSLINK"
@@ -123,6 +137,8 @@
 #define PCA9685_TASK_NAME       "PCA9685"
 #define CMD_HIGH_LEVEL_TASK_NAME "CMDHL"
 #define MULTIRANGER_TASK_NAME   "MR"
+#define DYN_NOTCH_TASK_NAME     "DYNNOTCH"
+#define BARO_TASK_NAME          "BARO"
 
 //Task stack sizes
 #define SYSTEM_TASK_STACKSIZE         (2* configMINIMAL_STACK_SIZE)
@@ -136,6 +152,7 @@
 #define PARAM_TASK_STACKSIZE          configMINIMAL_STACK_SIZE
 #define SENSORS_TASK_STACKSIZE        (2 * configMINIMAL_STACK_SIZE)
 #define STABILIZER_TASK_STACKSIZE     (3 * configMINIMAL_STACK_SIZE)
+#define STABILIZER_OUTER_TASK_STACKSIZE (3 * configMINIMAL_STACK_SIZE)
 #define NRF24LINK_TASK_STACKSIZE      configMINIMAL_STACK_SIZE
 #define ESKYLINK_TASK_STACKSIZE       configMINIMAL_STACK_SIZE
 #define SYSLINK_TASK_STACKSIZE        configMINIMAL_STACK_SIZE
@@ -151,6 +168,8 @@
 #define PCA9685_TASK_STACKSIZE        (2 * configMINIMAL_STACK_SIZE)
 #define CMD_HIGH_LEVEL_TASK_STACKSIZE configMINIMAL_STACK_SIZE
 #define MULTIRANGER_TASK_STACKSIZE    (2 * configMINIMAL_STACK_SIZE)
+#define DYN_NOTCH_TASK_STACKSIZE      (2 * configMINIMAL_STACK_SIZE)
+#define BARO_TASK_STACKSIZE           (2 * configMINIMAL_STACK_SIZE)
 
 //The radio channel. From 0 to 125
 #define RADIO_CHANNEL 80
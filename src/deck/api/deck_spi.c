@@ -36,6 +36,7 @@
 #include "cfassert.h"
 #include "config.h"
 #include "nvicconf.h"
+#include "irq_profile.h"
 
 #define SPI                           SPI1
 #define SPI_CLK                       RCC_APB2Periph_SPI1
@@ -269,6 +270,8 @@ void spiEndTransaction()
 
 void __attribute__((used)) SPI_TX_DMA_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
   // Stop and cleanup DMA stream
@@ -291,10 +294,14 @@ void __attribute__((used)) SPI_TX_DMA_IRQHandler(void)
   {
     portYIELD();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileDeckSpiTx);
 }
 
 void __attribute__((used)) SPI_RX_DMA_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
   // Stop and cleanup DMA stream
@@ -317,4 +324,6 @@ void __attribute__((used)) SPI_RX_DMA_IRQHandler(void)
   {
     portYIELD();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileDeckSpiRx);
 }
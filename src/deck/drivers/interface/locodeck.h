@@ -118,6 +118,15 @@ bool lpsGetLppShort(lpsLppShortPacket_t* shortPacket);
 uint16_t locoDeckGetRangingState();
 void locoDeckSetRangingState(const uint16_t newState);
 
+// Double buffered receive, the DW1000 keeps receiving into the second buffer
+// while the previous packet is read. Set by listening algorithms from init
+// (it is applied by dwCommitConfiguration), the driver swaps buffers after each
+// eventPacketReceived and reports receive overruns as eventReceiveFailed. The
+// algorithm must not re-arm the receiver after a received packet and must call
+// locoDeckSyncReceiveBuffers() between dwNewReceive() and dwStartReceive().
+void locoDeckSetDoubleBufferedReceive(dwDevice_t *dev, const bool enable);
+void locoDeckSyncReceiveBuffers(dwDevice_t *dev);
+
 // LPP Packet types and format
 #define LPP_HEADER_SHORT_PACKET 0xF0
 
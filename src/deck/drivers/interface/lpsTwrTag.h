@@ -10,6 +10,8 @@
 #define LPS_TWR_ANSWER 0x02
 #define LPS_TWR_FINAL 0x03
 #define LPS_TWR_REPORT 0x04 // Report contains all measurement from the anchor
+#define LPS_TWR_POLL_BROADCAST 0x05  // Poll to all anchors, answered in reply slots
+#define LPS_TWR_FINAL_BROADCAST 0x06 // Final to all anchors, carries the answer arrival times
 
 #define LPS_TWR_LPP_SHORT 0xF0
 
@@ -22,6 +24,26 @@
 
 #define LPS_TWR_SEND_LPP_PAYLOAD 1
 
+// Broadcast poll ranging
+//
+// The tag sends one POLL_BROADCAST listing the anchor ids (low byte of the
+// anchor address). The anchor at position i in the list sends its ANSWER at
+// pollRx + (i+1) * LPS_TWR_BROADCAST_SLOT_LEN. The tag then sends one
+// FINAL_BROADCAST, scheduled at pollTx + (nr of anchors + 1) slots, holding
+// the answer arrival times of all anchors it heard. Each anchor in the final
+// sends its REPORT at finalRx + (i+1) * LPS_TWR_BROADCAST_SLOT_LEN, and the
+// tag computes all distances of the round from the shared poll and final.
+#define LPS_TWR_BROADCAST_ADDRESS 0xffffffffffffffff
+
+#define LPS_TWR_BROADCAST_ANCHOR_COUNT 2
+#define LPS_TWR_BROADCAST_ANCHOR_IDS 3
+#define LPS_TWR_BROADCAST_FINAL_PAYLOAD 2
+
+#ifndef LPS_TWR_BROADCAST_SLOT_US
+#define LPS_TWR_BROADCAST_SLOT_US 500
+#endif
+#define LPS_TWR_BROADCAST_SLOT_LEN ((uint64_t)(LPS_TWR_BROADCAST_SLOT_US * (LOCODECK_TS_FREQ / 1e6)))
+
 #ifdef LOCODECK_NR_OF_ANCHORS
 #define LOCODECK_NR_OF_TWR_ANCHORS LOCODECK_NR_OF_ANCHORS
 #else
@@ -41,6 +63,16 @@ typedef struct {
   uint8_t pressure_ok;
 } __attribute__((packed)) lpsTwrTagReportPayload_t;
 
+typedef struct {
+  uint8_t pollTx[5];
+  uint8_t finalTx[5];
+  uint8_t answerCount;
+  struct {
+    uint8_t anchorId;
+    uint8_t answerRx[5];
+  } __attribute__((packed)) answers[LOCODECK_NR_OF_TWR_ANCHORS];
+} __attribute__((packed)) lpsTwrTagBroadcastFinalPayload_t;
+
 typedef struct {
   const uint64_t antennaDelay;
   const int rangingFailedThreshold;
@@ -55,6 +87,9 @@ typedef struct {
   // TWR-TDMA options
   bool useTdma;
   int tdmaSlot;
+
+  // Range with all anchors at once, requires anchors supporting broadcast poll
+  bool useBroadcastPoll;
 } lpsTwrAlgoOptions_t;
 
 
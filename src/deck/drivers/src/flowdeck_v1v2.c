@@ -45,6 +45,15 @@
 #define AVERAGE_HISTORY_LENGTH 4
 #define OULIER_LIMIT 100
 #define LP_CONSTANT 0.8f
+
+// The PMW3901 runs at up to 121 frames per second
+#define FLOW_POLL_PERIOD_MIN_MS 8
+// Push a zero flow measurement if no motion has been reported for this long
+#define FLOW_MAX_INTEGRATION_US 50000
+#define FLOW_STD_DEV 0.25f
+// Surface quality above which the measurement gets the nominal standard deviation
+#define FLOW_SQUAL_NOMINAL 40
+#define FLOW_STD_DEV_MAX_SCALE 4.0f
 // #define USE_LP_FILTER
 // #define USE_MA_SMOOTHING
 
@@ -69,17 +78,54 @@ motionBurst_t currentMotion;
 // Disables pushing the flow measurement in the EKF
 static bool useFlowDisabled = false;
 
+static uint8_t pollPeriodMs = 10;
+static bool useAdaptiveStdDev = false;
+static float flowDt;
+static float flowStdDev = FLOW_STD_DEV;
+
 #define NCS_PIN DECK_GPIO_IO3
 
 
+static float flowdeckStdDev(const motionBurst_t* motion)
+{
+  if (!useAdaptiveStdDev || motion->squal >= FLOW_SQUAL_NOMINAL) {
+    return FLOW_STD_DEV;
+  }
+
+  // Trust the flow less on poor surfaces, where the sensor tracks few features
+  float scale = (float)FLOW_SQUAL_NOMINAL / (float)(motion->squal + 1);
+  if (scale > FLOW_STD_DEV_MAX_SCALE) {
+    scale = FLOW_STD_DEV_MAX_SCALE;
+  }
+
+  return FLOW_STD_DEV * scale;
+}
+
 static void flowdeckTask(void *param)
 {
   systemWaitStart();
 
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  uint64_t lastTimestamp = usecTimestamp();
+
   while(1) {
-    vTaskDelay(10);
+    if (pollPeriodMs < FLOW_POLL_PERIOD_MIN_MS) {
+      pollPeriodMs = FLOW_POLL_PERIOD_MIN_MS;
+    }
+    vTaskDelayUntil(&lastWakeTime, M2T(pollPeriodMs));
 
     pmw3901ReadMotion(NCS_PIN, &currentMotion);
+    uint64_t timestamp = usecTimestamp();
+
+    // The motion registers accumulate until they are read while the motion
+    // bit is set, keep integrating if nothing has moved. Zero flow is still
+    // reported once in a while since it is valuable information when hovering.
+    if (!currentMotion.motionOccured && (timestamp - lastTimestamp) < FLOW_MAX_INTEGRATION_US) {
+      continue;
+    }
+
+    flowDt = (float)(timestamp - lastTimestamp) / 1000000.0f;
+    lastTimestamp = timestamp;
 
     // Flip motion information to comply with sensor mounting
     // (might need to be changed if mounted differently)
@@ -91,9 +137,11 @@ static void flowdeckTask(void *param)
 
       // Form flow measurement struct and push into the EKF
       flowMeasurement_t flowData;
-      flowData.stdDevX = 0.25;    // [pixels] should perhaps be made larger?
-      flowData.stdDevY = 0.25;    // [pixels] should perhaps be made larger?
-      flowData.dt = 0.01;
+      flowStdDev = flowdeckStdDev(&currentMotion);
+      flowData.timestamp = timestamp;
+      flowData.stdDevX = flowStdDev;    // [pixels]
+      flowData.stdDevY = flowStdDev;    // [pixels]
+      flowData.dt = flowDt;
 
 #if defined(USE_MA_SMOOTHING)
       // Use MA Smoothing
@@ -230,10 +278,15 @@ LOG_ADD(LOG_UINT8, maxRaw, &currentMotion.maxRawData)
 LOG_ADD(LOG_UINT8, minRaw, &currentMotion.minRawData)
 LOG_ADD(LOG_UINT8, Rawsum, &currentMotion.rawDataSum)
 LOG_ADD(LOG_UINT8, outlierCount, &outlierCount)
+LOG_ADD(LOG_UINT8, squal, &currentMotion.squal)
+LOG_ADD(LOG_FLOAT, dt, &flowDt)
+LOG_ADD(LOG_FLOAT, stdDev, &flowStdDev)
 LOG_GROUP_STOP(motion)
 
 PARAM_GROUP_START(motion)
 PARAM_ADD(PARAM_UINT8, disable, &useFlowDisabled)
+PARAM_ADD(PARAM_UINT8, pollMs, &pollPeriodMs)
+PARAM_ADD(PARAM_UINT8, adaptive, &useAdaptiveStdDev)
 PARAM_GROUP_STOP(motion)
 
 PARAM_GROUP_START(deck)
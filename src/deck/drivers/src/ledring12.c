@@ -748,7 +748,7 @@ void ledring12Worker(void * data)
 
 static void ledring12Timer(xTimerHandle timer)
 {
-  workerSchedule(ledring12Worker, NULL);
+  workerSchedulePriority(ledring12Worker, NULL, workerPriorityLow);
 
   setHeadlightsOn(headlightEnable);
 }
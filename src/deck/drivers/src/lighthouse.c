@@ -33,6 +33,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "system.h"
 #include "deck.h"
@@ -113,11 +114,16 @@ static int serialFrameCount = 0;
 static int frameCount = 0;
 static int cycleCount = 0;
 static int positionCount = 0;
+static int sweepCount = 0;
 
 static float serialFrameRate = 0.0;
 static float frameRate = 0.0;
 static float cycleRate = 0.0;
 static float positionRate = 0.0;
+static float sweepRate = 0.0;
+
+// 0 = intersect the rays of both base stations, 1 = fuse every sweep angle in the estimator
+static uint8_t estimationMethod = 1;
 
 static uint16_t pulseWidth[PULSE_PROCESSOR_N_SENSORS];
 
@@ -133,15 +139,35 @@ typedef union frame_u {
   char data[7];
 } __attribute__((packed)) frame_t;
 
+// Received bytes are parsed directly from the UART DMA ring, one batch at a time
+static const uint8_t* uartData;
+static uint32_t uartDataLength = 0;
+
+static inline char getChar()
+{
+  if (uartDataLength == 0) {
+    uartDataLength = uart1GetDataDma(&uartData);
+  }
+
+  uartDataLength--;
+  return (char)*uartData++;
+}
+
 static bool getFrame(frame_t *frame)
 {
   int syncCounter = 0;
   for(int i=0; i<7; i++) {
-    uart1Getchar(&frame->data[i]);
+    frame->data[i] = getChar();
     if (frame->data[i] != 0) {
       syncCounter += 1;
     }
   }
+
+  // Data was lost in the DMA ring, the framing can not be trusted
+  if (uart1DidOverrun()) {
+    return false;
+  }
+
   return (frame->sync == 0 || (syncCounter==7));
 }
 
@@ -150,6 +176,7 @@ static void resetStats() {
   frameCount = 0;
   cycleCount = 0;
   positionCount = 0;
+  sweepCount = 0;
 }
 
 static void calculateStats(uint32_t nowMs) {
@@ -158,6 +185,7 @@ static void calculateStats(uint32_t nowMs) {
   frameRate = frameCount / time;
   cycleRate = cycleCount / time;
   positionRate = positionCount / time;
+  sweepRate = sweepCount / time;
 
   resetStats();
 }
@@ -199,6 +227,82 @@ static void estimatePosition(pulseProcessorResult_t angles[]) {
   estimatorEnqueuePosition(&ext_pos);
 }
 
+// Sensor positions on the deck, in the Crazyflie body frame
+#define SENSOR_POS_W (0.015f / 2.0f)
+#define SENSOR_POS_L (0.030f / 2.0f)
+static const float sensorDeckPositions[PULSE_PROCESSOR_N_SENSORS][3] = {
+  {-SENSOR_POS_L, SENSOR_POS_W, 0.0f},
+  {-SENSOR_POS_L, -SENSOR_POS_W, 0.0f},
+  {SENSOR_POS_L, SENSOR_POS_W, 0.0f},
+  {SENSOR_POS_L, -SENSOR_POS_W, 0.0f},
+};
+
+// Base station geometry converted to the Crazyflie global frame, copied into
+// every queued sweep measurement
+static float baseStationPos[2][3];
+static float baseStationRot[2][3][3];
+static baseStationGeometry_t convertedGeometry[2];
+static bool isGeometryConverted[2] = {false, false};
+
+static float sweepStdDev = 0.001;
+
+/**
+ * The geometry is stored in the lighthouse frame, where
+ * (x, y, z)_lh = (-y, z, -x)_cf. With C the matrix that maps lighthouse
+ * coordinates to Crazyflie coordinates this gives pos = C * origin and
+ * rot = (C * mat)^T, that is row i of rot is column i of mat converted to the
+ * Crazyflie frame. The conversion is skipped if the geometry has not changed
+ * since the last call.
+ */
+static void updateBaseStationGeometry(int baseStation)
+{
+  const baseStationGeometry_t* geometry = &lighthouseBaseStationsGeometry[baseStation];
+
+  if (isGeometryConverted[baseStation] &&
+      memcmp(&convertedGeometry[baseStation], geometry, sizeof(baseStationGeometry_t)) == 0) {
+    return;
+  }
+
+  memcpy(&convertedGeometry[baseStation], geometry, sizeof(baseStationGeometry_t));
+  isGeometryConverted[baseStation] = true;
+  geometry = &convertedGeometry[baseStation];
+
+  baseStationPos[baseStation][0] = -geometry->origin[2];
+  baseStationPos[baseStation][1] = -geometry->origin[0];
+  baseStationPos[baseStation][2] = geometry->origin[1];
+
+  for (int i = 0; i < 3; i++) {
+    baseStationRot[baseStation][i][0] = -geometry->mat[2][i];
+    baseStationRot[baseStation][i][1] = -geometry->mat[0][i];
+    baseStationRot[baseStation][i][2] = geometry->mat[1][i];
+  }
+}
+
+static void useSweepAngles(pulseProcessorResult_t angles[], int baseStation, int axis)
+{
+  updateBaseStationGeometry(baseStation);
+
+  sweepAngleMeasurement_t sweep = {
+    .axis = axis,
+    .stdDev = sweepStdDev,
+  };
+  memcpy(sweep.baseStationPos, baseStationPos[baseStation], sizeof(sweep.baseStationPos));
+  memcpy(sweep.baseStationRot, baseStationRot[baseStation], sizeof(sweep.baseStationRot));
+
+  for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    if (angles[sensor].isAngleValid[baseStation][axis]) {
+      sweep.sensorPos = sensorDeckPositions[sensor];
+      sweep.angle = angles[sensor].correctedAngles[baseStation][axis];
+      if (isfinite(sweep.angle)) {
+        estimatorEnqueueSweepAngle(&sweep);
+        sweepCount++;
+      }
+
+      angles[sensor].isAngleValid[baseStation][axis] = false;
+    }
+  }
+}
+
 static void lighthouseTask(void *param)
 {
   bool synchronized = false;
@@ -226,7 +330,7 @@ static void lighthouseTask(void *param)
     syncCounter = 0;
     while (!synchronized) {
       
-      uart1Getchar(&c);
+      c = getChar();
       if (c != 0) {
         syncCounter += 1;
       } else {
@@ -253,14 +357,24 @@ static void lighthouseTask(void *param)
 
       if (pulseProcessorProcessPulse(&ppState, frame.sensor, frame.timestamp, frame.width, angles, &basestation, &axis)) {
         frameCount++;
+
+        if (estimationMethod != 0) {
+          // Every sweep is a measurement, this keeps tracking when one base station is occluded
+          pulseProcessorApplyCalibration(&ppState, angles);
+          useSweepAngles(angles, basestation, axis);
+        }
+
         if (basestation == 1 && axis == 1) {
           cycleCount++;
 
-          pulseProcessorApplyCalibration(&ppState, angles);
+          if (estimationMethod == 0) {
+            pulseProcessorApplyCalibration(&ppState, angles);
+            estimatePosition(angles);
+          }
 
-          estimatePosition(angles);
           for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
             angles[sensor].validCount = 0;
+            memset(angles[sensor].isAngleValid, 0, sizeof(angles[sensor].isAngleValid));
           }
         }
       }
@@ -335,6 +449,7 @@ static void lighthouseInit(DeckInfo *info)
   if (isInit) return;
 
   uart1Init(230400);
+  uart1EnableRxDma();
   lhblInit(I2C1_DEV);
   
   xTaskCreate(lighthouseTask, "LH",
@@ -393,6 +508,7 @@ LOG_ADD(LOG_FLOAT, serRt, &serialFrameRate)
 LOG_ADD(LOG_FLOAT, frmRt, &frameRate)
 LOG_ADD(LOG_FLOAT, cycleRt, &cycleRate)
 LOG_ADD(LOG_FLOAT, posRt, &positionRate)
+LOG_ADD(LOG_FLOAT, sweepRt, &sweepRate)
 
 LOG_ADD(LOG_UINT16, width0, &pulseWidth[0])
 #if PULSE_PROCESSOR_N_SENSORS > 1
@@ -408,6 +524,11 @@ LOG_ADD(LOG_UINT16, width3, &pulseWidth[3])
 LOG_ADD(LOG_UINT8, comSync, &comSynchronized)
 LOG_GROUP_STOP(lighthouse)
 
+PARAM_GROUP_START(lighthouse)
+PARAM_ADD(PARAM_UINT8, method, &estimationMethod)
+PARAM_ADD(PARAM_FLOAT, sweepStd, &sweepStdDev)
+PARAM_GROUP_STOP(lighthouse)
+
 #endif // DISABLE_LIGHTHOUSE_DRIVER
 
 PARAM_GROUP_START(deck)
@@ -80,6 +80,21 @@
 
 #define DEFAULT_RX_TIMEOUT 10000
 
+// DW1000 register bits for double buffered receive, see the DW1000 user manual
+#define DWREG_SYS_CTRL 0x0D
+#define DWREG_SYS_CTRL_HRBPT_OFFSET 3     // Host side receive buffer pointer toggle, bit 24
+#define DWREG_SYS_CTRL_HRBPT 0x01
+#define DWREG_SYS_STATUS 0x0F
+#define DWREG_SYS_STATUS_RXOVRR_OFFSET 2  // Receiver overrun, bit 20
+#define DWREG_SYS_STATUS_RXOVRR 0x10
+#define DWREG_SYS_STATUS_RXBP_OFFSET 3    // Buffer pointers, bit 30 and 31
+#define DWREG_SYS_STATUS_HSRBP 0x40
+#define DWREG_SYS_STATUS_ICRBP 0x80
+#define DWREG_PMSC 0x36
+#define DWREG_PMSC_SOFTRESET_OFFSET 3
+#define DWREG_PMSC_SOFTRESET_RX 0xE0
+#define DWREG_PMSC_SOFTRESET_CLEAR 0xF0
+
 
 #define ANTENNA_OFFSET 154.6   // In meter
 
@@ -131,14 +146,84 @@ static QueueHandle_t lppShortQueue;
 
 static uint32_t timeout;
 
+static bool doubleBufferedRx = false;
+static uint16_t rxBufferSwaps;
+static uint16_t rxOverruns;
+
 static void txCallback(dwDevice_t *dev)
 {
   timeout = algorithm->onEvent(dev, eventPacketSent);
 }
 
+static bool isReceiveOverrun(dwDevice_t *dev)
+{
+  return (dev->sysstatus[DWREG_SYS_STATUS_RXOVRR_OFFSET] & DWREG_SYS_STATUS_RXOVRR) != 0;
+}
+
+static void resetReceiver(dwDevice_t *dev)
+{
+  dwIdle(dev);
+
+  uint8_t reset = DWREG_PMSC_SOFTRESET_RX;
+  dwSpiWrite(dev, DWREG_PMSC, DWREG_PMSC_SOFTRESET_OFFSET, &reset, 1);
+  reset = DWREG_PMSC_SOFTRESET_CLEAR;
+  dwSpiWrite(dev, DWREG_PMSC, DWREG_PMSC_SOFTRESET_OFFSET, &reset, 1);
+
+  uint8_t clear = DWREG_SYS_STATUS_RXOVRR;
+  dwSpiWrite(dev, DWREG_SYS_STATUS, DWREG_SYS_STATUS_RXOVRR_OFFSET, &clear, 1);
+}
+
+static void toggleHostReceiveBuffer(dwDevice_t *dev)
+{
+  uint8_t toggle = DWREG_SYS_CTRL_HRBPT;
+  dwSpiWrite(dev, DWREG_SYS_CTRL, DWREG_SYS_CTRL_HRBPT_OFFSET, &toggle, 1);
+}
+
 static void rxCallback(dwDevice_t *dev)
 {
+  if (!doubleBufferedRx) {
+    timeout = algorithm->onEvent(dev, eventPacketReceived);
+    return;
+  }
+
+  if (isReceiveOverrun(dev)) {
+    // A packet arrived while both buffers were full, the buffer content
+    // can not be trusted. The algorithm re-arms the receiver.
+    rxOverruns++;
+    resetReceiver(dev);
+    timeout = algorithm->onEvent(dev, eventReceiveFailed);
+    return;
+  }
+
   timeout = algorithm->onEvent(dev, eventPacketReceived);
+
+  // Hand the buffer back to the receiver, a packet already waiting in the
+  // other buffer raises a new interrupt
+  toggleHostReceiveBuffer(dev);
+  rxBufferSwaps++;
+}
+
+void locoDeckSetDoubleBufferedReceive(dwDevice_t *dev, const bool enable)
+{
+  doubleBufferedRx = enable;
+  dwSetDoubleBuffering(dev, enable);
+}
+
+void locoDeckSyncReceiveBuffers(dwDevice_t *dev)
+{
+  if (!doubleBufferedRx) {
+    return;
+  }
+
+  // The host and receiver side buffer pointers must point to the same buffer
+  // when the receiver is started
+  uint8_t pointers;
+  dwSpiRead(dev, DWREG_SYS_STATUS, DWREG_SYS_STATUS_RXBP_OFFSET, &pointers, 1);
+  const bool hostSide = (pointers & DWREG_SYS_STATUS_HSRBP) != 0;
+  const bool receiverSide = (pointers & DWREG_SYS_STATUS_ICRBP) != 0;
+  if (hostSide != receiverSide) {
+    toggleHostReceiveBuffer(dev);
+  }
 }
 
 static void rxTimeoutCallback(dwDevice_t * dev) {
@@ -188,6 +273,14 @@ uint8_t locoDeckGetActiveAnchorIdList(uint8_t unorderedAnchorList[], const int m
   return result;
 }
 
+static void initAlgorithm()
+{
+  // Listening algorithms opt in to double buffered receive in init
+  locoDeckSetDoubleBufferedReceive(dwm, false);
+  algorithm->init(dwm);
+  timeout = algorithm->onEvent(dwm, eventTimeout);
+}
+
 static void uwbTask(void* parameters)
 {
   lppShortQueue = xQueueCreate(10, sizeof(lpsLppShortPacket_t));
@@ -210,8 +303,7 @@ static void uwbTask(void* parameters)
           // Defaults to TDoA algorithm
           algoOptions.currentRangingMode = lpsMode_TDoA2;
           algorithm = algorithmsList[algoOptions.currentRangingMode].algorithm;
-          algorithm->init(dwm);
-          timeout = algorithm->onEvent(dwm, eventTimeout);
+          initAlgorithm();
         } else if (xTaskGetTickCount() > algoOptions.nextSwitchTick) {
           // Test if we have detected anchors
           if (algoOptions.autoStarted && algorithm->isRangingOk()) {
@@ -232,8 +324,7 @@ static void uwbTask(void* parameters)
             }
 
             algorithm = algorithmsList[algoOptions.currentRangingMode].algorithm;
-            algorithm->init(dwm);
-            timeout = algorithm->onEvent(dwm, eventTimeout);
+            initAlgorithm();
           }
         }
       }
@@ -252,8 +343,7 @@ static void uwbTask(void* parameters)
         DEBUG_PRINT("Switching mode to %s\n", algorithmsList[algoOptions.currentRangingMode].name);
       }
 
-      algorithm->init(dwm);
-      timeout = algorithm->onEvent(dwm, eventTimeout);
+      initAlgorithm();
     }
     xSemaphoreGive(algoSemaphore);
 
@@ -506,6 +596,8 @@ LOG_GROUP_STOP(ranging)
 
 LOG_GROUP_START(loco)
 LOG_ADD(LOG_UINT8, mode, &algoOptions.currentRangingMode)
+LOG_ADD(LOG_UINT16, rxSwaps, &rxBufferSwaps)
+LOG_ADD(LOG_UINT16, rxOverruns, &rxOverruns)
 LOG_GROUP_STOP(loco)
 
 PARAM_GROUP_START(loco)
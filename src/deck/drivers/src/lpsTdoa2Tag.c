@@ -39,6 +39,7 @@
 #include "estimator.h"
 
 #include "physicalConstants.h"
+#include "clockCorrectionEngine.h"
 
 #define MEASUREMENT_NOISE_STD 0.15f
 #define STATS_INTERVAL 500
@@ -83,7 +84,11 @@ static lpsTdoa2AlgoOptions_t* options = &defaultOptions;
 typedef struct {
   rangePacket2_t packet;
   dwTime_t arrival;
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  clockCorrectionFixed_t clockCorrection_T_To_A;
+#else
   double clockCorrection_T_To_A;
+#endif
 
   uint32_t anchorStatusTimeout;
 } history_t;
@@ -173,7 +178,11 @@ static bool isSeqNrConsecutive(uint8_t prevSeqNr, uint8_t currentSeqNr) {
 // rxAr_by_An_in_cl_An should be interpreted as "The time when packet was received from the Reference
 // Anchor by Anchor N expressed in the clock of Anchor N"
 
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+static bool calcClockCorrection(clockCorrectionFixed_t* clockCorrection, const uint8_t anchor, const rangePacket2_t* packet, const dwTime_t* arrival) {
+#else
 static bool calcClockCorrection(double* clockCorrection, const uint8_t anchor, const rangePacket2_t* packet, const dwTime_t* arrival) {
+#endif
 
   if (! isSeqNrConsecutive(history[anchor].packet.sequenceNrs[anchor], packet->sequenceNrs[anchor])) {
     return false;
@@ -184,10 +193,17 @@ static bool calcClockCorrection(double* clockCorrection, const uint8_t anchor, c
   const int64_t latest_rxAn_by_T_in_cl_T = history[anchor].arrival.full;
   const int64_t latest_txAn_in_cl_An = history[anchor].packet.timestamps[anchor];
 
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  const uint64_t frameTime_in_cl_An = truncateToAnchorTimeStamp(txAn_in_cl_An - latest_txAn_in_cl_An);
+  const uint64_t frameTime_in_T = truncateToLocalTimeStamp(rxAn_by_T_in_cl_T - latest_rxAn_by_T_in_cl_T);
+
+  *clockCorrection = clockCorrectionEngineRatioFixed(frameTime_in_cl_An, frameTime_in_T);
+#else
   const double frameTime_in_cl_An = truncateToAnchorTimeStamp(txAn_in_cl_An - latest_txAn_in_cl_An);
   const double frameTime_in_T = truncateToLocalTimeStamp(rxAn_by_T_in_cl_T - latest_rxAn_by_T_in_cl_T);
 
   *clockCorrection = frameTime_in_cl_An / frameTime_in_T;
+#endif
   return true;
 }
 
@@ -202,11 +218,15 @@ static bool calcDistanceDiff(float* tdoaDistDiff, const uint8_t previousAnchor,
   const int64_t rxAn_by_T_in_cl_T  = arrival->full;
   const int64_t rxAr_by_An_in_cl_An = packet->timestamps[previousAnchor];
   const int64_t tof_Ar_to_An_in_cl_An = packet->distances[previousAnchor];
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  const clockCorrectionFixed_t clockCorrection = history[anchor].clockCorrection_T_To_A;
+#else
   const double clockCorrection = history[anchor].clockCorrection_T_To_A;
+#endif
 
   const bool isAnchorDistanceOk = isValidTimeStamp(tof_Ar_to_An_in_cl_An);
   const bool isRxTimeInTagOk = isValidTimeStamp(rxAr_by_An_in_cl_An);
-  const bool isClockCorrectionOk = (clockCorrection != 0.0);
+  const bool isClockCorrectionOk = (clockCorrection != 0);
 
   if (! (isAnchorDistanceOk && isRxTimeInTagOk && isClockCorrectionOk)) {
     return false;
@@ -217,9 +237,15 @@ static bool calcDistanceDiff(float* tdoaDistDiff, const uint8_t previousAnchor,
   const int64_t rxAr_by_T_in_cl_T = history[previousAnchor].arrival.full;
 
   const int64_t delta_txAr_to_txAn_in_cl_An = (tof_Ar_to_An_in_cl_An + truncateToAnchorTimeStamp(txAn_in_cl_An - rxAr_by_An_in_cl_An));
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  const int64_t timeDiffOfArrival_in_cl_An =  clockCorrectionEngineApplyFixed(truncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T), clockCorrection) - delta_txAr_to_txAn_in_cl_An;
+
+  *tdoaDistDiff = (float)timeDiffOfArrival_in_cl_An * (float)(SPEED_OF_LIGHT / LOCODECK_TS_FREQ);
+#else
   const int64_t timeDiffOfArrival_in_cl_An =  truncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T) * clockCorrection - delta_txAr_to_txAn_in_cl_An;
 
   *tdoaDistDiff = SPEED_OF_LIGHT * timeDiffOfArrival_in_cl_An / LOCODECK_TS_FREQ;
+#endif
 
   return true;
 }
@@ -313,7 +339,11 @@ static bool rxcallback(dwDevice_t *dev) {
 #endif
 
       calcClockCorrection(&history[anchor].clockCorrection_T_To_A, anchor, packet, &arrival);
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+      logClockCorrection[anchor] = clockCorrectionEngineFixedToFloat(history[anchor].clockCorrection_T_To_A);
+#else
       logClockCorrection[anchor] = history[anchor].clockCorrection_T_To_A;
+#endif
 
       if (anchor != previousAnchor) {
         float tdoaDistDiff = 0.0;
@@ -102,6 +102,12 @@ static bool rangingOk;
 
 static tdoaEngineState_t engineState;
 
+#ifdef LPS_TDOA3_DOUBLE_BUFFERED_RX
+static const bool doubleBufferedRx = true;
+#else
+static const bool doubleBufferedRx = false;
+#endif
+
 
 static bool isValidTimeStamp(const int64_t anchorRxTime) {
   return anchorRxTime != 0;
@@ -202,6 +208,7 @@ static void rxcallback(dwDevice_t *dev) {
 static void setRadioInReceiveMode(dwDevice_t *dev) {
   dwNewReceive(dev);
   dwSetDefaults(dev);
+  locoDeckSyncReceiveBuffers(dev);
   dwStartReceive(dev);
 }
 
@@ -245,6 +252,8 @@ static uint32_t onEvent(dwDevice_t *dev, uwbEvent_t event) {
       break;
     case eventReceiveTimeout:
       break;
+    case eventReceiveFailed:
+      break;
     case eventPacketSent:
       // Service packet sent, the radio is back to receive automatically
       break;
@@ -253,7 +262,10 @@ static uint32_t onEvent(dwDevice_t *dev, uwbEvent_t event) {
   }
 
   if(!sendLpp(dev)) {
-    setRadioInReceiveMode(dev);
+    // With double buffering the receiver keeps running after a packet
+    if (!(doubleBufferedRx && event == eventPacketReceived)) {
+      setRadioInReceiveMode(dev);
+    }
   }
 
   uint32_t now_ms = T2M(xTaskGetTickCount());
@@ -262,14 +274,16 @@ static uint32_t onEvent(dwDevice_t *dev, uwbEvent_t event) {
   return MAX_TIMEOUT;
 }
 
-static void sendTdoaToEstimatorCallback(tdoaMeasurement_t* tdoaMeasurement) {
-  estimatorEnqueueTDOA(tdoaMeasurement);
+static void sendTdoaToEstimatorCallback(tdoaMeasurement_t tdoaMeasurements[], const int count) {
+  for (int i = 0; i < count; i++) {
+    estimatorEnqueueTDOA(&tdoaMeasurements[i]);
+  }
 
   #ifdef LPS_2D_POSITION_HEIGHT
   // If LPS_2D_POSITION_HEIGHT is defined we assume that we are doing 2D positioning.
   // LPS_2D_POSITION_HEIGHT contains the height (Z) that the tag will be located at
   heightMeasurement_t heightData;
-  heightData.timestamp = xTaskGetTickCount();
+  heightData.timestamp = usecTimestamp();
   heightData.height = LPS_2D_POSITION_HEIGHT;
   heightData.stdDev = 0.0001;
   estimatorEnqueueAbsoluteHeight(&heightData);
@@ -309,6 +323,7 @@ static void Initialize(dwDevice_t *dev) {
   #endif
 
   dwSetReceiveWaitTimeout(dev, TDOA3_RECEIVE_TIMEOUT);
+  locoDeckSetDoubleBufferedReceive(dev, doubleBufferedRx);
 
   dwCommitConfiguration(dev);
 
@@ -336,6 +351,7 @@ LOG_ADD(LOG_UINT16, stRx, &engineState.stats.packetsReceivedRate)
 LOG_ADD(LOG_UINT16, stEst, &engineState.stats.packetsToEstimatorRate)
 LOG_ADD(LOG_UINT16, stTime, &engineState.stats.timeIsGoodRate)
 LOG_ADD(LOG_UINT16, stFound, &engineState.stats.suitableDataFoundRate)
+LOG_ADD(LOG_UINT16, stPairs, &engineState.stats.pairsFoundRate)
 
 LOG_ADD(LOG_UINT16, stCc, &engineState.stats.clockCorrectionRate)
 
@@ -350,4 +366,5 @@ LOG_GROUP_STOP(tdoa3)
 PARAM_GROUP_START(tdoa3)
 PARAM_ADD(PARAM_UINT8, logId, &engineState.stats.newAnchorId)
 PARAM_ADD(PARAM_UINT8, logOthrId, &engineState.stats.newRemoteAnchorId)
+PARAM_ADD(PARAM_UINT8, maxPairs, &engineState.maxPairsPerPacket)
 PARAM_GROUP_STOP(tdoa3)
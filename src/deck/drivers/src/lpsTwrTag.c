@@ -74,6 +74,10 @@ static lpsTwrAlgoOptions_t defaultOptions = {
    .tdmaSlot = TDMA_SLOT,
  #endif
 
+ #ifdef LPS_TWR_BROADCAST_POLL_ENABLE
+   .useBroadcastPoll = true,
+ #endif
+
    // To set a static anchor position from startup, uncomment and modify the
    // following code:
  //   .anchorPosition = {
@@ -135,6 +139,16 @@ static dwTime_t frameStart;
 
 static bool rangingOk;
 
+// Broadcast poll round, the anchor index is also the reply slot
+static struct {
+  int lastSlot;
+  bool finalSent;
+  bool answered[LOCODECK_NR_OF_TWR_ANCHORS];
+  bool reported[LOCODECK_NR_OF_TWR_ANCHORS];
+  bool useDistance[LOCODECK_NR_OF_TWR_ANCHORS];
+  dwTime_t answerRx[LOCODECK_NR_OF_TWR_ANCHORS];
+} broadcastRound;
+
 static void lpsHandleLppShortPacket(const uint8_t srcId, const uint8_t *data);
 
 static void txcallback(dwDevice_t *dev)
@@ -145,14 +159,89 @@ static void txcallback(dwDevice_t *dev)
 
   switch (txPacket.payload[0]) {
     case LPS_TWR_POLL:
+    case LPS_TWR_POLL_BROADCAST:
       poll_tx = departure;
       break;
     case LPS_TWR_FINAL:
+    case LPS_TWR_FINAL_BROADCAST:
       final_tx = departure;
       break;
   }
 }
 
+static int findAnchorIndex(const locoAddress_t address)
+{
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (address == options->anchorAddress[i]) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static float calculateDistance(const dwTime_t* pollTx, const dwTime_t* pollRx, const dwTime_t* answerTx,
+                               const dwTime_t* answerRx, const dwTime_t* finalTx, const dwTime_t* finalRx)
+{
+  double tround1, treply1, treply2, tround2, tprop_ctn, tprop;
+
+  tround1 = answerRx->low32 - pollTx->low32;
+  treply1 = answerTx->low32 - pollRx->low32;
+  tround2 = finalRx->low32 - answerTx->low32;
+  treply2 = finalTx->low32 - answerRx->low32;
+
+  tprop_ctn = ((tround1*tround2) - (treply1*treply2)) / (tround1 + tround2 + treply1 + treply2);
+
+  tprop = tprop_ctn / LOCODECK_TS_FREQ;
+  return SPEED_OF_LIGHT * tprop;
+}
+
+// Stores a new distance, returns true if it should be used by the estimator
+static bool updateDistance(const int anchor, const float distance, const float asl)
+{
+  state.distance[anchor] = distance;
+  state.pressures[anchor] = asl;
+
+  // Outliers rejection
+  rangingStats[anchor].ptr = (rangingStats[anchor].ptr + 1) % RANGING_HISTORY_LENGTH;
+  float32_t mean;
+  float32_t stddev;
+
+  arm_std_f32(rangingStats[anchor].history, RANGING_HISTORY_LENGTH, &stddev);
+  arm_mean_f32(rangingStats[anchor].history, RANGING_HISTORY_LENGTH, &mean);
+  float32_t diff = fabsf(mean - distance);
+
+  rangingStats[anchor].history[rangingStats[anchor].ptr] = distance;
+
+  rangingOk = true;
+
+  return (options->combinedAnchorPositionOk || options->anchorPosition[anchor].timestamp) &&
+         (diff < (OUTLIER_TH*stddev));
+}
+
+static void enqueueDistance(const int anchor)
+{
+  distanceMeasurement_t dist;
+  dist.timestamp = 0; // stamped by the estimator when enqueued
+  dist.distance = state.distance[anchor];
+  dist.x = options->anchorPosition[anchor].x;
+  dist.y = options->anchorPosition[anchor].y;
+  dist.z = options->anchorPosition[anchor].z;
+  dist.stdDev = 0.25;
+  estimatorEnqueueDistance(&dist);
+}
+
+static void synchronizeTdma()
+{
+  // Final packet is sent by us and received by the anchor
+  // We use it as synchonisation time for TDMA
+  dwTime_t offset = { .full =final_tx.full - final_rx.full };
+  frameStart.full = TDMA_LAST_FRAME(final_rx.full) + offset.full;
+  tdmaSynchronized = true;
+}
+
+static uint32_t broadcastRxcallback(dwDevice_t *dev, const packet_t* rxPacket, const int dataLength);
+
 
 static uint32_t rxcallback(dwDevice_t *dev) {
   dwTime_t arival = { .full=0 };
@@ -172,6 +261,10 @@ static uint32_t rxcallback(dwDevice_t *dev) {
     return MAX_TIMEOUT;
   }
 
+  if (options->useBroadcastPoll) {
+    return broadcastRxcallback(dev, &rxPacket, dataLength);
+  }
+
   txPacket.destAddress = rxPacket.sourceAddress;
   txPacket.sourceAddress = rxPacket.destAddress;
 
@@ -184,14 +277,7 @@ static uint32_t rxcallback(dwDevice_t *dev) {
 
       if (dataLength - MAC802154_HEADER_LENGTH > 3) {
         if (rxPacket.payload[LPS_TWR_LPP_HEADER] == LPP_HEADER_SHORT_PACKET) {
-          int srcId = -1;
-
-          for (int i=0; i<LOCODECK_NR_OF_TWR_ANCHORS; i++) {
-            if (rxPacket.sourceAddress == options->anchorAddress[i]) {
-              srcId = i;
-              break;
-            }
-          }
+          int srcId = findAnchorIndex(rxPacket.sourceAddress);
 
           if (srcId >= 0) {
             lpsHandleLppShortPacket(srcId, &rxPacket.payload[LPS_TWR_LPP_TYPE]);
@@ -216,7 +302,6 @@ static uint32_t rxcallback(dwDevice_t *dev) {
     case LPS_TWR_REPORT:
     {
       lpsTwrTagReportPayload_t *report = (lpsTwrTagReportPayload_t *)(rxPacket.payload+2);
-      double tround1, treply1, treply2, tround2, tprop_ctn, tprop;
 
       if (rxPacket.payload[LPS_TWR_SEQ] != curr_seq) {
         return 0;
@@ -226,47 +311,13 @@ static uint32_t rxcallback(dwDevice_t *dev) {
       memcpy(&answer_tx, &report->answerTx, 5);
       memcpy(&final_rx, &report->finalRx, 5);
 
-      tround1 = answer_rx.low32 - poll_tx.low32;
-      treply1 = answer_tx.low32 - poll_rx.low32;
-      tround2 = final_rx.low32 - answer_tx.low32;
-      treply2 = final_tx.low32 - answer_rx.low32;
-
-      tprop_ctn = ((tround1*tround2) - (treply1*treply2)) / (tround1 + tround2 + treply1 + treply2);
-
-      tprop = tprop_ctn / LOCODECK_TS_FREQ;
-      state.distance[current_anchor] = SPEED_OF_LIGHT * tprop;
-      state.pressures[current_anchor] = report->asl;
-
-      // Outliers rejection
-      rangingStats[current_anchor].ptr = (rangingStats[current_anchor].ptr + 1) % RANGING_HISTORY_LENGTH;
-      float32_t mean;
-      float32_t stddev;
-
-      arm_std_f32(rangingStats[current_anchor].history, RANGING_HISTORY_LENGTH, &stddev);
-      arm_mean_f32(rangingStats[current_anchor].history, RANGING_HISTORY_LENGTH, &mean);
-      float32_t diff = fabsf(mean - state.distance[current_anchor]);
-
-      rangingStats[current_anchor].history[rangingStats[current_anchor].ptr] = state.distance[current_anchor];
-
-      rangingOk = true;
-
-      if ((options->combinedAnchorPositionOk || options->anchorPosition[current_anchor].timestamp) &&
-          (diff < (OUTLIER_TH*stddev))) {
-        distanceMeasurement_t dist;
-        dist.distance = state.distance[current_anchor];
-        dist.x = options->anchorPosition[current_anchor].x;
-        dist.y = options->anchorPosition[current_anchor].y;
-        dist.z = options->anchorPosition[current_anchor].z;
-        dist.stdDev = 0.25;
-        estimatorEnqueueDistance(&dist);
+      float distance = calculateDistance(&poll_tx, &poll_rx, &answer_tx, &answer_rx, &final_tx, &final_rx);
+      if (updateDistance(current_anchor, distance, report->asl)) {
+        enqueueDistance(current_anchor);
       }
 
       if (options->useTdma && current_anchor == 0) {
-        // Final packet is sent by us and received by the anchor
-        // We use it as synchonisation time for TDMA
-        dwTime_t offset = { .full =final_tx.full - final_rx.full };
-        frameStart.full = TDMA_LAST_FRAME(final_rx.full) + offset.full;
-        tdmaSynchronized = true;
+        synchronizeTdma();
       }
 
       ranging_complete = true;
@@ -335,6 +386,210 @@ static void initiateRanging(dwDevice_t *dev)
   dwStartTransmit(dev);
 }
 
+// Receive wait timeout (in us) covering the reply slots after lastSlot
+static uint16_t broadcastReceiveWindow(const int lastSlot)
+{
+  return (LOCODECK_NR_OF_TWR_ANCHORS - lastSlot - 1) * LPS_TWR_BROADCAST_SLOT_US + LPS_TWR_BROADCAST_SLOT_US / 2;
+}
+
+static void initiateBroadcastRanging(dwDevice_t *dev)
+{
+  if (options->useTdma && tdmaSynchronized) {
+    // go to next TDMA frame
+    frameStart.full += TDMA_FRAME_LEN;
+  }
+
+  memset(&broadcastRound, 0, sizeof(broadcastRound));
+  broadcastRound.lastSlot = -1;
+
+  dwIdle(dev);
+
+  txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_POLL_BROADCAST;
+  txPacket.payload[LPS_TWR_SEQ] = ++curr_seq;
+  txPacket.payload[LPS_TWR_BROADCAST_ANCHOR_COUNT] = LOCODECK_NR_OF_TWR_ANCHORS;
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    txPacket.payload[LPS_TWR_BROADCAST_ANCHOR_IDS + i] = options->anchorAddress[i] & 0xff;
+  }
+
+  txPacket.sourceAddress = options->tagAddress;
+  txPacket.destAddress = LPS_TWR_BROADCAST_ADDRESS;
+
+  dwNewTransmit(dev);
+  dwSetDefaults(dev);
+  dwSetData(dev, (uint8_t*)&txPacket, MAC802154_HEADER_LENGTH + LPS_TWR_BROADCAST_ANCHOR_IDS + LOCODECK_NR_OF_TWR_ANCHORS);
+
+  if (options->useTdma && tdmaSynchronized) {
+    dwTime_t txTime = transmitTimeForSlot(options->tdmaSlot);
+    dwSetTxRxTime(dev, txTime);
+  }
+
+  dwSetReceiveWaitTimeout(dev, broadcastReceiveWindow(broadcastRound.lastSlot));
+  dwWaitForResponse(dev, true);
+  dwStartTransmit(dev);
+}
+
+static void sendBroadcastFinal(dwDevice_t *dev)
+{
+  dwIdle(dev);
+
+  // The final goes out in the slot after the last answer slot, its departure
+  // time is known beforehand and can be sent in the packet
+  dwTime_t txTime = { .full = poll_tx.full + (LOCODECK_NR_OF_TWR_ANCHORS + 1) * LPS_TWR_BROADCAST_SLOT_LEN };
+  adjustTxRxTime(&txTime);
+  final_tx.full = txTime.full + (options->antennaDelay / 2);
+
+  txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_FINAL_BROADCAST;
+  txPacket.payload[LPS_TWR_SEQ] = curr_seq;
+
+  txPacket.sourceAddress = options->tagAddress;
+  txPacket.destAddress = LPS_TWR_BROADCAST_ADDRESS;
+
+  lpsTwrTagBroadcastFinalPayload_t *final = (lpsTwrTagBroadcastFinalPayload_t *)&txPacket.payload[LPS_TWR_BROADCAST_FINAL_PAYLOAD];
+  memcpy(final->pollTx, &poll_tx, 5);
+  memcpy(final->finalTx, &final_tx, 5);
+
+  int count = 0;
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (broadcastRound.answered[i]) {
+      final->answers[count].anchorId = options->anchorAddress[i] & 0xff;
+      memcpy(final->answers[count].answerRx, &broadcastRound.answerRx[i], 5);
+      count++;
+    }
+  }
+  final->answerCount = count;
+
+  const int unusedAnswers = LOCODECK_NR_OF_TWR_ANCHORS - count;
+  const int payloadLength = sizeof(lpsTwrTagBroadcastFinalPayload_t) - unusedAnswers * sizeof(final->answers[0]);
+
+  dwNewTransmit(dev);
+  dwSetDefaults(dev);
+  dwSetData(dev, (uint8_t*)&txPacket, MAC802154_HEADER_LENGTH + LPS_TWR_BROADCAST_FINAL_PAYLOAD + payloadLength);
+  dwSetTxRxTime(dev, txTime);
+
+  broadcastRound.finalSent = true;
+  broadcastRound.lastSlot = -1;
+
+  dwSetReceiveWaitTimeout(dev, broadcastReceiveWindow(broadcastRound.lastSlot));
+  dwWaitForResponse(dev, true);
+  dwStartTransmit(dev);
+}
+
+static void restartBroadcastReceive(dwDevice_t *dev)
+{
+  dwNewReceive(dev);
+  dwSetDefaults(dev);
+  dwSetReceiveWaitTimeout(dev, broadcastReceiveWindow(broadcastRound.lastSlot));
+  dwStartReceive(dev);
+}
+
+// All distances of a round are handed to the estimator together
+static void finishBroadcastRound()
+{
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (broadcastRound.reported[i] && broadcastRound.useDistance[i]) {
+      enqueueDistance(i);
+    }
+  }
+
+  ranging_complete = true;
+}
+
+// Returns true when the last slot of the current phase has passed
+static bool advanceBroadcastPhase(dwDevice_t *dev)
+{
+  if (broadcastRound.lastSlot < LOCODECK_NR_OF_TWR_ANCHORS - 1) {
+    restartBroadcastReceive(dev);
+    return false;
+  }
+
+  if (broadcastRound.finalSent) {
+    finishBroadcastRound();
+    return true;
+  }
+
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (broadcastRound.answered[i]) {
+      sendBroadcastFinal(dev);
+      return false;
+    }
+  }
+
+  // No answers, nothing to send a final for
+  return true;
+}
+
+static uint32_t broadcastRxcallback(dwDevice_t *dev, const packet_t* rxPacket, const int dataLength)
+{
+  const int anchor = findAnchorIndex(rxPacket->sourceAddress);
+  const uint8_t type = rxPacket->payload[LPS_TWR_TYPE];
+
+  bool expected = (anchor >= 0) && (rxPacket->payload[LPS_TWR_SEQ] == curr_seq);
+  if (type == LPS_TWR_ANSWER) {
+    expected = expected && !broadcastRound.finalSent;
+  } else if (type == LPS_TWR_REPORT) {
+    expected = expected && broadcastRound.finalSent && broadcastRound.answered[anchor];
+  } else {
+    expected = false;
+  }
+
+  if (!expected) {
+    restartBroadcastReceive(dev);
+    return MAX_TIMEOUT;
+  }
+
+  if (type == LPS_TWR_ANSWER) {
+    if (dataLength - MAC802154_HEADER_LENGTH > 3) {
+      if (rxPacket->payload[LPS_TWR_LPP_HEADER] == LPP_HEADER_SHORT_PACKET) {
+        lpsHandleLppShortPacket(anchor, &rxPacket->payload[LPS_TWR_LPP_TYPE]);
+      }
+    }
+
+    dwTime_t arival = { .full=0 };
+    dwGetReceiveTimestamp(dev, &arival);
+    arival.full -= (options->antennaDelay / 2);
+    broadcastRound.answerRx[anchor] = arival;
+    broadcastRound.answered[anchor] = true;
+  } else {
+    const lpsTwrTagReportPayload_t *report = (const lpsTwrTagReportPayload_t *)(rxPacket->payload+2);
+
+    memcpy(&poll_rx, &report->pollRx, 5);
+    memcpy(&answer_tx, &report->answerTx, 5);
+    memcpy(&final_rx, &report->finalRx, 5);
+
+    float distance = calculateDistance(&poll_tx, &poll_rx, &answer_tx, &broadcastRound.answerRx[anchor], &final_tx, &final_rx);
+    broadcastRound.useDistance[anchor] = updateDistance(anchor, distance, report->asl);
+    broadcastRound.reported[anchor] = true;
+
+    if (options->useTdma && anchor == 0) {
+      synchronizeTdma();
+    }
+  }
+
+  if (anchor > broadcastRound.lastSlot) {
+    broadcastRound.lastSlot = anchor;
+  }
+
+  if (advanceBroadcastPhase(dev)) {
+    return 0;
+  }
+  return MAX_TIMEOUT;
+}
+
+static uint32_t broadcastReceiveTimeout(dwDevice_t *dev, uwbEvent_t event)
+{
+  if (event == eventReceiveFailed) {
+    // A broken packet most likely is the answer or report of the next slot
+    broadcastRound.lastSlot++;
+  } else {
+    broadcastRound.lastSlot = LOCODECK_NR_OF_TWR_ANCHORS - 1;
+  }
+
+  if (advanceBroadcastPhase(dev)) {
+    return 0;
+  }
+  return MAX_TIMEOUT;
+}
+
 static void sendLppShort(dwDevice_t *dev, lpsLppShortPacket_t *packet)
 {
   dwIdle(dev);
@@ -353,6 +608,28 @@ static void sendLppShort(dwDevice_t *dev, lpsLppShortPacket_t *packet)
   dwStartTransmit(dev);
 }
 
+static uint16_t updateRangingState(uint16_t rangingState, const int anchor, const bool succeeded)
+{
+  if (!succeeded) {
+    rangingState &= ~(1<<anchor);
+    if (state.failedRanging[anchor] < options->rangingFailedThreshold) {
+      state.failedRanging[anchor] ++;
+      rangingState |= (1<<anchor);
+    }
+
+    locSrvSendRangeFloat(anchor, NAN);
+    failedRanging[anchor]++;
+  } else {
+    rangingState |= (1<<anchor);
+    state.failedRanging[anchor] = 0;
+
+    locSrvSendRangeFloat(anchor, state.distance[anchor]);
+    succededRanging[anchor]++;
+  }
+
+  return rangingState;
+}
+
 static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
 {
   static uint32_t statisticStartTick = 0;
@@ -376,21 +653,14 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
     case eventTimeout:  // Comes back to timeout after each ranging attempt
       {
         uint16_t rangingState = locoDeckGetRangingState();
-        if (!ranging_complete && !lpp_transaction) {
-          rangingState &= ~(1<<current_anchor);
-          if (state.failedRanging[current_anchor] < options->rangingFailedThreshold) {
-            state.failedRanging[current_anchor] ++;
-            rangingState |= (1<<current_anchor);
+        if (options->useBroadcastPoll) {
+          if (!lpp_transaction) {
+            for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+              rangingState = updateRangingState(rangingState, i, broadcastRound.reported[i]);
+            }
           }
-
-          locSrvSendRangeFloat(current_anchor, NAN);
-          failedRanging[current_anchor]++;
         } else {
-          rangingState |= (1<<current_anchor);
-          state.failedRanging[current_anchor] = 0;
-
-          locSrvSendRangeFloat(current_anchor, state.distance[current_anchor]);
-          succededRanging[current_anchor]++;
+          rangingState = updateRangingState(rangingState, current_anchor, ranging_complete || lpp_transaction);
         }
         locoDeckSetRangingState(rangingState);
       }
@@ -419,12 +689,19 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
       } else {
         lpp_transaction = false;
         ranging_complete = false;
-        initiateRanging(dev);
+        if (options->useBroadcastPoll) {
+          initiateBroadcastRanging(dev);
+        } else {
+          initiateRanging(dev);
+        }
       }
       return MAX_TIMEOUT;
       break;
     case eventReceiveTimeout:
     case eventReceiveFailed:
+      if (options->useBroadcastPoll && !lpp_transaction) {
+        return broadcastReceiveTimeout(dev, event);
+      }
       return 0;
       break;
     default:
@@ -488,6 +765,9 @@ static void twrTagInit(dwDevice_t *dev)
 
   tdmaSynchronized = false;
 
+  memset(&broadcastRound, 0, sizeof(broadcastRound));
+  broadcastRound.lastSlot = -1;
+
   memset(state.distance, 0, sizeof(state.distance));
   memset(state.pressures, 0, sizeof(state.pressures));
   memset(state.failedRanging, 0, sizeof(state.failedRanging));
@@ -58,6 +58,115 @@ static VL53L1_Dev_t devUp;
 static VL53L1_Dev_t devLeft;
 static VL53L1_Dev_t devRight;
 
+#ifdef MULTIRANGER_CONTINUOUS_RANGING
+
+/*
+ * All five sensors range autonomously at MR_RANGING_PERIOD_MS. Their start
+ * times are staggered over the period so that the read outs are spread out on
+ * the I2C bus, and each sensor is only polled for data ready close to when its
+ * next measurement is due.
+ */
+#define MR_DISTANCE_MODE VL53L1_DISTANCEMODE_MEDIUM
+#define MR_TIMING_BUDGET_US 25000
+#define MR_RANGING_PERIOD_MS 30
+#define MR_NR_OF_SENSORS 5
+#define MR_POLL_MARGIN_MS 2
+#define MR_TIMEOUT_MS (3 * MR_RANGING_PERIOD_MS)
+
+typedef struct {
+    VL53L1_Dev_t *dev;
+    rangeDirection_t direction;
+    TickType_t nextPoll;
+    TickType_t lastReady;
+} mrSensor_t;
+
+static mrSensor_t sensors[MR_NR_OF_SENSORS] = {
+    {.dev = &devFront, .direction = rangeFront},
+    {.dev = &devBack, .direction = rangeBack},
+    {.dev = &devUp, .direction = rangeUp},
+    {.dev = &devLeft, .direction = rangeLeft},
+    {.dev = &devRight, .direction = rangeRight},
+};
+
+static uint16_t readyCount;
+static uint16_t timeoutCount;
+
+static void mrStartContinuous(mrSensor_t *sensor)
+{
+    VL53L1_Error status = VL53L1_ERROR_NONE;
+
+    status = VL53L1_StopMeasurement(sensor->dev);
+    status = VL53L1_SetDistanceMode(sensor->dev, MR_DISTANCE_MODE);
+    status = VL53L1_SetMeasurementTimingBudgetMicroSeconds(sensor->dev, MR_TIMING_BUDGET_US);
+    status = VL53L1_SetInterMeasurementPeriodMilliSeconds(sensor->dev, MR_RANGING_PERIOD_MS);
+    status = VL53L1_StartMeasurement(sensor->dev);
+    status = status;
+
+    TickType_t now = xTaskGetTickCount();
+    sensor->lastReady = now;
+    sensor->nextPoll = now + M2T(MR_RANGING_PERIOD_MS - MR_POLL_MARGIN_MS);
+}
+
+static void mrServiceSensor(mrSensor_t *sensor, TickType_t now)
+{
+    VL53L1_Error status = VL53L1_ERROR_NONE;
+    VL53L1_RangingMeasurementData_t rangingData;
+    uint8_t dataReady = 0;
+
+    status = VL53L1_GetMeasurementDataReady(sensor->dev, &dataReady);
+    if (status != VL53L1_ERROR_NONE || dataReady == 0)
+    {
+        if ((now - sensor->lastReady) > M2T(MR_TIMEOUT_MS))
+        {
+            timeoutCount++;
+            mrStartContinuous(sensor);
+        }
+        return;
+    }
+
+    uint64_t timestamp = usecTimestamp();
+
+    status = VL53L1_GetRangingMeasurementData(sensor->dev, &rangingData);
+    if (status == VL53L1_ERROR_NONE)
+    {
+        rangeSetWithTimestamp(sensor->direction, rangingData.RangeMilliMeter / 1000.0f, timestamp);
+        readyCount++;
+    }
+
+    VL53L1_ClearInterruptAndStartMeasurement(sensor->dev);
+
+    sensor->lastReady = now;
+    sensor->nextPoll = now + M2T(MR_RANGING_PERIOD_MS - MR_POLL_MARGIN_MS);
+}
+
+static void mrTask(void *param)
+{
+    systemWaitStart();
+
+    // Stagger the sensors over the ranging period
+    for (int i = 0; i < MR_NR_OF_SENSORS; i++)
+    {
+        mrStartContinuous(&sensors[i]);
+        vTaskDelay(M2T(MR_RANGING_PERIOD_MS / MR_NR_OF_SENSORS));
+    }
+
+    while (1)
+    {
+        vTaskDelay(M2T(1));
+
+        TickType_t now = xTaskGetTickCount();
+        for (int i = 0; i < MR_NR_OF_SENSORS; i++)
+        {
+            if ((int32_t)(now - sensors[i].nextPoll) >= 0)
+            {
+                mrServiceSensor(&sensors[i], now);
+            }
+        }
+    }
+}
+
+#else
+
 static uint16_t mrGetMeasurementAndRestart(VL53L1_Dev_t *dev)
 {
     VL53L1_Error status = VL53L1_ERROR_NONE;
@@ -114,6 +223,8 @@ static void mrTask(void *param)
     }
 }
 
+#endif
+
 static void mrInit()
 {
     if (isInit)
@@ -226,3 +337,10 @@ DECK_DRIVER(multiranger_deck);
 PARAM_GROUP_START(deck)
 PARAM_ADD(PARAM_UINT8 | PARAM_RONLY, bcMultiranger, &isInit)
 PARAM_GROUP_STOP(deck)
+
+#ifdef MULTIRANGER_CONTINUOUS_RANGING
+LOG_GROUP_START(mr)
+LOG_ADD(LOG_UINT16, ready, &readyCount)
+LOG_ADD(LOG_UINT16, timeout, &timeoutCount)
+LOG_GROUP_STOP(mr)
+#endif
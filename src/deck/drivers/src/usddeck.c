@@ -58,6 +58,7 @@
 #include "log.h"
 #include "param.h"
 #include "crc_bosch.h"
+#include "static_mem.h"
 
 // Hardware defines
 #define USD_CS_PIN    DECK_GPIO_IO4
@@ -110,6 +111,13 @@ static SemaphoreHandle_t logFileMutex;
 
 static QueueHandle_t usdLogQueue;
 static uint8_t* usdLogBufferStart;
+#ifdef STATIC_MEM
+// Storage for the log configuration, larger configurations are cut to fit
+#define USDLOG_STATIC_MAX_SLOTS 64
+#define USDLOG_STATIC_BUFFER_SIZE 4096
+static int usdLogVarIds[USDLOG_STATIC_MAX_SLOTS];
+static uint8_t usdLogStaticBuffer[USDLOG_STATIC_BUFFER_SIZE];
+#endif
 static uint8_t* usdLogBuffer;
 static TaskHandle_t xHandleWriteTask;
 
@@ -119,6 +127,8 @@ static uint32_t lastFileSize = 0;
 static xTimerHandle timer;
 static void usdTimer(xTimerHandle timer);
 
+STATIC_MEM_TASK_ALLOC(usdLogTask, USDLOG_TASK_STACKSIZE);
+
 
 // Low lever driver functions
 static sdSpiContext_t sdSpiContext =
@@ -321,12 +331,25 @@ static void usdInit(DeckInfo *info)
             DEBUG_PRINT("Unknown log variable %s.%s\n", group, name);
             continue;
           }
+#ifdef STATIC_MEM
+          if (usdLogConfig.numSlots >= USDLOG_STATIC_MAX_SLOTS) {
+            DEBUG_PRINT("Too many log variables, %s.%s skipped\n", group, name);
+            continue;
+          }
+#endif
 
           ++usdLogConfig.numSlots;
           usdLogConfig.numBytes += logVarSize(logGetType(varid));
         }
         f_close(&logFile);
 
+#ifdef STATIC_MEM
+        if (usdLogConfig.bufferSize * (4 + usdLogConfig.numBytes) > USDLOG_STATIC_BUFFER_SIZE) {
+          usdLogConfig.bufferSize = USDLOG_STATIC_BUFFER_SIZE / (4 + usdLogConfig.numBytes);
+          DEBUG_PRINT("Buffer size limited to %d\n", usdLogConfig.bufferSize);
+        }
+#endif
+
         DEBUG_PRINT("Config read [OK].\n");
         DEBUG_PRINT("Frequency: %dHz. Buffer size: %d\n",
                     usdLogConfig.frequency, usdLogConfig.bufferSize);
@@ -335,9 +358,8 @@ static void usdInit(DeckInfo *info)
         DEBUG_PRINT("slots: %d, %d\n", usdLogConfig.numSlots, usdLogConfig.numBytes);
 
         /* create usd-log task */
-        xTaskCreate(usdLogTask, USDLOG_TASK_NAME,
-                    USDLOG_TASK_STACKSIZE, NULL,
-                    USDLOG_TASK_PRI, NULL);
+        STATIC_MEM_TASK_CREATE(usdLogTask, usdLogTask, USDLOG_TASK_NAME, NULL,
+                               USDLOG_TASK_PRI, NULL);
 
         initSuccess = true;
         break;
@@ -366,7 +388,11 @@ static void usdLogTask(void* prm)
     vTaskDelayUntil(&lastWakeTime, F2T(10));
   }
 
+#ifdef STATIC_MEM
+  usdLogConfig.varIds = usdLogVarIds;
+#else
   usdLogConfig.varIds = pvPortMalloc(usdLogConfig.numSlots * sizeof(int));
+#endif
   DEBUG_PRINT("Free heap: %d bytes\n", xPortGetFreeHeapSize());
 
   // store logging variable ids
@@ -404,6 +430,9 @@ static void usdLogTask(void* prm)
         if (varid == -1) {
           continue;
         }
+        if (idx >= usdLogConfig.numSlots) {
+          break;
+        }
 
         usdLogConfig.varIds[idx++] = varid;
       }
@@ -415,8 +444,12 @@ static void usdLogTask(void* prm)
   /* allocate memory for buffer */
   DEBUG_PRINT("malloc buffer ...\n");
   // vTaskDelay(10); // small delay to allow debug message to be send
+#ifdef STATIC_MEM
+  usdLogBufferStart = usdLogStaticBuffer;
+#else
   usdLogBufferStart =
       pvPortMalloc(usdLogConfig.bufferSize * (4 + usdLogConfig.numBytes));
+#endif
   usdLogBuffer = usdLogBufferStart;
   DEBUG_PRINT("[OK].\n");
   DEBUG_PRINT("Free heap: %d bytes\n", xPortGetFreeHeapSize());
@@ -427,7 +460,8 @@ static void usdLogTask(void* prm)
   xHandleWriteTask = 0;
   enableLogging = usdLogConfig.enableOnStartup; // enable logging if desired
 
-  /* create usd-write task */
+  /* create usd-write task. It deletes itself on errors and can not have a
+   * static stack */
   xTaskCreate(usdWriteTask, USDWRITE_TASK_NAME,
               USDWRITE_TASK_STACKSIZE, usdLogQueue,
               USDWRITE_TASK_PRI, &xHandleWriteTask);
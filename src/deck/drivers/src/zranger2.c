@@ -140,7 +140,7 @@ void zRanger2Task(void* arg)
         range_last < RANGE_OUTLIER_LIMIT) {
       // Form measurement
       tofMeasurement_t tofData;
-      tofData.timestamp = xTaskGetTickCount();
+      tofData.timestamp = usecTimestamp();
       tofData.distance = (float)range_last * 0.001f; // Scale from [mm] to [m]
       tofData.stdDev = expStdA * (1.0f  + expf( expCoeff * ( tofData.distance - expPointA)));
       estimatorEnqueueTOF(&tofData);
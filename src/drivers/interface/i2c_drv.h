@@ -9,6 +9,11 @@
 
 #define I2C_NO_INTERNAL_ADDRESS   0xFFFF
 
+// Max number of pending messages per bus
+#ifndef I2CDRV_QUEUE_LENGTH
+#define I2CDRV_QUEUE_LENGTH       8
+#endif
+
 typedef enum
 {
   i2cAck,
@@ -21,6 +26,13 @@ typedef enum
   i2cRead
 } I2cDirection;
 
+struct _I2cMessage;
+
+/**
+ * Called from interrupt context when a message has been transferred.
+ */
+typedef void (*I2cMessageCallback)(struct _I2cMessage* message, void* callbackArg);
+
 /**
  * Structure used to capture the I2C message details.  The structure is then
  * queued for processing by the I2C ISR.
@@ -36,6 +48,8 @@ typedef struct _I2cMessage
   bool             isInternal16bit;   //< Is internal address 16 bit. If false 8 bit.
   uint16_t         internalAddress;   //< Internal address of device.
   uint8_t          *buffer;           //< Pointer to the buffer from where data will be read for transmission, or into which received data will be placed.
+  I2cMessageCallback callback;        //< Called when the message is done, may be NULL.
+  void             *callbackArg;      //< Argument passed to the callback.
 } I2cMessage;
 
 typedef struct
@@ -63,6 +77,20 @@ typedef struct
 
 } I2cDef;
 
+typedef struct
+{
+  uint32_t windowStartUs;               //< Start of the current statistics window
+  uint32_t busyStartUs;                 //< Start of the current busy period
+  uint32_t busyUs;                      //< Busy time in the current window
+  uint16_t transfersInWindow;           //< Messages done in the current window
+  uint8_t maxDepthInWindow;             //< Max queue depth in the current window
+
+  uint8_t utilization;                  //< Percent of the last window the bus was busy
+  uint8_t maxQueueDepth;                //< Max number of pending messages in the last window
+  uint16_t transferRate;                //< Messages per second in the last window
+  uint16_t queueFullCount;              //< Number of messages rejected since start
+} I2cStats;
+
 typedef struct
 {
   const I2cDef *def;                    //< Definition of the i2c
@@ -72,6 +100,12 @@ typedef struct
   SemaphoreHandle_t isBusFreeSemaphore; //< Semaphore to block during transaction.
   SemaphoreHandle_t isBusFreeMutex;     //< Mutex to protect buss
   DMA_InitTypeDef DMAStruct;            //< DMA configuration structure used during transfer setup.
+  I2cMessage* queue[I2CDRV_QUEUE_LENGTH]; //< Pending messages, the first one is on the bus.
+  uint8_t queueFirst;                   //< Index of the message on the bus.
+  uint8_t queueCount;                   //< Number of pending messages, 0 when the bus is idle.
+  uint32_t transferCount;               //< Number of messages started, identifies the message on the bus.
+  uint32_t transferStartTick;           //< Tick count when the message on the bus was started.
+  I2cStats stats;                       //< Bus statistics.
 } I2cDrv;
 
 // Definitions of i2c busses found in c file.
@@ -95,6 +129,31 @@ void i2cdrvInit(I2cDrv* i2c);
  */
 bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message);
 
+/**
+ * Queue a message for transfer over the I2C bus without blocking.
+ *
+ * Messages are transferred in order, the next one is started from the interrupt
+ * that finishes the previous one with a repeated start. A message that has not
+ * finished within a second is failed and the bus is restarted. The message and its buffer must stay valid
+ * until the callback has been called. The message status is updated before the
+ * callback is called. Must not be called from the callback.
+ *
+ * @param i2c          i2c bus to use.
+ * @param message      An I2cMessage struct containing all the i2c message
+ *                     Information.
+ * @param callback     Called from interrupt context when the message is done, may be NULL.
+ * @param callbackArg  Argument passed to the callback.
+ * @return             true if the message was queued, false if the queue is full.
+ */
+bool i2cdrvMessageTransferAsync(I2cDrv* i2c, I2cMessage* message,
+                                I2cMessageCallback callback, void* callbackArg);
+
+/**
+ * Message callback notifying a task. Pass the TaskHandle_t as callbackArg and
+ * wait for the message with ulTaskNotifyTake().
+ */
+void i2cdrvNotifyTaskCallback(I2cMessage* message, void* callbackArg);
+
 
 /**
  * Create a message to transfer
@@ -44,6 +44,14 @@
 #define UART1_DMA_CH           DMA_Channel_4
 #define UART1_DMA_FLAG_TCIF    DMA_FLAG_TCIF3
 
+#define UART1_RX_DMA_IRQ       DMA1_Stream1_IRQn
+#define UART1_RX_DMA_STREAM    DMA1_Stream1
+#define UART1_RX_DMA_CH        DMA_Channel_4
+#define UART1_RX_DMA_IT_HT     DMA_IT_HTIF1
+#define UART1_RX_DMA_IT_TC     DMA_IT_TCIF1
+#define UART1_RX_DMA_FLAG_TC   DMA_FLAG_TCIF1
+#define UART1_RX_DMA_BUFFER_SIZE 512
+
 #define UART1_GPIO_PERIF       RCC_AHB1Periph_GPIOC
 #define UART1_GPIO_PORT        GPIOC
 #define UART1_GPIO_TX_PIN      GPIO_Pin_10
@@ -98,6 +106,28 @@ int uart1Putchar(int ch);
 
 void uart1Getchar(char * ch);
 
+/**
+ * Switch reception from the per byte interrupt and queue to a circular DMA
+ * ring. DMA1 stream 1 is used, which does not conflict with the SPI2 DMA of
+ * the BMI088 sensors. The reader is woken on idle line and on every half ring.
+ * Must be called after uart1Init(). uart1Getchar() and uart1GetDataWithTimout()
+ * receive no data once it is enabled.
+ */
+void uart1EnableRxDma(void);
+
+/**
+ * Block until there is received data in the DMA ring.
+ *
+ * @param[out] data  Set to the start of the received data in the ring
+ * @return Number of contiguous bytes available at data. The bytes are released
+ *         by the call and must be processed before the DMA wraps around to them.
+ *
+ * If the DMA has written more than a full ring since the last call the unread
+ * data is dropped, reading restarts at the current write position and
+ * uart1DidOverrun() returns true.
+ */
+uint32_t uart1GetDataDma(const uint8_t** data);
+
 /**
  * Returns true if an overrun condition has happened since initialization or
  * since the last call to this function.
@@ -29,6 +29,7 @@
 
 #include "exti.h"
 #include "nvicconf.h"
+#include "irq_profile.h"
 #include "nrf24l01.h"
 
 static bool isInit;
@@ -91,36 +92,58 @@ bool extiTest(void)
 
 void __attribute__((used)) EXTI0_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   EXTI_ClearITPendingBit(EXTI_Line0);
   EXTI0_Callback();
+
+  IRQ_PROFILE_EXIT(irqProfileExti0);
 }
 
 void __attribute__((used)) EXTI1_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   EXTI_ClearITPendingBit(EXTI_Line1);
   EXTI1_Callback();
+
+  IRQ_PROFILE_EXIT(irqProfileExti1);
 }
 
 void __attribute__((used)) EXTI2_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   EXTI_ClearITPendingBit(EXTI_Line2);
   EXTI2_Callback();
+
+  IRQ_PROFILE_EXIT(irqProfileExti2);
 }
 
 void __attribute__((used)) EXTI3_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   EXTI_ClearITPendingBit(EXTI_Line3);
   EXTI3_Callback();
+
+  IRQ_PROFILE_EXIT(irqProfileExti3);
 }
 
 void __attribute__((used)) EXTI4_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   EXTI_ClearITPendingBit(EXTI_Line4);
   EXTI4_Callback();
+
+  IRQ_PROFILE_EXIT(irqProfileExti4);
 }
 
 void __attribute__((used)) EXTI9_5_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   if (EXTI_GetITStatus(EXTI_Line5) == SET) {
     EXTI_ClearITPendingBit(EXTI_Line5);
     EXTI5_Callback();
@@ -145,10 +168,14 @@ void __attribute__((used)) EXTI9_5_IRQHandler(void)
     EXTI_ClearITPendingBit(EXTI_Line9);
     EXTI9_Callback();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileExti9_5);
 }
 
 void __attribute__((used)) EXTI15_10_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   if (EXTI_GetITStatus(EXTI_Line10) == SET) {
     EXTI_ClearITPendingBit(EXTI_Line10);
     EXTI10_Callback();
@@ -178,6 +205,8 @@ void __attribute__((used)) EXTI15_10_IRQHandler(void)
     EXTI_ClearITPendingBit(EXTI_Line15);
     EXTI15_Callback();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileExti15_10);
 }
 
 void __attribute__((weak)) EXTI0_Callback(void) { }
@@ -41,17 +41,16 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "timers.h"
 
 #include "stm32fxxx.h"
 // Application includes.
 #include "i2c_drv.h"
 #include "config.h"
 #include "nvicconf.h"
-
-//DEBUG
-#ifdef I2CDRV_DEBUG_LOG_EVENTS
 #include "usec_time.h"
-#endif
+#include "irq_profile.h"
+#include "log.h"
 
 // Definitions of sensors I2C bus
 #define I2C_DEFAULT_SENSORS_CLOCK_SPEED             400000
@@ -64,6 +63,8 @@
 #define I2C_SLAVE_ADDRESS7      0x30
 #define I2C_MAX_RETRIES         2
 #define I2C_MESSAGE_TIMEOUT     M2T(1000)
+#define I2C_WATCHDOG_PERIOD     M2T(100)
+#define I2C_STATS_WINDOW_US     1000000
 
 // Delay is approx 0.06us per loop @168Mhz
 #define I2CDEV_LOOPS_PER_US  17
@@ -191,6 +192,8 @@ I2cDrv deckBus =
   .def                = &deckBusDef,
 };
 
+static xTimerHandle watchdogTimer;
+
 
 static inline void i2cdrvRoughLoopDelay(uint32_t us)
 {
@@ -213,16 +216,97 @@ static void i2cdrvStartTransfer(I2cDrv *i2c)
   i2c->def->i2cPort->CR1 = (I2C_CR1_START | I2C_CR1_PE);
 }
 
+static void i2cdrvStartNextMessage(I2cDrv *i2c)
+{
+  memcpy((char*)&i2c->txMessage, (char*)i2c->queue[i2c->queueFirst], sizeof(I2cMessage));
+  i2c->transferCount++;
+  i2c->transferStartTick = xTaskGetTickCountFromISR();
+  i2cdrvStartTransfer(i2c);
+}
+
+static void i2cdrvUpdateStats(I2cDrv* i2c)
+{
+  I2cStats* stats = &i2c->stats;
+  const uint32_t now = usecTimestamp();
+  const uint32_t window = now - stats->windowStartUs;
+
+  if (window >= I2C_STATS_WINDOW_US)
+  {
+    uint32_t busyUs = stats->busyUs;
+    if (i2c->queueCount > 0)
+    {
+      busyUs += now - stats->busyStartUs;
+      stats->busyStartUs = now;
+    }
+
+    stats->utilization = (uint64_t)busyUs * 100 / window;
+    stats->transferRate = (uint64_t)stats->transfersInWindow * 1000000 / window;
+    stats->maxQueueDepth = stats->maxDepthInWindow;
+
+    stats->busyUs = 0;
+    stats->transfersInWindow = 0;
+    stats->maxDepthInWindow = i2c->queueCount;
+    stats->windowStartUs = now;
+  }
+}
+
+/**
+ * Finish the message on the bus and start the next one, if any. Called from
+ * interrupt context or from a critical section.
+ */
+static void i2cdrvCompleteMessage(I2cDrv* i2c)
+{
+  I2cMessage* message = i2c->queue[i2c->queueFirst];
+  message->status = i2c->txMessage.status;
+
+  i2c->queueFirst = (i2c->queueFirst + 1) % I2CDRV_QUEUE_LENGTH;
+  i2c->queueCount--;
+  i2c->stats.transfersInWindow++;
+
+  if (i2c->queueCount > 0)
+  {
+    i2cdrvStartNextMessage(i2c);
+  }
+  else
+  {
+    i2c->stats.busyUs += usecTimestamp() - i2c->stats.busyStartUs;
+  }
+
+  if (message->callback)
+  {
+    message->callback(message, message->callbackArg);
+  }
+
+  i2cdrvUpdateStats(i2c);
+}
+
+/**
+ * End the message on the bus. If more messages are queued the next one is
+ * chained with a repeated start and continues from its start bit event,
+ * otherwise a stop is generated. This way the ISR never has to wait for a
+ * stop condition to finish before it can set the start bit.
+ */
 static void i2cTryNextMessage(I2cDrv* i2c)
 {
-  i2c->def->i2cPort->CR1 = (I2C_CR1_STOP | I2C_CR1_PE);
-  I2C_ITConfig(i2c->def->i2cPort, I2C_IT_EVT | I2C_IT_BUF, DISABLE);
+  if (i2c->queueCount <= 1)
+  {
+    i2c->def->i2cPort->CR1 = (I2C_CR1_STOP | I2C_CR1_PE);
+    I2C_ITConfig(i2c->def->i2cPort, I2C_IT_EVT | I2C_IT_BUF, DISABLE);
+  }
+  i2cdrvCompleteMessage(i2c);
 }
 
-static void i2cNotifyClient(I2cDrv* i2c)
+static void i2cdrvGiveSemaphoreCallback(I2cMessage* message, void* callbackArg)
 {
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-  xSemaphoreGiveFromISR(i2c->isBusFreeSemaphore, &xHigherPriorityTaskWoken);
+  xSemaphoreGiveFromISR((SemaphoreHandle_t)callbackArg, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void i2cdrvNotifyTaskCallback(I2cMessage* message, void* callbackArg)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR((TaskHandle_t)callbackArg, &xHigherPriorityTaskWoken);
   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
@@ -231,6 +315,65 @@ static void i2cdrvTryToRestartBus(I2cDrv* i2c)
   i2cdrvInitBus(i2c);
 }
 
+/**
+ * Fail the message on the bus if it was started more than I2C_MESSAGE_TIMEOUT
+ * ago, restart the bus and go on with the rest of the queue. Messages are
+ * identified by transferCount, a message that finishes while it is checked is
+ * left alone.
+ */
+static void i2cdrvCheckTimeout(I2cDrv* i2c)
+{
+  if (i2c->isBusFreeMutex == NULL)
+  {
+    // Bus not initialized
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  const bool isTimedOut = (i2c->queueCount > 0) &&
+                          (xTaskGetTickCount() - i2c->transferStartTick > I2C_MESSAGE_TIMEOUT);
+  const uint32_t timedOutTransfer = i2c->transferCount;
+  taskEXIT_CRITICAL();
+
+  if (!isTimedOut)
+  {
+    return;
+  }
+
+  // The ISRs can not finish or start messages while these are disabled
+  NVIC_DisableIRQ(i2c->def->i2cEVIRQn);
+  NVIC_DisableIRQ(i2c->def->i2cERIRQn);
+  NVIC_DisableIRQ(i2c->def->dmaRxIRQ);
+
+  if (i2c->queueCount == 0 || i2c->transferCount != timedOutTransfer)
+  {
+    // The message finished after all
+    NVIC_EnableIRQ(i2c->def->i2cEVIRQn);
+    NVIC_EnableIRQ(i2c->def->i2cERIRQn);
+    NVIC_EnableIRQ(i2c->def->dmaRxIRQ);
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  i2cdrvClearDMA(i2c);
+  taskEXIT_CRITICAL();
+
+  // Enables the interrupts again. Nothing is on the bus after the restart,
+  // so the message at the head of the queue stays there.
+  i2cdrvTryToRestartBus(i2c);
+
+  taskENTER_CRITICAL();
+  i2c->txMessage.status = i2cNack;
+  i2cdrvCompleteMessage(i2c);
+  taskEXIT_CRITICAL();
+}
+
+static void i2cdrvWatchdogTimer(xTimerHandle timer)
+{
+  i2cdrvCheckTimeout(&sensorsBus);
+  i2cdrvCheckTimeout(&deckBus);
+}
+
 static void i2cdrvDmaSetupBus(I2cDrv* i2c)
 {
 
@@ -319,9 +462,6 @@ static void i2cdrvInitBus(I2cDrv* i2c)
   NVIC_Init(&NVIC_InitStructure);
 
   i2cdrvDmaSetupBus(i2c);
-
-  i2c->isBusFreeSemaphore = xSemaphoreCreateBinary();
-  i2c->isBusFreeMutex = xSemaphoreCreateMutex();
 }
 
 static void i2cdrvdevUnlockBus(GPIO_TypeDef* portSCL, GPIO_TypeDef* portSDA, uint16_t pinSCL, uint16_t pinSDA)
@@ -363,6 +503,20 @@ static void i2cdrvdevUnlockBus(GPIO_TypeDef* portSCL, GPIO_TypeDef* portSDA, uin
 
 void i2cdrvInit(I2cDrv* i2c)
 {
+  // Several drivers initialize the same bus, only create the semaphores once
+  if (i2c->isBusFreeMutex == NULL)
+  {
+    i2c->isBusFreeSemaphore = xSemaphoreCreateBinary();
+    i2c->isBusFreeMutex = xSemaphoreCreateMutex();
+  }
+
+  // One timer fails hanged messages on all busses
+  if (watchdogTimer == NULL)
+  {
+    watchdogTimer = xTimerCreate("i2cWatchdog", I2C_WATCHDOG_PERIOD, pdTRUE, NULL, i2cdrvWatchdogTimer);
+    xTimerStart(watchdogTimer, 100);
+  }
+
   i2cdrvInitBus(i2c);
 }
 
@@ -380,6 +534,8 @@ void i2cdrvCreateMessage(I2cMessage *message,
   message->status = i2cAck;
   message->buffer = buffer;
   message->nbrOfRetries = I2C_MAX_RETRIES;
+  message->callback = NULL;
+  message->callbackArg = NULL;
 }
 
 void i2cdrvCreateMessageIntAddr(I2cMessage *message,
@@ -398,30 +554,62 @@ void i2cdrvCreateMessageIntAddr(I2cMessage *message,
   message->status = i2cAck;
   message->buffer = buffer;
   message->nbrOfRetries = I2C_MAX_RETRIES;
+  message->callback = NULL;
+  message->callbackArg = NULL;
 }
 
-bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message)
+bool i2cdrvMessageTransferAsync(I2cDrv* i2c, I2cMessage* message,
+                                I2cMessageCallback callback, void* callbackArg)
 {
-  bool status = false;
+  bool queued = false;
 
-  xSemaphoreTake(i2c->isBusFreeMutex, portMAX_DELAY); // Protect message data
-  // Copy message
-  memcpy((char*)&i2c->txMessage, (char*)message, sizeof(I2cMessage));
-  // We can now start the ISR sending this message.
-  i2cdrvStartTransfer(i2c);
-  // Wait for transaction to be done
-  if (xSemaphoreTake(i2c->isBusFreeSemaphore, I2C_MESSAGE_TIMEOUT) == pdTRUE)
+  message->callback = callback;
+  message->callbackArg = callbackArg;
+
+  taskENTER_CRITICAL();
+  if (i2c->queueCount < I2CDRV_QUEUE_LENGTH)
   {
-    if (i2c->txMessage.status == i2cAck)
+    const uint8_t index = (i2c->queueFirst + i2c->queueCount) % I2CDRV_QUEUE_LENGTH;
+    i2c->queue[index] = message;
+    i2c->queueCount++;
+    if (i2c->queueCount > i2c->stats.maxDepthInWindow)
     {
-      status = true;
+      i2c->stats.maxDepthInWindow = i2c->queueCount;
     }
+
+    if (i2c->queueCount == 1)
+    {
+      // Bus is idle, start right away. Otherwise the ISR chains it.
+      i2c->stats.busyStartUs = usecTimestamp();
+      i2cdrvStartNextMessage(i2c);
+    }
+    queued = true;
   }
   else
   {
-    i2cdrvClearDMA(i2c);
-    i2cdrvTryToRestartBus(i2c);
-    //TODO: If bus is really hanged... fail safe
+    i2c->stats.queueFullCount++;
+  }
+  taskEXIT_CRITICAL();
+
+  return queued;
+}
+
+bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message)
+{
+  bool status = false;
+
+  xSemaphoreTake(i2c->isBusFreeMutex, portMAX_DELAY); // One blocking client at a time
+  while (!i2cdrvMessageTransferAsync(i2c, message, i2cdrvGiveSemaphoreCallback, i2c->isBusFreeSemaphore))
+  {
+    // Queue full of asynchronous messages
+    vTaskDelay(1);
+  }
+  // Wait for transaction to be done. A hanged message is failed by the
+  // watchdog timer, which gives the semaphore through the callback.
+  xSemaphoreTake(i2c->isBusFreeSemaphore, portMAX_DELAY);
+  if (message->status == i2cAck)
+  {
+    status = true;
   }
   xSemaphoreGive(i2c->isBusFreeMutex);
 
@@ -519,7 +707,6 @@ static void i2cdrvEventIsrHandler(I2cDrv* i2c)
       }
       else
       {
-        i2cNotifyClient(i2c);
         // Are there any other messages to transact? If so stop else repeated start.
         i2cTryNextMessage(i2c);
       }
@@ -530,13 +717,12 @@ static void i2cdrvEventIsrHandler(I2cDrv* i2c)
       i2c->txMessage.buffer[i2c->messageIndex++] = I2C_ReceiveData(i2c->def->i2cPort);
       if(i2c->messageIndex == i2c->txMessage.messageLength)
       {
-        i2cNotifyClient(i2c);
         // Are there any other messages to transact?
         i2cTryNextMessage(i2c);
       }
     }
-    // A second BTF interrupt might occur if we don't wait for it to clear.
-    // TODO Implement better method.
+    // A second BTF interrupt might occur if we don't wait for the (repeated)
+    // start to be generated. TODO Implement better method.
     while (i2c->def->i2cPort->CR1 & 0x0100) { ; }
   }
   // Byte received
@@ -583,7 +769,6 @@ static void i2cdrvErrorIsrHandler(I2cDrv* i2c)
     {
       // Failed so notify client and try next message if any.
       i2c->txMessage.status = i2cNack;
-      i2cNotifyClient(i2c);
       i2cTryNextMessage(i2c);
     }
     I2C_ClearFlag(i2c->def->i2cPort, I2C_FLAG_AF);
@@ -616,16 +801,15 @@ static void i2cdrvDmaIsrHandler(I2cDrv* i2c)
   if (DMA_GetFlagStatus(i2c->def->dmaRxStream, i2c->def->dmaRxTCFlag)) // Tranasfer complete
   {
     i2cdrvClearDMA(i2c);
-    i2cNotifyClient(i2c);
     // Are there any other messages to transact?
     i2cTryNextMessage(i2c);
   }
   if (DMA_GetFlagStatus(i2c->def->dmaRxStream, i2c->def->dmaRxTEFlag)) // Transfer error
   {
     DMA_ClearITPendingBit(i2c->def->dmaRxStream, i2c->def->dmaRxTEFlag);
+    i2cdrvClearDMA(i2c);
     //TODO: Best thing we could do?
     i2c->txMessage.status = i2cNack;
-    i2cNotifyClient(i2c);
     i2cTryNextMessage(i2c);
   }
 }
@@ -633,31 +817,53 @@ static void i2cdrvDmaIsrHandler(I2cDrv* i2c)
 
 void __attribute__((used)) I2C1_ER_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvErrorIsrHandler(&deckBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c1Er);
 }
 
 void __attribute__((used)) I2C1_EV_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvEventIsrHandler(&deckBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c1Ev);
 }
 
 void __attribute__((used)) DMA1_Stream0_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvDmaIsrHandler(&deckBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c1Dma);
 }
 
 void __attribute__((used)) I2C3_ER_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvErrorIsrHandler(&sensorsBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c3Er);
 }
 
 void __attribute__((used)) I2C3_EV_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvEventIsrHandler(&sensorsBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c3Ev);
 }
 
 void __attribute__((used)) DMA1_Stream2_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   i2cdrvDmaIsrHandler(&sensorsBus);
+  IRQ_PROFILE_EXIT(irqProfileI2c3Dma);
 }
 
+LOG_GROUP_START(i2c)
+LOG_ADD(LOG_UINT8, deckUtil, &deckBus.stats.utilization)
+LOG_ADD(LOG_UINT8, deckQMax, &deckBus.stats.maxQueueDepth)
+LOG_ADD(LOG_UINT16, deckRate, &deckBus.stats.transferRate)
+LOG_ADD(LOG_UINT16, deckQFull, &deckBus.stats.queueFullCount)
+LOG_ADD(LOG_UINT8, sensUtil, &sensorsBus.stats.utilization)
+LOG_ADD(LOG_UINT8, sensQMax, &sensorsBus.stats.maxQueueDepth)
+LOG_ADD(LOG_UINT16, sensRate, &sensorsBus.stats.transferRate)
+LOG_ADD(LOG_UINT16, sensQFull, &sensorsBus.stats.queueFullCount)
+LOG_GROUP_STOP(i2c)
@@ -41,6 +41,8 @@
 #include "cfassert.h"
 #include "config.h"
 #include "nvicconf.h"
+#include "irq_profile.h"
+#include "log.h"
 
 /** This uart is conflicting with SPI2 DMA used in sensors_bmi088_spi_bmp388.c
  *  which is used in CF-RZR. So for other products this can be enabled.
@@ -52,6 +54,15 @@ static xQueueHandle uart1queue;
 static bool isInit = false;
 static bool hasOverrun = false;
 
+static xSemaphoreHandle rxDmaDataAvailable;
+static uint8_t rxDmaBuffer[UART1_RX_DMA_BUFFER_SIZE];
+// Byte counts since uart1EnableRxDma(), wrapping at 2^32 which is a multiple
+// of the ring size
+static uint32_t rxDmaReadCount;
+static volatile uint32_t rxDmaWrapCount;
+static uint32_t rxDmaOverrunCount;
+static bool isRxDmaEnabled = false;
+
 #ifdef ENABLE_UART1_DMA
 static xSemaphoreHandle uartBusy;
 static xSemaphoreHandle waitUntilSendDone;
@@ -230,6 +241,109 @@ void uart1Getchar(char * ch)
   xQueueReceive(uart1queue, ch, portMAX_DELAY);
 }
 
+void uart1EnableRxDma(void)
+{
+  DMA_InitTypeDef DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  if (!isInit || isRxDmaEnabled)
+    return;
+
+  rxDmaDataAvailable = xSemaphoreCreateBinary();
+  rxDmaReadCount = 0;
+  rxDmaWrapCount = 0;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  // USART RX DMA Channel Config, circular over the whole ring
+  DMA_DeInit(UART1_RX_DMA_STREAM);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&UART1_TYPE->DR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)rxDmaBuffer;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_BufferSize = UART1_RX_DMA_BUFFER_SIZE;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+  DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_1QuarterFull;
+  DMA_InitStructure.DMA_Channel = UART1_RX_DMA_CH;
+  DMA_Init(UART1_RX_DMA_STREAM, &DMA_InitStructure);
+  DMA_ITConfig(UART1_RX_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = UART1_RX_DMA_IRQ;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_MID_PRI;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  USART_ITConfig(UART1_TYPE, USART_IT_RXNE, DISABLE);
+  isRxDmaEnabled = true;
+  USART_ITConfig(UART1_TYPE, USART_IT_IDLE, ENABLE);
+  USART_DMACmd(UART1_TYPE, USART_DMAReq_Rx, ENABLE);
+  DMA_Cmd(UART1_RX_DMA_STREAM, ENABLE);
+}
+
+/**
+ * Total number of bytes written by the DMA. A wrap that the transfer complete
+ * interrupt has not counted yet is still pending in the TC flag.
+ */
+static uint32_t rxDmaGetWriteCount(void)
+{
+  uint32_t wraps;
+  uint32_t remaining;
+  uint32_t pendingWrap;
+
+  do
+  {
+    wraps = rxDmaWrapCount;
+    remaining = DMA_GetCurrDataCounter(UART1_RX_DMA_STREAM);
+    pendingWrap = (DMA_GetFlagStatus(UART1_RX_DMA_STREAM, UART1_RX_DMA_FLAG_TC) == SET) ? 1 : 0;
+  } while (wraps != rxDmaWrapCount);
+
+  return (wraps + pendingWrap) * UART1_RX_DMA_BUFFER_SIZE + (UART1_RX_DMA_BUFFER_SIZE - remaining);
+}
+
+uint32_t uart1GetDataDma(const uint8_t** data)
+{
+  uint32_t writeCount;
+
+  while ((writeCount = rxDmaGetWriteCount()) == rxDmaReadCount)
+  {
+    xSemaphoreTake(rxDmaDataAvailable, portMAX_DELAY);
+  }
+
+  if (writeCount - rxDmaReadCount > UART1_RX_DMA_BUFFER_SIZE)
+  {
+    // The DMA has lapped the reader, the unread data is partly overwritten
+    rxDmaReadCount = writeCount;
+    rxDmaOverrunCount++;
+    hasOverrun = true;
+
+    while ((writeCount = rxDmaGetWriteCount()) == rxDmaReadCount)
+    {
+      xSemaphoreTake(rxDmaDataAvailable, portMAX_DELAY);
+    }
+  }
+
+  // Only hand out the contiguous part, the rest is returned by the next call
+  uint32_t readIndex = rxDmaReadCount % UART1_RX_DMA_BUFFER_SIZE;
+  uint32_t count = writeCount - rxDmaReadCount;
+  if (count > UART1_RX_DMA_BUFFER_SIZE - readIndex)
+  {
+    count = UART1_RX_DMA_BUFFER_SIZE - readIndex;
+  }
+
+  *data = &rxDmaBuffer[readIndex];
+  rxDmaReadCount += count;
+
+  return count;
+}
+
 bool uart1DidOverrun()
 {
   bool result = hasOverrun;
@@ -253,12 +367,46 @@ void __attribute__((used)) DMA1_Stream3_IRQHandler(void)
 }
 #endif
 
+void __attribute__((used)) DMA1_Stream1_IRQHandler(void)
+{
+  IRQ_PROFILE_ENTER();
+
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+  if (DMA_GetITStatus(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_HT))
+  {
+    DMA_ClearITPendingBit(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_HT);
+  }
+  if (DMA_GetITStatus(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_TC))
+  {
+    // Count the wrap before clearing the flag, see rxDmaGetWriteCount()
+    rxDmaWrapCount++;
+    DMA_ClearITPendingBit(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_TC);
+  }
+
+  xSemaphoreGiveFromISR(rxDmaDataAvailable, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+  IRQ_PROFILE_EXIT(irqProfileUart1RxDma);
+}
+
 void __attribute__((used)) USART3_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   uint8_t rxData;
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-  if (USART_GetITStatus(UART1_TYPE, USART_IT_RXNE))
+  if (isRxDmaEnabled && USART_GetITStatus(UART1_TYPE, USART_IT_IDLE))
+  {
+    // The IDLE flag is cleared by reading SR followed by DR
+    asm volatile ("" : "=m" (UART1_TYPE->SR) : "r" (UART1_TYPE->SR));
+    asm volatile ("" : "=m" (UART1_TYPE->DR) : "r" (UART1_TYPE->DR));
+
+    xSemaphoreGiveFromISR(rxDmaDataAvailable, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  }
+  else if (USART_GetITStatus(UART1_TYPE, USART_IT_RXNE))
   {
     rxData = USART_ReceiveData(UART1_TYPE) & 0x00FF;
     xQueueSendFromISR(uart1queue, &rxData, &xHigherPriorityTaskWoken);
@@ -273,4 +421,10 @@ void __attribute__((used)) USART3_IRQHandler(void)
 
     hasOverrun = true;
   }
+
+  IRQ_PROFILE_EXIT(irqProfileUart1);
 }
+
+LOG_GROUP_START(uart1)
+LOG_ADD(LOG_UINT32, dmaOverrun, &rxDmaOverrunCount)
+LOG_GROUP_STOP(uart1)
@@ -39,6 +39,7 @@
 #include "cfassert.h"
 #include "config.h"
 #include "nvicconf.h"
+#include "irq_profile.h"
 
 
 static xQueueHandle uart2queue;
@@ -242,6 +243,8 @@ void __attribute__((used)) DMA1_Stream6_IRQHandler(void)
 
 void __attribute__((used)) USART2_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   uint8_t rxData;
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
@@ -262,4 +265,6 @@ void __attribute__((used)) USART2_IRQHandler(void)
 
     hasOverrun = true;
   }
+
+  IRQ_PROFILE_EXIT(irqProfileUart2);
 }
@@ -42,6 +42,7 @@
 #include "nvicconf.h"
 #include "config.h"
 #include "queuemonitor.h"
+#include "irq_profile.h"
 
 
 #define UARTSLK_DATA_TIMEOUT_MS 1000
@@ -454,10 +455,14 @@ void __attribute__((used)) EXTI4_Callback(void)
 
 void __attribute__((used)) USART6_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   uartslkIsr();
+  IRQ_PROFILE_EXIT(irqProfileSyslinkUart);
 }
 
 void __attribute__((used)) DMA2_Stream7_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
   uartslkDmaIsr();
+  IRQ_PROFILE_EXIT(irqProfileSyslinkDma);
 }
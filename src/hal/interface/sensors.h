@@ -53,6 +53,20 @@ bool sensorsReadAcc(Axis3f *acc);
 bool sensorsReadMag(Axis3f *mag);
 bool sensorsReadBaro(baro_t *baro);
 
+/**
+ * Microsecond timestamp of the IMU interrupt behind the latest gyro and acc
+ * samples. Returns false if there is no new timestamp or the driver does not
+ * provide one.
+ */
+bool sensorsReadImuTimestamp(uint64_t *timestamp);
+
+/**
+ * Latest gyro sample and its interrupt timestamp, without consuming them
+ * from the queues read by the estimator. Used by the fast rate loop. Returns
+ * false if no sample is available or the driver does not support it.
+ */
+bool sensorsPeekGyro(Axis3f *gyro, uint64_t *timestamp);
+
 /**
  * Set acc mode, one of accModes enum
  */
@@ -38,6 +38,8 @@ bool sensorsBmi088Bmp388ReadGyro(Axis3f *gyro);
 bool sensorsBmi088Bmp388ReadAcc(Axis3f *acc);
 bool sensorsBmi088Bmp388ReadMag(Axis3f *mag);
 bool sensorsBmi088Bmp388ReadBaro(baro_t *baro);
+bool sensorsBmi088Bmp388ReadImuTimestamp(uint64_t *timestamp);
+bool sensorsBmi088Bmp388PeekGyro(Axis3f *gyro, uint64_t *timestamp);
 void sensorsBmi088Bmp388SetAccMode(accModes accMode);
 void sensorsBmi088Bmp388DataAvailableCallback(void);
 
@@ -38,6 +38,8 @@ bool sensorsBmi088SpiBmp388ReadGyro(Axis3f *gyro);
 bool sensorsBmi088SpiBmp388ReadAcc(Axis3f *acc);
 bool sensorsBmi088SpiBmp388ReadMag(Axis3f *mag);
 bool sensorsBmi088SpiBmp388ReadBaro(baro_t *baro);
+bool sensorsBmi088SpiBmp388ReadImuTimestamp(uint64_t *timestamp);
+bool sensorsBmi088SpiBmp388PeekGyro(Axis3f *gyro, uint64_t *timestamp);
 void sensorsBmi088SpiBmp388SetAccMode(accModes accMode);
 void sensorsBmi088SpiBmp388DataAvailableCallback(void);
 
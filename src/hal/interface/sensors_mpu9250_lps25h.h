@@ -38,6 +38,8 @@ bool sensorsMpu9250Lps25hReadGyro(Axis3f *gyro);
 bool sensorsMpu9250Lps25hReadAcc(Axis3f *acc);
 bool sensorsMpu9250Lps25hReadMag(Axis3f *mag);
 bool sensorsMpu9250Lps25hReadBaro(baro_t *baro);
+bool sensorsMpu9250Lps25hReadImuTimestamp(uint64_t *timestamp);
+bool sensorsMpu9250Lps25hPeekGyro(Axis3f *gyro, uint64_t *timestamp);
 void sensorsMpu9250Lps25hSetAccMode(accModes accMode);
 
 #endif // __SENSORS_MPU9250_LPS25H_H__
\ No newline at end of file
@@ -41,6 +41,7 @@
 #include "commander.h"
 #include "sound.h"
 #include "deck.h"
+#include "static_mem.h"
 
 typedef struct _PmSyslinkInfo
 {
@@ -95,13 +96,14 @@ const static float bat671723HS25C[10] =
   4.10  // 90%
 };
 
+STATIC_MEM_TASK_ALLOC(pmTask, PM_TASK_STACKSIZE);
+
 void pmInit(void)
 {
   if(isInit)
     return;
   
-  xTaskCreate(pmTask, PM_TASK_NAME,
-              PM_TASK_STACKSIZE, NULL, PM_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(pmTask, pmTask, PM_TASK_NAME, NULL, PM_TASK_PRI, NULL);
   
   isInit = true;
 
@@ -35,6 +35,7 @@
 #include "system.h"
 #include "param.h"
 #include "log.h"
+#include "static_mem.h"
 
 #include "stm32fxxx.h"
 
@@ -160,6 +161,10 @@ static void proximityTask(void* param)
 }
 #endif
 
+#if defined(PROXIMITY_ENABLED)
+STATIC_MEM_TASK_ALLOC(proximityTask, PROXIMITY_TASK_STACKSIZE);
+#endif
+
 /**
  * Initialization of the proximity task.
  */
@@ -173,8 +178,7 @@ void proximityInit(void)
 
 #if defined(PROXIMITY_ENABLED)
   /* Only start the task if the proximity subsystem is enabled in conf.h */
-  xTaskCreate(proximityTask, PROXIMITY_TASK_NAME,
-              PROXIMITY_TASK_STACKSIZE, NULL, PROXIMITY_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(proximityTask, proximityTask, PROXIMITY_TASK_NAME, NULL, PROXIMITY_TASK_PRI, NULL);
 #endif
 
   isInit = true;
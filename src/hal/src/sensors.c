@@ -64,6 +64,8 @@ typedef struct {
   bool (*readAcc)(Axis3f *acc);
   bool (*readMag)(Axis3f *mag);
   bool (*readBaro)(baro_t *baro);
+  bool (*readImuTimestamp)(uint64_t *timestamp);
+  bool (*peekGyro)(Axis3f *gyro, uint64_t *timestamp);
   void (*setAccMode)(accModes accMode);
   void (*dataAvailableCallback)(void);
 } sensorsImplementation_t;
@@ -87,6 +89,8 @@ static const sensorsImplementation_t sensorImplementations[SensorImplementation_
     .readAcc = sensorsBmi088Bmp388ReadAcc,
     .readMag = sensorsBmi088Bmp388ReadMag,
     .readBaro = sensorsBmi088Bmp388ReadBaro,
+    .readImuTimestamp = sensorsBmi088Bmp388ReadImuTimestamp,
+    .peekGyro = sensorsBmi088Bmp388PeekGyro,
     .setAccMode = sensorsBmi088Bmp388SetAccMode,
     .dataAvailableCallback = sensorsBmi088Bmp388DataAvailableCallback,
   },
@@ -104,6 +108,8 @@ static const sensorsImplementation_t sensorImplementations[SensorImplementation_
     .readAcc = sensorsBmi088SpiBmp388ReadAcc,
     .readMag = sensorsBmi088SpiBmp388ReadMag,
     .readBaro = sensorsBmi088SpiBmp388ReadBaro,
+    .readImuTimestamp = sensorsBmi088SpiBmp388ReadImuTimestamp,
+    .peekGyro = sensorsBmi088SpiBmp388PeekGyro,
     .setAccMode = sensorsBmi088SpiBmp388SetAccMode,
     .dataAvailableCallback = sensorsBmi088SpiBmp388DataAvailableCallback,
   },
@@ -121,6 +127,8 @@ static const sensorsImplementation_t sensorImplementations[SensorImplementation_
     .readAcc = sensorsMpu9250Lps25hReadAcc,
     .readMag = sensorsMpu9250Lps25hReadMag,
     .readBaro = sensorsMpu9250Lps25hReadBaro,
+    .readImuTimestamp = sensorsMpu9250Lps25hReadImuTimestamp,
+    .peekGyro = sensorsMpu9250Lps25hPeekGyro,
     .setAccMode = sensorsMpu9250Lps25hSetAccMode,
     .dataAvailableCallback = nullFunction,
   },
@@ -203,6 +211,22 @@ bool sensorsReadBaro(baro_t *baro) {
   return activeImplementation->readBaro(baro);
 }
 
+bool sensorsReadImuTimestamp(uint64_t *timestamp) {
+  if (activeImplementation->readImuTimestamp) {
+    return activeImplementation->readImuTimestamp(timestamp);
+  }
+
+  return false;
+}
+
+bool sensorsPeekGyro(Axis3f *gyro, uint64_t *timestamp) {
+  if (activeImplementation->peekGyro) {
+    return activeImplementation->peekGyro(gyro, timestamp);
+  }
+
+  return false;
+}
+
 void sensorsSetAccMode(accModes accMode) {
   activeImplementation->setAccMode(accMode);
 }
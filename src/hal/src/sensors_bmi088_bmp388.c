@@ -49,6 +49,7 @@
 #include "ledseq.h"
 #include "sound.h"
 #include "filter.h"
+#include "gyro_bias.h"
 #include "i2cdev.h"
 #include "bmi088.h"
 #include "bmp3.h"
@@ -74,37 +75,25 @@
 #define SENSORS_VARIANCE_MAN_TEST_TIMEOUT   M2T(1000) // Timeout in ms
 #define SENSORS_MAN_TEST_LEVEL_MAX          5.0f      // Max degrees off
 
-#define GYRO_NBR_OF_AXES                3
-#define GYRO_MIN_BIAS_TIMEOUT_MS        M2T(1*1000)
 
-// Number of samples used in variance calculation. Changing this effects the threshold
-#define SENSORS_NBR_OF_BIAS_SAMPLES  512
-
-// Variance threshold to take zero bias for gyro
-#define GYRO_VARIANCE_BASE              10000
-#define GYRO_VARIANCE_THRESHOLD_X       (GYRO_VARIANCE_BASE)
-#define GYRO_VARIANCE_THRESHOLD_Y       (GYRO_VARIANCE_BASE)
-#define GYRO_VARIANCE_THRESHOLD_Z       (GYRO_VARIANCE_BASE)
+// Number of samples in each window of the gyro bias estimator
+#define GYRO_BIAS_WINDOW_SAMPLES        256
+// Variance threshold, in LSB^2, to take zero bias for gyro
+#define GYRO_VARIANCE_THRESHOLD         20.0f
+// Bias tracking after the first bias is found, also during hover
+#define GYRO_TRACKING_VARIANCE_THRESHOLD 10000.0f
+#define GYRO_TRACKING_MAX_OFFSET        8.0f
+#define GYRO_TRACKING_GAIN              0.02f
 
 #define SENSORS_ACC_SCALE_SAMPLES  200
 
-typedef struct
-{
-  Axis3f     bias;
-  Axis3f     variance;
-  Axis3f     mean;
-  bool       isBiasValueFound;
-  bool       isBufferFilled;
-  Axis3i16*  bufHead;
-  Axis3i16   buffer[SENSORS_NBR_OF_BIAS_SAMPLES];
-} BiasObj;
-
 /* initialize necessary variables */
 static struct bmi088_dev bmi088Dev;
 static struct bmp3_dev   bmp388Dev;
 
 static xQueueHandle accelerometerDataQueue;
 static xQueueHandle gyroDataQueue;
+static xQueueHandle imuTimestampQueue;
 static xQueueHandle magnetometerDataQueue;
 static xQueueHandle barometerDataQueue;
 static xSemaphoreHandle sensorsDataReady;
@@ -116,7 +105,7 @@ static uint64_t imuIntTimestamp;
 
 static Axis3i16 gyroRaw;
 static Axis3i16 accelRaw;
-static BiasObj gyroBiasRunning;
+static gyroBias_t gyroBiasRunning;
 static Axis3f  gyroBias;
 #if defined(SENSORS_GYRO_BIAS_CALCULATE_STDDEV) && defined (GYRO_BIAS_LIGHT_WEIGHT)
 static Axis3f  gyroBiasStdDev;
@@ -147,11 +136,7 @@ static bool processGyroBiasNoBuffer(int16_t gx, int16_t gy, int16_t gz, Axis3f *
 static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz,  Axis3f *gyroBiasOut);
 #endif
 static bool processAccScale(int16_t ax, int16_t ay, int16_t az);
-static void sensorsBiasObjInit(BiasObj* bias);
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut);
-static void sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut);
-static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z);
-static bool sensorsFindBiasValue(BiasObj* bias);
+static void sensorsGyroBiasInit(void);
 static void sensorsAccAlignToGravity(Axis3f* in, Axis3f* out);
 
 // Communication routines
@@ -222,6 +207,7 @@ static void sensorsAccelGet(Axis3i16* dataOut)
 static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
                              float temperature)
 {
+  baroScaled->timestamp = usecTimestamp();
   baroScaled->pressure = pressure*0.01f;
   baroScaled->temperature = temperature;
   baroScaled->asl = ((powf((1015.7f / baroScaled->pressure), 0.1902630958f)
@@ -248,6 +234,17 @@ bool sensorsBmi088Bmp388ReadBaro(baro_t *baro)
   return (pdTRUE == xQueueReceive(barometerDataQueue, baro, 0));
 }
 
+bool sensorsBmi088Bmp388ReadImuTimestamp(uint64_t *timestamp)
+{
+  return (pdTRUE == xQueueReceive(imuTimestampQueue, timestamp, 0));
+}
+
+bool sensorsBmi088Bmp388PeekGyro(Axis3f *gyro, uint64_t *timestamp)
+{
+  return (pdTRUE == xQueuePeek(gyroDataQueue, gyro, 0)) &&
+         (pdTRUE == xQueuePeek(imuTimestampQueue, timestamp, 0));
+}
+
 void sensorsBmi088Bmp388Acquire(sensorData_t *sensors, const uint32_t tick)
 {
   sensorsReadGyro(&sensors->gyro);
@@ -323,6 +320,7 @@ static void sensorsTask(void *param)
       }
     }
     xQueueOverwrite(accelerometerDataQueue, &sensorData.acc);
+    xQueueOverwrite(imuTimestampQueue, &sensorData.interruptTimestamp);
     xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
     if (isBarometerPresent)
     {
@@ -504,6 +502,7 @@ static void sensorsTaskInit(void)
 {
   accelerometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
   gyroDataQueue = xQueueCreate(1, sizeof(Axis3f));
+  imuTimestampQueue = xQueueCreate(1, sizeof(uint64_t));
   magnetometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
   barometerDataQueue = xQueueCreate(1, sizeof(baro_t));
 
@@ -545,7 +544,7 @@ void sensorsBmi088Bmp388Init(void)
 
   i2cdevInit(I2C3_DEV);
 
-  sensorsBiasObjInit(&gyroBiasRunning);
+  sensorsGyroBiasInit();
   sensorsDeviceInit();
   sensorsInterruptInit();
   sensorsTaskInit();
@@ -637,21 +636,19 @@ static bool processGyroBiasNoBuffer(int16_t gx, int16_t gy, int16_t gz, Axis3f *
 }
 #else
 /**
- * Calculates the bias first when the gyro variance is below threshold. Requires a buffer
- * but calibrates platform first when it is stable.
+ * Calculates the bias first when the gyro variance is below threshold and then
+ * keeps tracking it. Needs no sample buffer.
  */
 static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBiasOut)
 {
-  sensorsAddBiasValue(&gyroBiasRunning, gx, gy, gz);
+  bool wasBiasValueFound = gyroBiasRunning.isBiasValueFound;
+
+  gyroBiasAdd(&gyroBiasRunning, gx, gy, gz);
 
-  if (!gyroBiasRunning.isBiasValueFound)
+  if (!wasBiasValueFound && gyroBiasRunning.isBiasValueFound)
   {
-    sensorsFindBiasValue(&gyroBiasRunning);
-    if (gyroBiasRunning.isBiasValueFound)
-    {
-      soundSetEffect(SND_CALIB);
-      ledseqRun(SYS_LED, seq_calibrated);
-    }
+    soundSetEffect(SND_CALIB);
+    ledseqRun(SYS_LED, seq_calibrated);
   }
 
   gyroBiasOut->x = gyroBiasRunning.bias.x;
@@ -662,107 +659,10 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBias
 }
 #endif
 
-static void sensorsBiasObjInit(BiasObj* bias)
-{
-  bias->isBufferFilled = false;
-  bias->bufHead = bias->buffer;
-}
-
-/**
- * Calculates the variance and mean for the bias buffer.
- */
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
+static void sensorsGyroBiasInit(void)
 {
-  uint32_t i;
-  int64_t sum[GYRO_NBR_OF_AXES] = {0};
-  int64_t sumSq[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
-  {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-    sumSq[0] += bias->buffer[i].x * bias->buffer[i].x;
-    sumSq[1] += bias->buffer[i].y * bias->buffer[i].y;
-    sumSq[2] += bias->buffer[i].z * bias->buffer[i].z;
-  }
-
-  varOut->x = (sumSq[0] - ((int64_t)sum[0] * sum[0]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-  varOut->y = (sumSq[1] - ((int64_t)sum[1] * sum[1]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-  varOut->z = (sumSq[2] - ((int64_t)sum[2] * sum[2]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-
-  meanOut->x = (float)sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = (float)sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = (float)sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
-}
-
-/**
- * Calculates the mean for the bias buffer.
- */
-static void __attribute__((used)) sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut)
-{
-  uint32_t i;
-  int32_t sum[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
-  {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-  }
-
-  meanOut->x = sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
-}
-
-/**
- * Adds a new value to the variance buffer and if it is full
- * replaces the oldest one. Thus a circular buffer.
- */
-static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z)
-{
-  bias->bufHead->x = x;
-  bias->bufHead->y = y;
-  bias->bufHead->z = z;
-  bias->bufHead++;
-
-  if (bias->bufHead >= &bias->buffer[SENSORS_NBR_OF_BIAS_SAMPLES])
-  {
-    bias->bufHead = bias->buffer;
-    bias->isBufferFilled = true;
-  }
-}
-
-/**
- * Checks if the variances is below the predefined thresholds.
- * The bias value should have been added before calling this.
- * @param bias  The bias object
- */
-static bool sensorsFindBiasValue(BiasObj* bias)
-{
-  static int32_t varianceSampleTime;
-  bool foundBias = false;
-
-  if (bias->isBufferFilled)
-  {
-    sensorsCalculateVarianceAndMean(bias, &bias->variance, &bias->mean);
-
-    if (bias->variance.x < GYRO_VARIANCE_THRESHOLD_X &&
-        bias->variance.y < GYRO_VARIANCE_THRESHOLD_Y &&
-        bias->variance.z < GYRO_VARIANCE_THRESHOLD_Z &&
-        (varianceSampleTime + GYRO_MIN_BIAS_TIMEOUT_MS < xTaskGetTickCount()))
-    {
-      varianceSampleTime = xTaskGetTickCount();
-      bias->bias.x = bias->mean.x;
-      bias->bias.y = bias->mean.y;
-      bias->bias.z = bias->mean.z;
-      foundBias = true;
-      bias->isBiasValueFound = true;
-    }
-  }
-
-  return foundBias;
+  gyroBiasInit(&gyroBiasRunning, GYRO_BIAS_WINDOW_SAMPLES, GYRO_VARIANCE_THRESHOLD,
+               GYRO_TRACKING_VARIANCE_THRESHOLD, GYRO_TRACKING_MAX_OFFSET, GYRO_TRACKING_GAIN);
 }
 
 bool sensorsBmi088Bmp388ManufacturingTest(void)
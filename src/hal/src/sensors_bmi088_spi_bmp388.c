@@ -51,11 +51,15 @@
 #include "nvicconf.h"
 #include "ledseq.h"
 #include "sound.h"
-#include "filter.h"
+#include "biquad_cascade.h"
+#include "gyro_bias.h"
+#include "dynamic_notch.h"
 #include "i2cdev.h"
 #include "bmi088.h"
+#include "bmi088_fifo.h"
 #include "bmp3.h"
 #include "bstdr_types.h"
+#include "irq_profile.h"
 
 /* Defines for the SPI and GPIO pins used to drive the SPI Flash */
 #define BMI088_ACC_GPIO_CS             GPIO_Pin_1
@@ -104,6 +108,22 @@
 #define SENSORS_DELAY_MAG               (SENSORS_READ_RATE_HZ/SENSORS_READ_MAG_HZ)
 
 #define SENSORS_BMI088_GYRO_FS_CFG      BMI088_GYRO_RANGE_2000_DPS
+#ifdef SENSORS_BMI088_FIFO_MODE
+// Gyro sampled at 2 kHz and drained from the FIFO every watermark interrupt
+#define SENSORS_BMI088_GYRO_ODR_CFG     BMI088_GYRO_BW_230_ODR_2000_HZ
+#define SENSORS_BMI088_GYRO_RATE_HZ     2000
+#define SENSORS_BMI088_FIFO_WATERMARK   (SENSORS_BMI088_GYRO_RATE_HZ / SENSORS_READ_RATE_HZ)
+#define SENSORS_BMI088_FIFO_MAX_FRAMES  8
+#define SENSORS_BMI088_FIFO_FRAME_SIZE  BMI088_FIFO_G_ALL_DATA_LENGTH
+// Sensor time resolution of the accelerometer
+#define SENSORS_BMI088_SENSORTIME_US    39.0625f
+#define SENSORS_BMI088_SENSORTIME_MASK  0x00FFFFFF
+#define SENSORS_BMI088_GYRO_DECIMATION  SENSORS_BMI088_FIFO_WATERMARK
+#else
+#define SENSORS_BMI088_GYRO_ODR_CFG     BMI088_GYRO_BW_116_ODR_1000_HZ
+#define SENSORS_BMI088_GYRO_RATE_HZ     1000
+#define SENSORS_BMI088_GYRO_DECIMATION  1
+#endif
 #define SENSORS_BMI088_DEG_PER_LSB_CFG  (2.0f *2000.0f) / 65536.0f
 
 #define SENSORS_BMI088_ACCEL_CFG        24
@@ -115,16 +135,15 @@
 #define SENSORS_MAN_TEST_LEVEL_MAX          5.0f      // Max degrees off
 
 #define GYRO_NBR_OF_AXES                3
-#define GYRO_MIN_BIAS_TIMEOUT_MS        M2T(1*1000)
-
-// Number of samples used in variance calculation. Changing this effects the threshold
-#define SENSORS_NBR_OF_BIAS_SAMPLES  512
 
-// Variance threshold to take zero bias for gyro
-#define GYRO_VARIANCE_BASE              10000
-#define GYRO_VARIANCE_THRESHOLD_X       (GYRO_VARIANCE_BASE)
-#define GYRO_VARIANCE_THRESHOLD_Y       (GYRO_VARIANCE_BASE)
-#define GYRO_VARIANCE_THRESHOLD_Z       (GYRO_VARIANCE_BASE)
+// Number of samples in each window of the gyro bias estimator
+#define GYRO_BIAS_WINDOW_SAMPLES        256
+// Variance threshold, in LSB^2, to take zero bias for gyro
+#define GYRO_VARIANCE_THRESHOLD         20.0f
+// Bias tracking after the first bias is found, also during hover
+#define GYRO_TRACKING_VARIANCE_THRESHOLD 10000.0f
+#define GYRO_TRACKING_MAX_OFFSET        8.0f
+#define GYRO_TRACKING_GAIN              0.02f
 
 #define SENSORS_ACC_SCALE_SAMPLES  200
 
@@ -135,29 +154,23 @@
 #define GYR_DIS_CS() GPIO_SetBits(BMI088_GYR_GPIO_CS_PORT, BMI088_GYR_GPIO_CS)
 
 /* Defines and buffers for full duplex SPI DMA transactions */
+#ifdef SENSORS_BMI088_FIFO_MODE
+#define SPI_MAX_DMA_TRANSACTION_SIZE    (SENSORS_BMI088_FIFO_MAX_FRAMES * SENSORS_BMI088_FIFO_FRAME_SIZE + 1)
+#else
 #define SPI_MAX_DMA_TRANSACTION_SIZE    15
+#endif
 static uint8_t spiTxBuffer[SPI_MAX_DMA_TRANSACTION_SIZE + 1];
 static uint8_t spiRxBuffer[SPI_MAX_DMA_TRANSACTION_SIZE + 1];
 static xSemaphoreHandle spiTxDMAComplete;
 static xSemaphoreHandle spiRxDMAComplete;
 
-typedef struct
-{
-  Axis3f     bias;
-  Axis3f     variance;
-  Axis3f     mean;
-  bool       isBiasValueFound;
-  bool       isBufferFilled;
-  Axis3i16*  bufHead;
-  Axis3i16   buffer[SENSORS_NBR_OF_BIAS_SAMPLES];
-} BiasObj;
-
 /* initialize necessary variables */
 static struct bmi088_dev bmi088Dev;
 static struct bmp3_dev   bmp388Dev;
 
 static xQueueHandle accelerometerDataQueue;
 static xQueueHandle gyroDataQueue;
+static xQueueHandle imuTimestampQueue;
 static xQueueHandle magnetometerDataQueue;
 static xQueueHandle barometerDataQueue;
 static xSemaphoreHandle sensorsDataReady;
@@ -169,7 +182,7 @@ static uint64_t imuIntTimestamp;
 
 static Axis3i16 gyroRaw;
 static Axis3i16 accelRaw;
-static BiasObj gyroBiasRunning;
+static gyroBias_t gyroBiasRunning;
 static Axis3f  gyroBias;
 #if defined(SENSORS_GYRO_BIAS_CALCULATE_STDDEV) && defined (GYRO_BIAS_LIGHT_WEIGHT)
 static Axis3f  gyroBiasStdDev;
@@ -180,14 +193,60 @@ static float accScale = 1;
 
 // Low Pass filtering
 #define GYRO_LPF_CUTOFF_FREQ  80
+#define GYRO_LPF_STAGES       1
 #define ACCEL_LPF_CUTOFF_FREQ 30
-static lpf2pData accLpf[3];
-static lpf2pData gyroLpf[3];
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in);
+#define ACCEL_LPF_STAGES      1
+// Anti-alias filter at the gyro rate, only used when oversampling
+#define GYRO_AA_CUTOFF_FREQ   250
+#define GYRO_AA_STAGES        1
+
+typedef struct {
+  float gyroCutoff;
+  uint8_t gyroStages;
+  float gyroAaCutoff;
+  uint8_t gyroAaStages;
+  float accCutoff;
+  uint8_t accStages;
+} sensorsFilterConfig_t;
+
+static sensorsFilterConfig_t filterConfig = {
+  .gyroCutoff = GYRO_LPF_CUTOFF_FREQ,
+  .gyroStages = GYRO_LPF_STAGES,
+  .gyroAaCutoff = GYRO_AA_CUTOFF_FREQ,
+  .gyroAaStages = GYRO_AA_STAGES,
+  .accCutoff = ACCEL_LPF_CUTOFF_FREQ,
+  .accStages = ACCEL_LPF_STAGES,
+};
+// The configuration the filters were last initialized with
+static sensorsFilterConfig_t filterConfigApplied;
+static filterPipeline3Data gyroFilter;
+static biquadCascade3Data accFilter;
+static void sensorsFilterInit(void);
 
 static bool isBarometerPresent = false;
 static uint8_t baroMeasDelayMin = SENSORS_DELAY_BARO;
 
+// Time from the IMU interrupt until the data is published, in us
+#define SENSORS_LATENCY_MAX_WINDOW      SENSORS_READ_RATE_HZ
+static uint32_t imuLatency;
+static uint32_t imuLatencyMax;
+
+#ifdef SENSORS_BMI088_FIFO_MODE
+static struct bmi088_fifo_frame gyroFifo;
+static uint8_t gyroFifoBuffer[SENSORS_BMI088_FIFO_MAX_FRAMES * SENSORS_BMI088_FIFO_FRAME_SIZE];
+static Axis3i16 gyroFifoSamples[SENSORS_BMI088_FIFO_MAX_FRAMES];
+static uint64_t gyroFifoTimestamps[SENSORS_BMI088_FIFO_MAX_FRAMES];
+static uint8_t gyroFifoFrames;
+static uint32_t gyroFifoOverrunCount;
+static uint32_t lastSensorTime;
+static bool isLastSensorTimeValid = false;
+// Gyro sample period in us, measured with the sensor time
+static float gyroFifoPeriodUs = 1000000.0f / SENSORS_BMI088_GYRO_RATE_HZ;
+
+static uint8_t sensorsGyroFifoGet(Axis3i16* samplesOut, Axis3i16* accOut);
+static void sensorsGyroFifoTimestamps(uint32_t sensorTime, uint8_t frames, uint64_t interruptTimestamp);
+#endif
+
 // Pre-calculated values for accelerometer alignment
 float cosPitch;
 float sinPitch;
@@ -200,11 +259,7 @@ static bool processGyroBiasNoBuffer(int16_t gx, int16_t gy, int16_t gz, Axis3f *
 static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz,  Axis3f *gyroBiasOut);
 #endif
 static bool processAccScale(int16_t ax, int16_t ay, int16_t az);
-static void sensorsBiasObjInit(BiasObj* bias);
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut);
-static void sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut);
-static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z);
-static bool sensorsFindBiasValue(BiasObj* bias);
+static void sensorsGyroBiasInit(void);
 static void sensorsAccAlignToGravity(Axis3f* in, Axis3f* out);
 
 
@@ -508,9 +563,81 @@ static void sensorsAccelGet(Axis3i16* dataOut)
   bmi088_get_accel_data((struct bmi088_sensor_data*)dataOut, &bmi088Dev);
 }
 
+#ifdef SENSORS_BMI088_FIFO_MODE
+/**
+ * Drains the gyro FIFO in one DMA burst and reads the accelerometer together
+ * with the sensor time in a second burst. Returns the number of gyro samples.
+ */
+static uint8_t sensorsGyroFifoGet(Axis3i16* samplesOut, Axis3i16* accOut)
+{
+  uint8_t status = 0;
+  bmi088_get_gyro_regs(BMI088_GYRO_FIFO_STAT_REG, &status, 1, &bmi088Dev);
+
+  if (status & BMI088_GYRO_FIFO_OVERRUN_MASK)
+  {
+    gyroFifoOverrunCount++;
+  }
+
+  // Frames that do not fit are read at the next interrupt
+  uint16_t frames = status & BMI088_GYRO_FIFO_COUNTER_MASK;
+  if (frames > SENSORS_BMI088_FIFO_MAX_FRAMES)
+  {
+    frames = SENSORS_BMI088_FIFO_MAX_FRAMES;
+  }
+
+  if (frames > 0)
+  {
+    gyroFifo.length = frames * SENSORS_BMI088_FIFO_FRAME_SIZE;
+    gyroFifo.byte_start_idx = 0;
+    bmi088_get_gyro_regs(BMI088_GYRO_FIFO_DATA_REG, gyroFifo.data, gyroFifo.length, &bmi088Dev);
+    bmi088_extract_gyro((struct bmi088_sensor_data*)samplesOut, &frames, &bmi088Dev);
+  }
+
+  // Accel data registers are followed by the sensor time registers
+  uint8_t data[9];
+  bmi088_get_accel_regs(BMI088_ACCEL_X_LSB_REG, data, sizeof(data), &bmi088Dev);
+  accOut->x = (int16_t)((data[1] << 8) | data[0]);
+  accOut->y = (int16_t)((data[3] << 8) | data[2]);
+  accOut->z = (int16_t)((data[5] << 8) | data[4]);
+  uint32_t sensorTime = ((uint32_t)data[8] << 16) | ((uint32_t)data[7] << 8) | data[6];
+
+  sensorsGyroFifoTimestamps(sensorTime, frames, imuIntTimestamp);
+
+  return frames;
+}
+
+/**
+ * Reconstructs the time of each sample in the last FIFO read. The sample
+ * period is tracked with the sensor time, the watermark interrupt gives the
+ * time of the sample that reached the watermark.
+ */
+static void sensorsGyroFifoTimestamps(uint32_t sensorTime, uint8_t frames, uint64_t interruptTimestamp)
+{
+  static uint32_t framesSinceSensorTime = 0;
+
+  framesSinceSensorTime += frames;
+  if (isLastSensorTimeValid && framesSinceSensorTime > 0)
+  {
+    uint32_t elapsed = (sensorTime - lastSensorTime) & SENSORS_BMI088_SENSORTIME_MASK;
+    float period = elapsed * SENSORS_BMI088_SENSORTIME_US / framesSinceSensorTime;
+    gyroFifoPeriodUs += (period - gyroFifoPeriodUs) * 0.01f;
+  }
+  lastSensorTime = sensorTime;
+  isLastSensorTimeValid = true;
+  framesSinceSensorTime = 0;
+
+  int newestOffset = frames - SENSORS_BMI088_FIFO_WATERMARK;
+  for (int i = 0; i < frames; i++)
+  {
+    gyroFifoTimestamps[i] = interruptTimestamp + (int64_t)((i - (frames - 1) + newestOffset) * gyroFifoPeriodUs);
+  }
+}
+#endif
+
 static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
                              float temperature)
 {
+  baroScaled->timestamp = usecTimestamp();
   baroScaled->pressure = pressure*0.01f;
   baroScaled->temperature = temperature;
   baroScaled->asl = ((powf((1015.7f / baroScaled->pressure), 0.1902630958f)
@@ -537,6 +664,17 @@ bool sensorsBmi088SpiBmp388ReadBaro(baro_t *baro)
   return (pdTRUE == xQueueReceive(barometerDataQueue, baro, 0));
 }
 
+bool sensorsBmi088SpiBmp388ReadImuTimestamp(uint64_t *timestamp)
+{
+  return (pdTRUE == xQueueReceive(imuTimestampQueue, timestamp, 0));
+}
+
+bool sensorsBmi088SpiBmp388PeekGyro(Axis3f *gyro, uint64_t *timestamp)
+{
+  return (pdTRUE == xQueuePeek(gyroDataQueue, gyro, 0)) &&
+         (pdTRUE == xQueuePeek(imuTimestampQueue, timestamp, 0));
+}
+
 void sensorsBmi088SpiBmp388Acquire(sensorData_t *sensors, const uint32_t tick)
 {
   sensorsReadGyro(&sensors->gyro);
@@ -554,11 +692,42 @@ bool sensorsBmi088SpiBmp388AreCalibrated()
   return gyroBiasFound;
 }
 
+/**
+ * The barometer is read in its own low priority task. The I2C transfer blocks
+ * that task only, and never delays the IMU data to the stabilizer.
+ */
+static void sensorsBaroTask(void *param)
+{
+  baro_t baro;
+  struct bmp3_data data;
+  uint8_t sensor_comp = BMP3_PRESS | BMP3_TEMP;
+
+  systemWaitStart();
+
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  while (1)
+  {
+    vTaskDelayUntil(&lastWakeTime, M2T(baroMeasDelayMin * 1000 / SENSORS_READ_RATE_HZ));
+
+    /* Temperature and Pressure data are read and stored in the bmp3_data instance */
+    if (bmp3_get_sensor_data(sensor_comp, &data, &bmp388Dev) == BMP3_OK)
+    {
+      sensorsScaleBaro(&baro, data.pressure, data.temperature);
+      xQueueOverwrite(barometerDataQueue, &baro);
+    }
+  }
+}
+
 static void sensorsTask(void *param)
 {
+  uint64_t interruptTimestamp = 0;
+  uint32_t latencyMax = 0;
+  uint32_t latencyCount = 0;
+
   systemWaitStart();
 
   Axis3f accScaled;
+  Axis3f gyroScaled[BIQUAD_CASCADE_MAX_BLOCK_SIZE];
   /* wait an additional second the keep bus free
    * this is only required by the z-ranger, since the
    * configuration will be done after system start-up */
@@ -567,11 +736,36 @@ static void sensorsTask(void *param)
   {
     if (pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY))
     {
-      sensorData.interruptTimestamp = imuIntTimestamp;
+      interruptTimestamp = imuIntTimestamp;
+      sensorData.interruptTimestamp = interruptTimestamp;
+
+      if (memcmp(&filterConfig, &filterConfigApplied, sizeof(filterConfig)) != 0)
+      {
+        sensorsFilterInit();
+      }
 
       /* get data from chosen sensors */
+#ifdef SENSORS_BMI088_FIFO_MODE
+      gyroFifoFrames = sensorsGyroFifoGet(gyroFifoSamples, &accelRaw);
+      if (gyroFifoFrames > 0)
+      {
+        /* the bias is estimated on the mean of the batch, at the control rate */
+        int32_t sum[GYRO_NBR_OF_AXES] = {0};
+        for (int i = 0; i < gyroFifoFrames; i++)
+        {
+          sum[0] += gyroFifoSamples[i].x;
+          sum[1] += gyroFifoSamples[i].y;
+          sum[2] += gyroFifoSamples[i].z;
+        }
+        gyroRaw.x = sum[0] / gyroFifoFrames;
+        gyroRaw.y = sum[1] / gyroFifoFrames;
+        gyroRaw.z = sum[2] / gyroFifoFrames;
+        sensorData.interruptTimestamp = gyroFifoTimestamps[gyroFifoFrames - 1];
+      }
+#else
       sensorsGyroGet(&gyroRaw);
       sensorsAccelGet(&accelRaw);
+#endif
 
       /* calibrate if necessary */
 #ifdef GYRO_BIAS_LIGHT_WEIGHT
@@ -584,41 +778,58 @@ static void sensorsTask(void *param)
          processAccScale(accelRaw.x, accelRaw.y, accelRaw.z);
       }
       /* Gyro */
-      sensorData.gyro.x =  (gyroRaw.x - gyroBias.x) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      sensorData.gyro.y =  (gyroRaw.y - gyroBias.y) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      sensorData.gyro.z =  (gyroRaw.z - gyroBias.z) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      applyAxis3fLpf((lpf2pData*)(&gyroLpf), &sensorData.gyro);
+#ifdef SENSORS_BMI088_FIFO_MODE
+      /* anti-alias filter every sample at the FIFO rate and decimate to the control rate */
+      for (int i = 0; i < gyroFifoFrames; i++)
+      {
+        gyroScaled[i].x =  (gyroFifoSamples[i].x - gyroBias.x) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+        gyroScaled[i].y =  (gyroFifoSamples[i].y - gyroBias.y) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+        gyroScaled[i].z =  (gyroFifoSamples[i].z - gyroBias.z) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+      }
+      if (gyroFifoFrames > 0)
+      {
+        /* the gyro bandwidth is well below the control rate, aliasing of the
+         * latest sample is small enough for the spectrum analysis */
+        dynamicNotchPush(&gyroScaled[gyroFifoFrames - 1]);
+      }
+      if (filterPipeline3Apply(&gyroFilter, gyroScaled, gyroFifoFrames, &sensorData.gyro))
+      {
+        dynamicNotchApply(&sensorData.gyro);
+      }
+#else
+      gyroScaled[0].x =  (gyroRaw.x - gyroBias.x) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+      gyroScaled[0].y =  (gyroRaw.y - gyroBias.y) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+      gyroScaled[0].z =  (gyroRaw.z - gyroBias.z) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+      dynamicNotchPush(&gyroScaled[0]);
+      filterPipeline3Apply(&gyroFilter, gyroScaled, 1, &sensorData.gyro);
+      dynamicNotchApply(&sensorData.gyro);
+#endif
 
       /* Acelerometer */
       accScaled.x = accelRaw.x * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
       accScaled.y = accelRaw.y * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
       accScaled.z = accelRaw.z * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
       sensorsAccAlignToGravity(&accScaled, &sensorData.acc);
-      applyAxis3fLpf((lpf2pData*)(&accLpf), &sensorData.acc);
+      biquadCascade3Apply(&accFilter, &sensorData.acc, 1);
     }
 
-    if (isBarometerPresent)
-    {
-      static uint8_t baroMeasDelay = SENSORS_DELAY_BARO;
-      if (--baroMeasDelay == 0)
-      {
-        uint8_t sensor_comp = BMP3_PRESS | BMP3_TEMP;
-        struct bmp3_data data;
-        baro_t* baro388 = &sensorData.baro;
-        /* Temperature and Pressure data are read and stored in the bmp3_data instance */
-        bmp3_get_sensor_data(sensor_comp, &data, &bmp388Dev);
-        sensorsScaleBaro(baro388, data.pressure, data.temperature);
-        baroMeasDelay = baroMeasDelayMin;
-      }
-    }
     xQueueOverwrite(accelerometerDataQueue, &sensorData.acc);
+    xQueueOverwrite(imuTimestampQueue, &sensorData.interruptTimestamp);
     xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
-    if (isBarometerPresent)
-    {
-      xQueueOverwrite(barometerDataQueue, &sensorData.baro);
-    }
 
     xSemaphoreGive(dataReady);
+
+    imuLatency = (uint32_t)(usecTimestamp() - interruptTimestamp);
+    if (imuLatency > latencyMax)
+    {
+      latencyMax = imuLatency;
+    }
+    if (++latencyCount >= SENSORS_LATENCY_MAX_WINDOW)
+    {
+      imuLatencyMax = latencyMax;
+      latencyMax = 0;
+      latencyCount = 0;
+    }
   }
 }
 
@@ -657,9 +868,9 @@ static void sensorsDeviceInit(void)
     bmi088Dev.gyro_cfg.power = BMI088_GYRO_PM_NORMAL;
     rslt |= bmi088_set_gyro_power_mode(&bmi088Dev);
     /* set bandwidth and range of gyro */
-    bmi088Dev.gyro_cfg.bw = BMI088_GYRO_BW_116_ODR_1000_HZ;
+    bmi088Dev.gyro_cfg.bw = SENSORS_BMI088_GYRO_ODR_CFG;
     bmi088Dev.gyro_cfg.range = SENSORS_BMI088_GYRO_FS_CFG;
-    bmi088Dev.gyro_cfg.odr = BMI088_GYRO_BW_116_ODR_1000_HZ;
+    bmi088Dev.gyro_cfg.odr = SENSORS_BMI088_GYRO_ODR_CFG;
     rslt |= bmi088_set_gyro_meas_conf(&bmi088Dev);
 
     intConfig.gyro_int_channel = BMI088_INT_CHANNEL_3;
@@ -667,8 +878,19 @@ static void sensorsDeviceInit(void)
     intConfig.gyro_int_pin_3_cfg.enable_int_pin = 1;
     intConfig.gyro_int_pin_3_cfg.lvl = 1;
     intConfig.gyro_int_pin_3_cfg.output_mode = 0;
+#ifdef SENSORS_BMI088_FIFO_MODE
+    /* Stream the gyro into the FIFO and interrupt on the watermark */
+    gyroFifo.data = gyroFifoBuffer;
+    gyroFifo.fifo_data_enable = BMI088_GYRO_ALL_INT_DATA;
+    bmi088Dev.gyro_fifo = &gyroFifo;
+    rslt = bmi088_set_gyro_fifo_mode(BMI088_GYRO_STREAM_OP_MODE, &bmi088Dev);
+    rslt |= bmi088_set_gyro_fifo_data_sel(BMI088_GYRO_ALL_INT_DATA, &bmi088Dev);
+    rslt |= bmi088_set_gyro_fifo_wm(SENSORS_BMI088_FIFO_WATERMARK, &bmi088Dev);
+    rslt |= bmi088_set_gyro_fifo_wm_int(&intConfig, &bmi088Dev, BMI088_ENABLE);
+#else
     /* Setting the interrupt configuration */
     rslt = bmi088_set_gyro_int_config(&intConfig, &bmi088Dev);
+#endif
 
     bmi088Dev.delay_ms(50);
     struct bmi088_sensor_data gyr;
@@ -775,12 +997,9 @@ static void sensorsDeviceInit(void)
 #endif
   }
 
-  // Init second order filer for accelerometer and gyro
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    lpf2pInit(&gyroLpf[i], 1000, GYRO_LPF_CUTOFF_FREQ);
-    lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-  }
+  // Init low pass filters for accelerometer and gyro
+  sensorsFilterInit();
+  dynamicNotchInit(SENSORS_READ_RATE_HZ);
 
   cosPitch = cosf(configblockGetCalibPitch() * (float) M_PI / 180);
   sinPitch = sinf(configblockGetCalibPitch() * (float) M_PI / 180);
@@ -794,10 +1013,15 @@ static void sensorsTaskInit(void)
 {
   accelerometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
   gyroDataQueue = xQueueCreate(1, sizeof(Axis3f));
+  imuTimestampQueue = xQueueCreate(1, sizeof(uint64_t));
   magnetometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
   barometerDataQueue = xQueueCreate(1, sizeof(baro_t));
 
   xTaskCreate(sensorsTask, SENSORS_TASK_NAME, SENSORS_TASK_STACKSIZE, NULL, SENSORS_TASK_PRI, NULL);
+  if (isBarometerPresent)
+  {
+    xTaskCreate(sensorsBaroTask, BARO_TASK_NAME, BARO_TASK_STACKSIZE, NULL, BARO_TASK_PRI, NULL);
+  }
 }
 
 static void sensorsInterruptInit(void)
@@ -837,7 +1061,7 @@ void sensorsBmi088SpiBmp388Init(void)
   spiInit();
   spiDMAInit();
 
-  sensorsBiasObjInit(&gyroBiasRunning);
+  sensorsGyroBiasInit();
   sensorsDeviceInit();
   sensorsInterruptInit();
   sensorsTaskInit();
@@ -928,21 +1152,19 @@ static bool processGyroBiasNoBuffer(int16_t gx, int16_t gy, int16_t gz, Axis3f *
 }
 #else
 /**
- * Calculates the bias first when the gyro variance is below threshold. Requires a buffer
- * but calibrates platform first when it is stable.
+ * Calculates the bias first when the gyro variance is below threshold and then
+ * keeps tracking it. Needs no sample buffer.
  */
 static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBiasOut)
 {
-  sensorsAddBiasValue(&gyroBiasRunning, gx, gy, gz);
+  bool wasBiasValueFound = gyroBiasRunning.isBiasValueFound;
 
-  if (!gyroBiasRunning.isBiasValueFound)
+  gyroBiasAdd(&gyroBiasRunning, gx, gy, gz);
+
+  if (!wasBiasValueFound && gyroBiasRunning.isBiasValueFound)
   {
-    sensorsFindBiasValue(&gyroBiasRunning);
-    if (gyroBiasRunning.isBiasValueFound)
-    {
-      soundSetEffect(SND_CALIB);
-      ledseqRun(SYS_LED, seq_calibrated);
-    }
+    soundSetEffect(SND_CALIB);
+    ledseqRun(SYS_LED, seq_calibrated);
   }
 
   gyroBiasOut->x = gyroBiasRunning.bias.x;
@@ -953,107 +1175,10 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBias
 }
 #endif
 
-static void sensorsBiasObjInit(BiasObj* bias)
+static void sensorsGyroBiasInit(void)
 {
-  bias->isBufferFilled = false;
-  bias->bufHead = bias->buffer;
-}
-
-/**
- * Calculates the variance and mean for the bias buffer.
- */
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
-{
-  uint32_t i;
-  int64_t sum[GYRO_NBR_OF_AXES] = {0};
-  int64_t sumSq[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
-  {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-    sumSq[0] += bias->buffer[i].x * bias->buffer[i].x;
-    sumSq[1] += bias->buffer[i].y * bias->buffer[i].y;
-    sumSq[2] += bias->buffer[i].z * bias->buffer[i].z;
-  }
-
-  varOut->x = (sumSq[0] - ((int64_t)sum[0] * sum[0]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-  varOut->y = (sumSq[1] - ((int64_t)sum[1] * sum[1]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-  varOut->z = (sumSq[2] - ((int64_t)sum[2] * sum[2]) / SENSORS_NBR_OF_BIAS_SAMPLES);
-
-  meanOut->x = (float)sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = (float)sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = (float)sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
-}
-
-/**
- * Calculates the mean for the bias buffer.
- */
-static void __attribute__((used)) sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut)
-{
-  uint32_t i;
-  int32_t sum[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
-  {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-  }
-
-  meanOut->x = sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
-}
-
-/**
- * Adds a new value to the variance buffer and if it is full
- * replaces the oldest one. Thus a circular buffer.
- */
-static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z)
-{
-  bias->bufHead->x = x;
-  bias->bufHead->y = y;
-  bias->bufHead->z = z;
-  bias->bufHead++;
-
-  if (bias->bufHead >= &bias->buffer[SENSORS_NBR_OF_BIAS_SAMPLES])
-  {
-    bias->bufHead = bias->buffer;
-    bias->isBufferFilled = true;
-  }
-}
-
-/**
- * Checks if the variances is below the predefined thresholds.
- * The bias value should have been added before calling this.
- * @param bias  The bias object
- */
-static bool sensorsFindBiasValue(BiasObj* bias)
-{
-  static int32_t varianceSampleTime;
-  bool foundBias = false;
-
-  if (bias->isBufferFilled)
-  {
-    sensorsCalculateVarianceAndMean(bias, &bias->variance, &bias->mean);
-
-    if (bias->variance.x < GYRO_VARIANCE_THRESHOLD_X &&
-        bias->variance.y < GYRO_VARIANCE_THRESHOLD_Y &&
-        bias->variance.z < GYRO_VARIANCE_THRESHOLD_Z &&
-        (varianceSampleTime + GYRO_MIN_BIAS_TIMEOUT_MS < xTaskGetTickCount()))
-    {
-      varianceSampleTime = xTaskGetTickCount();
-      bias->bias.x = bias->mean.x;
-      bias->bias.y = bias->mean.y;
-      bias->bias.z = bias->mean.z;
-      foundBias = true;
-      bias->isBiasValueFound = true;
-    }
-  }
-
-  return foundBias;
+  gyroBiasInit(&gyroBiasRunning, GYRO_BIAS_WINDOW_SAMPLES, GYRO_VARIANCE_THRESHOLD,
+               GYRO_TRACKING_VARIANCE_THRESHOLD, GYRO_TRACKING_MAX_OFFSET, GYRO_TRACKING_GAIN);
 }
 
 bool sensorsBmi088SpiBmp388ManufacturingTest(void)
@@ -1100,10 +1225,8 @@ void sensorsBmi088SpiBmp388SetAccMode(accModes accMode)
       {
         DEBUG_PRINT("ACC config [FAIL]\n");
       }
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, 500);
-      }
+      // No low pass filtering, the cutoff is at the Nyquist frequency
+      biquadCascade3Init(&accFilter, SENSORS_READ_RATE_HZ, SENSORS_READ_RATE_HZ / 2, 0);
       break;
     case ACC_MODE_FLIGHT:
     default:
@@ -1115,19 +1238,20 @@ void sensorsBmi088SpiBmp388SetAccMode(accModes accMode)
       {
         DEBUG_PRINT("ACC config [FAIL]\n");
       }
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-      }
+      biquadCascade3Init(&accFilter, SENSORS_READ_RATE_HZ, filterConfig.accCutoff, filterConfig.accStages);
       break;
   }
 }
 
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in)
+static void sensorsFilterInit(void)
 {
-  for (uint8_t i = 0; i < 3; i++) {
-    in->axis[i] = lpf2pApply(&data[i], in->axis[i]);
-  }
+  filterConfigApplied = filterConfig;
+
+  filterPipeline3Init(&gyroFilter, SENSORS_READ_RATE_HZ, SENSORS_BMI088_GYRO_DECIMATION,
+                      filterConfigApplied.gyroAaCutoff, filterConfigApplied.gyroAaStages,
+                      filterConfigApplied.gyroCutoff, filterConfigApplied.gyroStages);
+  biquadCascade3Init(&accFilter, SENSORS_READ_RATE_HZ,
+                     filterConfigApplied.accCutoff, filterConfigApplied.accStages);
 }
 
 void sensorsBmi088SpiBmp388DataAvailableCallback(void)
@@ -1144,6 +1268,8 @@ void sensorsBmi088SpiBmp388DataAvailableCallback(void)
 
 void __attribute__((used)) BMI088_SPI_TX_DMA_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
   // Stop and cleanup DMA stream
@@ -1166,10 +1292,14 @@ void __attribute__((used)) BMI088_SPI_TX_DMA_IRQHandler(void)
   {
     portYIELD();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileImuSpiTx);
 }
 
 void __attribute__((used)) BMI088_SPI_RX_DMA_IRQHandler(void)
 {
+  IRQ_PROFILE_ENTER();
+
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
   // Stop and cleanup DMA stream
@@ -1192,8 +1322,32 @@ void __attribute__((used)) BMI088_SPI_RX_DMA_IRQHandler(void)
   {
     portYIELD();
   }
+
+  IRQ_PROFILE_EXIT(irqProfileImuSpiRx);
 }
 
 PARAM_GROUP_START(imu_sensors)
 PARAM_ADD(PARAM_UINT8 | PARAM_RONLY, BMP388, &isBarometerPresent)
 PARAM_GROUP_STOP(imu_sensors)
+
+PARAM_GROUP_START(imu_filter)
+PARAM_ADD(PARAM_FLOAT, gyroLpfHz, &filterConfig.gyroCutoff)
+PARAM_ADD(PARAM_UINT8, gyroStages, &filterConfig.gyroStages)
+PARAM_ADD(PARAM_FLOAT, gyroAaHz, &filterConfig.gyroAaCutoff)
+PARAM_ADD(PARAM_UINT8, gyroAaStages, &filterConfig.gyroAaStages)
+PARAM_ADD(PARAM_FLOAT, accLpfHz, &filterConfig.accCutoff)
+PARAM_ADD(PARAM_UINT8, accStages, &filterConfig.accStages)
+PARAM_GROUP_STOP(imu_filter)
+
+LOG_GROUP_START(imuTiming)
+LOG_ADD(LOG_UINT32, latency, &imuLatency)
+LOG_ADD(LOG_UINT32, latencyMax, &imuLatencyMax)
+LOG_GROUP_STOP(imuTiming)
+
+#ifdef SENSORS_BMI088_FIFO_MODE
+LOG_GROUP_START(imuFifo)
+LOG_ADD(LOG_UINT8, frames, &gyroFifoFrames)
+LOG_ADD(LOG_UINT32, overrun, &gyroFifoOverrunCount)
+LOG_ADD(LOG_FLOAT, periodUs, &gyroFifoPeriodUs)
+LOG_GROUP_STOP(imuFifo)
+#endif
@@ -806,6 +806,7 @@ static void sensorsApplyBiasAndScale(Axis3f* scaled, Axis3i16* aligned,
 
 static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
                              float temperature) {
+  baroScaled->timestamp = usecTimestamp();
   baroScaled->pressure = pressure*0.01f;
   baroScaled->temperature = temperature;
   baroScaled->asl = ((powf((1015.7f / baroScaled->pressure), 0.1902630958f)
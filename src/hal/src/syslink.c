@@ -42,6 +42,7 @@
 #include "configblock.h"
 #include "pm.h"
 #include "ow.h"
+#include "static_mem.h"
 
 static bool isInit = false;
 static uint8_t sendBuffer[64];
@@ -89,6 +90,8 @@ static void syslinkRouteIncommingPacket(SyslinkPacket *slp)
  * Public functions
  */
 
+STATIC_MEM_TASK_ALLOC(syslinkTask, SYSLINK_TASK_STACKSIZE);
+
 void syslinkInit()
 {
   if(isInit)
@@ -96,8 +99,8 @@ void syslinkInit()
 
   vSemaphoreCreateBinary(syslinkAccess);
 
-  if (xTaskCreate(syslinkTask, SYSLINK_TASK_NAME,
-                  SYSLINK_TASK_STACKSIZE, NULL, SYSLINK_TASK_PRI, NULL) == pdPASS)
+  if (STATIC_MEM_TASK_CREATE(syslinkTask, syslinkTask, SYSLINK_TASK_NAME,
+                             NULL, SYSLINK_TASK_PRI, NULL) == pdPASS)
   {
     isInit = true;
   }
@@ -39,6 +39,7 @@
 #include "queue.h"
 #include "queuemonitor.h"
 #include "semphr.h"
+#include "static_mem.h"
 
 #include "usb.h"
 
@@ -118,6 +119,8 @@ static int usblinkSetEnable(bool enable)
  * Public functions
  */
 
+STATIC_MEM_TASK_ALLOC(usblinkTask, USBLINK_TASK_STACKSIZE);
+
 void usblinkInit()
 {
   if(isInit)
@@ -129,8 +132,7 @@ void usblinkInit()
   crtpPacketDelivery = xQueueCreate(16, sizeof(CRTPPacket));
   DEBUG_QUEUE_MONITOR_REGISTER(crtpPacketDelivery);
 
-  xTaskCreate(usblinkTask, USBLINK_TASK_NAME,
-              USBLINK_TASK_STACKSIZE, NULL, USBLINK_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(usblinkTask, usblinkTask, USBLINK_TASK_NAME, NULL, USBLINK_TASK_PRI, NULL);
 
   isInit = true;
 }
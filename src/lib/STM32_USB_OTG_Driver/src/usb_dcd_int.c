@@ -27,6 +27,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "usb_dcd_int.h"
+#include "irq_profile.h"
 /** @addtogroup USB_OTG_DRIVER
 * @{
 */
@@ -211,7 +212,9 @@ void  __attribute__((used)) OTG_FS_IRQHandler(void)
 {
   extern USB_OTG_CORE_HANDLE USB_OTG_dev;
 
+  IRQ_PROFILE_ENTER();
   USBD_OTG_ISR_Handler (&USB_OTG_dev);
+  IRQ_PROFILE_EXIT(irqProfileUsb);
 }
 
 uint32_t USBD_OTG_ISR_Handler (USB_OTG_CORE_HANDLE *pdev)
@@ -63,6 +63,16 @@ void attitudeControllerResetRollAttitudePID(void);
  */
 void attitudeControllerResetPitchAttitudePID(void);
 
+/**
+ * Reset controller roll, pitch and yaw attitude PID's.
+ */
+void attitudeControllerResetAttitudePID(void);
+
+/**
+ * Reset controller roll, pitch and yaw rate PID's.
+ */
+void attitudeControllerResetRatePID(void);
+
 /**
  * Reset controller roll, pitch and yaw PID's.
  */
@@ -41,6 +41,15 @@ void controller(control_t *control, setpoint_t *setpoint,
                                          const sensorData_t *sensors,
                                          const state_t *state,
                                          const uint32_t tick);
+
+/**
+ * Body rate reference from the last controller() call, for the fast rate
+ * loop. Returns false if the active controller does not split out its rate
+ * loop, the output of controller() is then complete.
+ */
+bool controllerGetRateReference(attitude_t *rateReference);
+void controllerRate(control_t *control, const attitude_t *rateReference, const Axis3f *gyro);
+
 ControllerType getControllerType(void);
 const char* controllerGetName();
 
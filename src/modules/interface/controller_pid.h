@@ -35,4 +35,12 @@ void controllerPid(control_t *control, setpoint_t *setpoint,
                                          const state_t *state,
                                          const uint32_t tick);
 
+/**
+ * Body rate PID, from the rate reference and gyro to the roll, pitch and yaw
+ * outputs in control. Run from controllerPid() or, with
+ * STABILIZER_FAST_RATE_LOOP, on every IMU sample by the stabilizer.
+ */
+void controllerPidRate(control_t *control, const attitude_t *rateReference, const Axis3f *gyro);
+bool controllerPidGetRateReference(attitude_t *rateReference);
+
 #endif //__CONTROLLER_PID_H__
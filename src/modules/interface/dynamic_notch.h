@@ -0,0 +1,60 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dynamic_notch.h - Notch filters tracking the gyro vibration peaks
+ */
+#ifndef DYNAMIC_NOTCH_H_
+#define DYNAMIC_NOTCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "imu_types.h"
+
+#define DYN_NOTCH_MAX_PEAKS 3
+
+#ifdef DYNAMIC_NOTCH
+  /**
+   * Start the spectrum analysis task. sampleFreq is the rate at which
+   * dynamicNotchPush() and dynamicNotchApply() are called.
+   */
+  void dynamicNotchInit(float sampleFreq);
+  bool dynamicNotchTest(void);
+
+  /**
+   * Queue one unfiltered gyro sample for the spectrum analysis.
+   */
+  void dynamicNotchPush(const Axis3f* gyro);
+
+  /**
+   * Notch filter one gyro sample in place, at the latest peak frequencies.
+   */
+  void dynamicNotchApply(Axis3f* gyro);
+#else
+  #define dynamicNotchInit(sampleFreq)
+  #define dynamicNotchTest() true
+  #define dynamicNotchPush(gyro)
+  #define dynamicNotchApply(gyro)
+#endif // DYNAMIC_NOTCH
+
+#endif //DYNAMIC_NOTCH_H_
@@ -72,6 +72,7 @@ bool estimatorKalmanEnqueueDistance(const distanceMeasurement_t *dist);
 bool estimatorKalmanEnqueueTOF(const tofMeasurement_t *tof);
 bool estimatorKalmanEnqueueAbsoluteHeight(const heightMeasurement_t *height);
 bool estimatorKalmanEnqueueFlow(const flowMeasurement_t *flow);
+bool estimatorKalmanEnqueueSweepAngle(const sweepAngleMeasurement_t *angle);
 
 void estimatorKalmanGetEstimatedPos(point_t* pos);
 
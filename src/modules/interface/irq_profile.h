@@ -0,0 +1,76 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * irq_profile.h - Count and duration of the interrupt handlers
+ */
+#ifndef __IRQ_PROFILE_H__
+#define __IRQ_PROFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+  irqProfileExti0,
+  irqProfileExti1,
+  irqProfileExti2,
+  irqProfileExti3,
+  irqProfileExti4,
+  irqProfileExti9_5,
+  irqProfileExti15_10,
+  irqProfileI2c1Ev,
+  irqProfileI2c1Er,
+  irqProfileI2c1Dma,
+  irqProfileI2c3Ev,
+  irqProfileI2c3Er,
+  irqProfileI2c3Dma,
+  irqProfileDeckSpiTx,
+  irqProfileDeckSpiRx,
+  irqProfileImuSpiTx,
+  irqProfileImuSpiRx,
+  irqProfileSyslinkUart,
+  irqProfileSyslinkDma,
+  irqProfileUart1,
+  irqProfileUart1RxDma,
+  irqProfileUart2,
+  irqProfileUsb,
+  IRQ_PROFILE_COUNT,
+} irqProfileIrq_t;
+
+#ifdef IRQ_PROFILE
+  #include "cycle_counter.h"
+
+  void irqProfileInit(void);
+  void irqProfileRecord(const irqProfileIrq_t irq, const uint32_t startCycles);
+  void irqProfileSetStabilizerBusy(const bool busy);
+
+  // Put first and last in the handler, the handler must not return in between
+  #define IRQ_PROFILE_ENTER() const uint32_t irqProfileStart = cycleCounterGet()
+  #define IRQ_PROFILE_EXIT(irq) irqProfileRecord(irq, irqProfileStart)
+  #define IRQ_PROFILE_STABILIZER_BUSY(busy) irqProfileSetStabilizerBusy(busy)
+#else
+  #define IRQ_PROFILE_ENTER()
+  #define IRQ_PROFILE_EXIT(irq)
+  #define IRQ_PROFILE_STABILIZER_BUSY(busy)
+#endif // IRQ_PROFILE
+
+#endif // __IRQ_PROFILE_H__
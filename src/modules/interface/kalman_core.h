@@ -99,6 +99,9 @@ typedef struct {
 
 void kalmanCoreInit(kalmanCoreData_t* this);
 
+/*  - Scalar update with the measurement model row Hm and the innovation error */
+void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise);
+
 /*  - Measurement updates based on sensors */
 
 // Barometer
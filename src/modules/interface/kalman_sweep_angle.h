@@ -0,0 +1,35 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_sweep_angle.h - Lighthouse sweep angle measurement model for the
+ *                        Kalman filter
+ */
+#ifndef __KALMAN_SWEEP_ANGLE_H__
+#define __KALMAN_SWEEP_ANGLE_H__
+
+#include "kalman_core.h"
+
+// Measurements of a single Lighthouse sweep angle
+void kalmanCoreUpdateWithSweepAngle(kalmanCoreData_t* this, sweepAngleMeasurement_t *sweep);
+
+#endif // __KALMAN_SWEEP_ANGLE_H__
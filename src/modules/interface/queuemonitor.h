@@ -21,7 +21,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
- * log.h - Dynamic log system
+ * queuemonitor.h - Monitoring functionality for queues
  */
 
 #ifndef __QUEUE_MONITOR_H__
@@ -29,18 +29,25 @@
 
 
 #include "FreeRTOS.h"
+#include "queue.h"
 
-#ifdef DEBUG_QUEUE_MONITOR
-  #include "queue.h"
-
-  void queueMonitorInit();
-  #define DEBUG_QUEUE_MONITOR_REGISTER(queue) qmRegisterQueue(queue, __FILE__, #queue)
+/**
+ * Queues registered with DEBUG_QUEUE_MONITOR_REGISTER() are monitored through
+ * the FreeRTOS trace hooks. Enqueue and dequeue are time stamped to measure
+ * how long items stay in the queue, and the high-water mark, the number of
+ * dropped items and the residency time percentiles are published in the
+ * queue<n> log groups, where n is the registration order. Set the
+ * queueMonitor.dump parameter to print which queue is which on the console.
+ *
+ * With DEBUG_QUEUE_MONITOR the queues that dropped items are also printed on
+ * the console every 10 seconds.
+ */
+void queueMonitorInit();
+#define DEBUG_QUEUE_MONITOR_REGISTER(queue) qmRegisterQueue(queue, __FILE__, #queue)
 
-  void qm_traceQUEUE_SEND(void* xQueue);
-  void qm_traceQUEUE_SEND_FAILED(void* xQueue);
-  void qmRegisterQueue(xQueueHandle* xQueue, char* fileName, char* queueName);
-#else
-  #define DEBUG_QUEUE_MONITOR_REGISTER(queue)
-#endif // DEBUG_QUEUE_MONITOR
+void qm_traceQUEUE_SEND(unsigned int queueNumber, unsigned int waiting, unsigned int length);
+void qm_traceQUEUE_SEND_FAILED(unsigned int queueNumber);
+void qm_traceQUEUE_RECEIVE(unsigned int queueNumber);
+void qmRegisterQueue(xQueueHandle* xQueue, char* fileName, char* queueName);
 
 #endif // __QUEUE_MONITOR_H__
\ No newline at end of file
@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 typedef enum {
     rangeFront=0,
     rangeBack,
@@ -45,10 +47,27 @@ typedef enum {
  */
 void rangeSet(rangeDirection_t direction, float range_m);
 
+/**
+ * Set the range for a certain direction along with the time it was measured
+ * 
+ * @param direction Direction of the range
+ * @param range_m Distance to an object in meter
+ * @param timestamp Time of the measurement in microseconds
+ */
+void rangeSetWithTimestamp(rangeDirection_t direction, float range_m, uint64_t timestamp);
+
 /**
  * Get the range for a certain direction
  * 
  * @param direction Direction of the range
  * @return Distance to an object in meter
  */
-float rangeGet(rangeDirection_t direction);
\ No newline at end of file
+float rangeGet(rangeDirection_t direction);
+
+/**
+ * Get the time of the last range for a certain direction
+ * 
+ * @param direction Direction of the range
+ * @return Time of the measurement in microseconds, 0 if there is none
+ */
+uint64_t rangeGetTimestamp(rangeDirection_t direction);
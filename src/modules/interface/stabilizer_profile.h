@@ -0,0 +1,55 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * stabilizer_profile.h - Cycle counts of the stabilizer loop stages
+ */
+#ifndef __STABILIZER_PROFILE_H__
+#define __STABILIZER_PROFILE_H__
+
+#include <stdint.h>
+
+typedef enum {
+  stabilizerStageEstimator,
+  stabilizerStageCommander,
+  stabilizerStageSitAw,
+  stabilizerStageController,
+  stabilizerStageRate,
+  stabilizerStagePowerDistribution,
+  stabilizerStageLoop,
+  stabilizerStageRateLoop,
+  STABILIZER_STAGE_COUNT,
+} stabilizerStage_t;
+
+#ifdef STABILIZER_PROFILE
+  void stabilizerProfileInit(void);
+  void stabilizerProfileStart(const stabilizerStage_t stage);
+  void stabilizerProfileStop(const stabilizerStage_t stage);
+
+  #define STABILIZER_PROFILE_START(stage) stabilizerProfileStart(stage)
+  #define STABILIZER_PROFILE_STOP(stage) stabilizerProfileStop(stage)
+#else
+  #define STABILIZER_PROFILE_START(stage)
+  #define STABILIZER_PROFILE_STOP(stage)
+#endif // STABILIZER_PROFILE
+
+#endif // __STABILIZER_PROFILE_H__
@@ -78,18 +78,21 @@ typedef struct quaternion_s {
 } quaternion_t;
 
 typedef struct tdoaMeasurement_s {
+  uint64_t timestamp;       // us
   point_t anchorPosition[2];
   float distanceDiff;
   float stdDev;
 } tdoaMeasurement_t;
 
 typedef struct baro_s {
+  uint64_t timestamp;       // us
   float pressure;           // mbar
   float temperature;        // degree Celcius
   float asl;                // m (ASL = altitude above sea level)
 } baro_t;
 
 typedef struct positionMeasurement_s {
+  uint64_t timestamp;       // us
   union {
     struct {
       float x;
@@ -102,6 +105,7 @@ typedef struct positionMeasurement_s {
 } positionMeasurement_t;
 
 typedef struct poseMeasurement_s {
+  uint64_t timestamp;       // us
   union {
     struct {
       float x;
@@ -116,6 +120,7 @@ typedef struct poseMeasurement_s {
 } poseMeasurement_t;
 
 typedef struct distanceMeasurement_s {
+  uint64_t timestamp;       // us
   union {
     struct {
       float x;
@@ -144,7 +149,7 @@ typedef struct sensorData_s {
   Axis3f accSec;            // Gs
   Axis3f gyroSec;           // deg/s
 #endif
-  uint64_t interruptTimestamp;
+  uint64_t interruptTimestamp; // us, IMU sample time
 } sensorData_t;
 
 typedef struct state_s {
@@ -206,7 +211,7 @@ typedef struct setpointZ_s {
 
 /** Flow measurement**/
 typedef struct flowMeasurement_s {
-  uint32_t timestamp;
+  uint64_t timestamp;  // us
   union {
     struct {
       float dpixelx;  // Accumulated pixel count x
@@ -222,14 +227,25 @@ typedef struct flowMeasurement_s {
 
 /** TOF measurement**/
 typedef struct tofMeasurement_s {
-  uint32_t timestamp;
+  uint64_t timestamp;  // us
   float distance;
   float stdDev;
 } tofMeasurement_t;
 
+/** Lighthouse sweep angle measurement */
+typedef struct sweepAngleMeasurement_s {
+  uint64_t timestamp;               // us
+  const float* sensorPos;           // m, position of the sensor in the body frame [3]
+  float baseStationPos[3];          // m, origin of the base station in the global frame
+  float baseStationRot[3][3];       // rotation from the global frame to the base station frame
+  float angle;                      // rad
+  uint8_t axis;                     // 0 for the horizontal sweep, 1 for the vertical sweep
+  float stdDev;
+} sweepAngleMeasurement_t;
+
 /** Absolute height measurement */
 typedef struct heightMeasurement_s {
-  uint32_t timestamp;
+  uint64_t timestamp;  // us
   float height;
   float stdDev;
 } heightMeasurement_t;
@@ -246,6 +262,14 @@ typedef struct heightMeasurement_s {
 #define ATTITUDE_RATE RATE_500_HZ
 #define POSITION_RATE RATE_100_HZ
 
+// With STABILIZER_FAST_RATE_LOOP the body rate loop runs on every IMU sample,
+// decoupled from the attitude and position loops
+#ifdef STABILIZER_FAST_RATE_LOOP
+#define BODY_RATE_LOOP_RATE RATE_MAIN_LOOP
+#else
+#define BODY_RATE_LOOP_RATE ATTITUDE_RATE
+#endif
+
 #define RATE_DO_EXECUTE(RATE_HZ, TICK) ((TICK % (RATE_MAIN_LOOP / RATE_HZ)) == 0)
 
 #endif
@@ -28,6 +28,17 @@
 
 #include <stdbool.h>
 
+/**
+ * Work is executed in priority order, high priority first. Within a priority
+ * work is executed in the order it was scheduled.
+ */
+typedef enum {
+  workerPriorityHigh = 0,
+  workerPriorityNormal,
+  workerPriorityLow,
+  WORKER_PRIORITY_COUNT,
+} workerPriority_t;
+
 void workerInit();
 
 bool workerTest();
@@ -41,9 +52,8 @@ bool workerTest();
 void workerLoop();
 
 /**
- * Schedule a function for execution by the worker loop
- * The function will be executed as soon as possible by the worker loop.
- * Scheduled functions are stacked in a FIFO queue.
+ * Schedule a function for execution by the worker loop with normal priority,
+ * see workerSchedulePriority().
  *
  * @param function Function to be executed
  * @param arg      Argument that will be passed to the function when executed
@@ -51,4 +61,18 @@ void workerLoop();
  */
 int workerSchedule(void (*function)(void*), void *arg);
 
+/**
+ * Schedule a function for execution by the worker loop
+ * The function will be executed as soon as no work of higher priority is
+ * pending. If the same function and argument is already pending it is not
+ * scheduled again, the pending work is moved up to this priority if it is
+ * higher.
+ *
+ * @param function Function to be executed
+ * @param arg      Argument that will be passed to the function when executed
+ * @param priority Priority of the work
+ * @return         0 in case of success. Anything else on failure.
+ */
+int workerSchedulePriority(void (*function)(void*), void *arg, workerPriority_t priority);
+
 #endif //__WORKER_H
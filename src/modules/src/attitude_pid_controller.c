@@ -67,13 +67,15 @@ void attitudeControllerInit(const float updateDt)
   if(isInit)
     return;
 
+  const float rateUpdateDt = 1.0f / BODY_RATE_LOOP_RATE;
+
   //TODO: get parameters from configuration manager instead
   pidInit(&pidRollRate,  0, PID_ROLL_RATE_KP,  PID_ROLL_RATE_KI,  PID_ROLL_RATE_KD,
-      updateDt, ATTITUDE_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
+      rateUpdateDt, BODY_RATE_LOOP_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
   pidInit(&pidPitchRate, 0, PID_PITCH_RATE_KP, PID_PITCH_RATE_KI, PID_PITCH_RATE_KD,
-      updateDt, ATTITUDE_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
+      rateUpdateDt, BODY_RATE_LOOP_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
   pidInit(&pidYawRate,   0, PID_YAW_RATE_KP,   PID_YAW_RATE_KI,   PID_YAW_RATE_KD,
-      updateDt, ATTITUDE_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
+      rateUpdateDt, BODY_RATE_LOOP_RATE, ATTITUDE_RATE_LPF_CUTOFF_FREQ, ATTITUDE_RATE_LPF_ENABLE);
 
   pidSetIntegralLimit(&pidRollRate,  PID_ROLL_RATE_INTEGRATION_LIMIT);
   pidSetIntegralLimit(&pidPitchRate, PID_PITCH_RATE_INTEGRATION_LIMIT);
@@ -145,16 +147,26 @@ void attitudeControllerResetPitchAttitudePID(void)
     pidReset(&pidPitch);
 }
 
-void attitudeControllerResetAllPID(void)
+void attitudeControllerResetAttitudePID(void)
 {
   pidReset(&pidRoll);
   pidReset(&pidPitch);
   pidReset(&pidYaw);
+}
+
+void attitudeControllerResetRatePID(void)
+{
   pidReset(&pidRollRate);
   pidReset(&pidPitchRate);
   pidReset(&pidYawRate);
 }
 
+void attitudeControllerResetAllPID(void)
+{
+  attitudeControllerResetAttitudePID();
+  attitudeControllerResetRatePID();
+}
+
 void attitudeControllerGetActuatorOutput(int16_t* roll, int16_t* pitch, int16_t* yaw)
 {
   *roll = rollOutput;
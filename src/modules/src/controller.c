@@ -15,12 +15,15 @@ typedef struct {
   void (*init)(void);
   bool (*test)(void);
   void (*update)(control_t *control, setpoint_t *setpoint, const sensorData_t *sensors, const state_t *state, const uint32_t tick);
+  bool (*getRateReference)(attitude_t *rateReference);
+  void (*updateRate)(control_t *control, const attitude_t *rateReference, const Axis3f *gyro);
   const char* name;
 } ControllerFcns;
 
 static ControllerFcns controllerFunctions[] = {
   {.init = 0, .test = 0, .update = 0, .name = "None"}, // Any
-  {.init = controllerPidInit, .test = controllerPidTest, .update = controllerPid, .name = "PID"},
+  {.init = controllerPidInit, .test = controllerPidTest, .update = controllerPid,
+   .getRateReference = controllerPidGetRateReference, .updateRate = controllerPidRate, .name = "PID"},
   {.init = controllerMellingerInit, .test = controllerMellingerTest, .update = controllerMellinger, .name = "Mellinger"},
 };
 
@@ -63,6 +66,20 @@ void controller(control_t *control, setpoint_t *setpoint, const sensorData_t *se
   controllerFunctions[currentController].update(control, setpoint, sensors, state, tick);
 }
 
+bool controllerGetRateReference(attitude_t *rateReference) {
+  if (controllerFunctions[currentController].getRateReference) {
+    return controllerFunctions[currentController].getRateReference(rateReference);
+  }
+
+  return false;
+}
+
+void controllerRate(control_t *control, const attitude_t *rateReference, const Axis3f *gyro) {
+  if (controllerFunctions[currentController].updateRate) {
+    controllerFunctions[currentController].updateRate(control, rateReference, gyro);
+  }
+}
+
 const char* controllerGetName() {
   return controllerFunctions[currentController].name;
 }
\ No newline at end of file
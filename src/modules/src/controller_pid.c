@@ -33,6 +33,33 @@ bool controllerPidTest(void)
   return pass;
 }
 
+void controllerPidRate(control_t *control, const attitude_t *rateReference, const Axis3f *gyro)
+{
+  if (control->thrust == 0) {
+    control->roll = 0;
+    control->pitch = 0;
+    control->yaw = 0;
+    attitudeControllerResetRatePID();
+    return;
+  }
+
+  // TODO: Investigate possibility to subtract gyro drift.
+  attitudeControllerCorrectRatePID(gyro->x, -gyro->y, gyro->z,
+                           rateReference->roll, rateReference->pitch, rateReference->yaw);
+
+  attitudeControllerGetActuatorOutput(&control->roll,
+                                      &control->pitch,
+                                      &control->yaw);
+
+  control->yaw = -control->yaw;
+}
+
+bool controllerPidGetRateReference(attitude_t *rateReference)
+{
+  *rateReference = rateDesired;
+  return true;
+}
+
 void controllerPid(control_t *control, setpoint_t *setpoint,
                                          const sensorData_t *sensors,
                                          const state_t *state,
@@ -80,16 +107,6 @@ void controllerPid(control_t *control, setpoint_t *setpoint,
       rateDesired.pitch = setpoint->attitudeRate.pitch;
       attitudeControllerResetPitchAttitudePID();
     }
-
-    // TODO: Investigate possibility to subtract gyro drift.
-    attitudeControllerCorrectRatePID(sensors->gyro.x, -sensors->gyro.y, sensors->gyro.z,
-                             rateDesired.roll, rateDesired.pitch, rateDesired.yaw);
-
-    attitudeControllerGetActuatorOutput(&control->roll,
-                                        &control->pitch,
-                                        &control->yaw);
-
-    control->yaw = -control->yaw;
   }
 
   if (tiltCompensationEnabled)
@@ -101,6 +118,12 @@ void controllerPid(control_t *control, setpoint_t *setpoint,
     control->thrust = actuatorThrust;
   }
 
+#ifndef STABILIZER_FAST_RATE_LOOP
+  if (RATE_DO_EXECUTE(ATTITUDE_RATE, tick)) {
+    controllerPidRate(control, &rateDesired, &sensors->gyro);
+  }
+#endif
+
   if (control->thrust == 0)
   {
     control->thrust = 0;
@@ -108,7 +131,12 @@ void controllerPid(control_t *control, setpoint_t *setpoint,
     control->pitch = 0;
     control->yaw = 0;
 
+#ifdef STABILIZER_FAST_RATE_LOOP
+    // The rate PID's belong to the fast rate loop, which resets them itself
+    attitudeControllerResetAttitudePID();
+#else
     attitudeControllerResetAllPID();
+#endif
     positionControllerResetAllPID();
 
     // Reset the calculated YAW angle for rate control
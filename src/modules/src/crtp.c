@@ -39,6 +39,7 @@
 #include "info.h"
 #include "cfassert.h"
 #include "queuemonitor.h"
+#include "static_mem.h"
 
 #include "log.h"
 
@@ -79,6 +80,9 @@ static xQueueHandle queues[CRTP_NBR_OF_PORTS];
 static volatile CrtpCallback callbacks[CRTP_NBR_OF_PORTS];
 static void updateStats();
 
+STATIC_MEM_TASK_ALLOC(crtpTxTask, CRTP_TX_TASK_STACKSIZE);
+STATIC_MEM_TASK_ALLOC(crtpRxTask, CRTP_RX_TASK_STACKSIZE);
+
 void crtpInit(void)
 {
   if(isInit)
@@ -87,10 +91,8 @@ void crtpInit(void)
   txQueue = xQueueCreate(CRTP_TX_QUEUE_SIZE, sizeof(CRTPPacket));
   DEBUG_QUEUE_MONITOR_REGISTER(txQueue);
 
-  xTaskCreate(crtpTxTask, CRTP_TX_TASK_NAME,
-              CRTP_TX_TASK_STACKSIZE, NULL, CRTP_TX_TASK_PRI, NULL);
-  xTaskCreate(crtpRxTask, CRTP_RX_TASK_NAME,
-              CRTP_RX_TASK_STACKSIZE, NULL, CRTP_RX_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(crtpTxTask, crtpTxTask, CRTP_TX_TASK_NAME, NULL, CRTP_TX_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(crtpRxTask, crtpRxTask, CRTP_RX_TASK_NAME, NULL, CRTP_RX_TASK_PRI, NULL);
 
   /* Start Rx/Tx tasks */
 
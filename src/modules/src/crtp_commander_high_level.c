@@ -54,6 +54,7 @@ such as: take-off, landing, polynomial trajectories.
 #include "planner.h"
 #include "log.h"
 #include "param.h"
+#include "static_mem.h"
 
 // Local types
 enum TrajectoryLocation_e {
@@ -177,6 +178,8 @@ bool isInGroup(uint8_t g) {
   return g == 0 || (g & group_mask) != 0;
 }
 
+STATIC_MEM_TASK_ALLOC(crtpCommanderHighLevelTask, CMD_HIGH_LEVEL_TASK_STACKSIZE);
+
 void crtpCommanderHighLevelInit(void)
 {
   if (isInit) {
@@ -186,8 +189,7 @@ void crtpCommanderHighLevelInit(void)
   plan_init(&planner);
 
   //Start the trajectory task
-  xTaskCreate(crtpCommanderHighLevelTask, CMD_HIGH_LEVEL_TASK_NAME,
-              CMD_HIGH_LEVEL_TASK_STACKSIZE, NULL, CMD_HIGH_LEVEL_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(crtpCommanderHighLevelTask, crtpCommanderHighLevelTask, CMD_HIGH_LEVEL_TASK_NAME, NULL, CMD_HIGH_LEVEL_TASK_PRI, NULL);
 
   lockTraj = xSemaphoreCreateMutex();
 
@@ -0,0 +1,327 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dynamic_notch.c - Notch filters tracking the gyro vibration peaks
+ *
+ * The sensor task queues gyro samples and a low priority task computes the
+ * windowed spectrum of the last DYN_NOTCH_FFT_SIZE samples of each axis. The
+ * strongest peaks of the summed spectrum move the notch filters that the
+ * sensor task applies at full rate.
+ */
+#define DEBUG_MODULE "DYNNOTCH"
+
+#include "dynamic_notch.h"
+
+#ifdef DYNAMIC_NOTCH
+
+#include <math.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "config.h"
+#include "system.h"
+#include "param.h"
+#include "log.h"
+#include "debug.h"
+#include "cf_math.h"
+#include "biquad_cascade.h"
+#include "static_mem.h"
+
+#define DYN_NOTCH_FFT_SIZE 256
+// New samples between two spectra
+#define DYN_NOTCH_FFT_HOP 32
+#define DYN_NOTCH_QUEUE_LENGTH (2 * DYN_NOTCH_FFT_HOP)
+// A peak must be this many times the mean of the searched band
+#define DYN_NOTCH_PEAK_THRESHOLD 2.0f
+// Low pass of the notch center frequencies between spectra
+#define DYN_NOTCH_SMOOTHING 0.3f
+
+#define M_PI_F (float)M_PI
+
+static bool isInit = false;
+static float sampleFreq;
+static xQueueHandle sampleQueue;
+static uint32_t droppedSamples;
+
+static float history[3][DYN_NOTCH_FFT_SIZE];
+static uint16_t historyIndex;
+static uint16_t historyCount;
+static float window[DYN_NOTCH_FFT_SIZE];
+static float fftIn[DYN_NOTCH_FFT_SIZE];
+static float fftOut[DYN_NOTCH_FFT_SIZE];
+static float spectrum[DYN_NOTCH_FFT_SIZE / 2];
+static arm_rfft_fast_instance_f32 fft;
+
+// Written by the notch task, read by the sensor task when the count changes
+static float peakFreq[DYN_NOTCH_MAX_PEAKS];
+static volatile uint32_t peakUpdateCount;
+
+// Only used by the sensor task
+static biquadCascade3Data notches;
+static uint32_t appliedUpdateCount;
+
+static uint8_t enable = 0;
+static float minFreq = 80.0f;
+static float maxFreq = 450.0f;
+static float notchQ = 3.0f;
+
+static void dynamicNotchTask(void* param);
+static void dynamicNotchUpdatePeaks(void);
+static void dynamicNotchClearPeaks(void);
+
+STATIC_MEM_TASK_ALLOC(dynamicNotchTask, DYN_NOTCH_TASK_STACKSIZE);
+
+void dynamicNotchInit(float freq)
+{
+  if (isInit)
+  {
+    return;
+  }
+
+  sampleFreq = freq;
+  sampleQueue = xQueueCreate(DYN_NOTCH_QUEUE_LENGTH, sizeof(Axis3f));
+
+  // Hann window
+  for (int i = 0; i < DYN_NOTCH_FFT_SIZE; i++)
+  {
+    window[i] = 0.5f * (1.0f - cosf(2.0f * M_PI_F * i / (DYN_NOTCH_FFT_SIZE - 1)));
+  }
+  arm_rfft_fast_init_f32(&fft, DYN_NOTCH_FFT_SIZE);
+  biquadCascade3InitNotch(&notches, DYN_NOTCH_MAX_PEAKS);
+
+  STATIC_MEM_TASK_CREATE(dynamicNotchTask, dynamicNotchTask, DYN_NOTCH_TASK_NAME, NULL, DYN_NOTCH_TASK_PRI, NULL);
+
+  isInit = true;
+}
+
+bool dynamicNotchTest(void)
+{
+  return isInit;
+}
+
+void dynamicNotchPush(const Axis3f* gyro)
+{
+  if (!enable)
+  {
+    return;
+  }
+
+  if (xQueueSend(sampleQueue, gyro, 0) != pdTRUE)
+  {
+    droppedSamples++;
+  }
+}
+
+void dynamicNotchApply(Axis3f* gyro)
+{
+  uint32_t updateCount = peakUpdateCount;
+  if (updateCount != appliedUpdateCount)
+  {
+    appliedUpdateCount = updateCount;
+    for (int i = 0; i < DYN_NOTCH_MAX_PEAKS; i++)
+    {
+      biquadCascade3SetNotch(&notches, i, sampleFreq, peakFreq[i], notchQ);
+    }
+  }
+
+  biquadCascade3Apply(&notches, gyro, 1);
+}
+
+static void dynamicNotchTask(void* param)
+{
+  Axis3f sample;
+  uint32_t newSamples = 0;
+
+  systemWaitStart();
+
+  while (1)
+  {
+    if (xQueueReceive(sampleQueue, &sample, M2T(100)) != pdTRUE)
+    {
+      if (!enable)
+      {
+        dynamicNotchClearPeaks();
+      }
+      continue;
+    }
+
+    history[0][historyIndex] = sample.x;
+    history[1][historyIndex] = sample.y;
+    history[2][historyIndex] = sample.z;
+    historyIndex = (historyIndex + 1) % DYN_NOTCH_FFT_SIZE;
+    if (historyCount < DYN_NOTCH_FFT_SIZE)
+    {
+      historyCount++;
+    }
+
+    newSamples++;
+    if (historyCount == DYN_NOTCH_FFT_SIZE && newSamples >= DYN_NOTCH_FFT_HOP)
+    {
+      newSamples = 0;
+      dynamicNotchUpdatePeaks();
+    }
+  }
+}
+
+static void dynamicNotchUpdatePeaks(void)
+{
+  const float binFreq = sampleFreq / DYN_NOTCH_FFT_SIZE;
+
+  memset(spectrum, 0, sizeof(spectrum));
+  for (int axis = 0; axis < 3; axis++)
+  {
+    for (int i = 0; i < DYN_NOTCH_FFT_SIZE; i++)
+    {
+      fftIn[i] = history[axis][(historyIndex + i) % DYN_NOTCH_FFT_SIZE] * window[i];
+    }
+    arm_rfft_fast_f32(&fft, fftIn, fftOut, 0);
+
+    // Output is packed as DC, Nyquist and then real, imaginary pairs
+    for (int bin = 1; bin < DYN_NOTCH_FFT_SIZE / 2; bin++)
+    {
+      float re = fftOut[2 * bin];
+      float im = fftOut[2 * bin + 1];
+      spectrum[bin] += re * re + im * im;
+    }
+  }
+
+  int minBin = (int)(minFreq / binFreq);
+  int maxBin = (int)(maxFreq / binFreq);
+  if (minBin < 2)
+  {
+    minBin = 2;
+  }
+  if (maxBin > DYN_NOTCH_FFT_SIZE / 2 - 2)
+  {
+    maxBin = DYN_NOTCH_FFT_SIZE / 2 - 2;
+  }
+  if (minBin > maxBin)
+  {
+    return;
+  }
+
+  float mean = 0.0f;
+  for (int bin = minBin; bin <= maxBin; bin++)
+  {
+    spectrum[bin] = sqrtf(spectrum[bin]);
+    mean += spectrum[bin];
+  }
+  mean /= (maxBin - minBin + 1);
+  // Neighbours of the searched band are needed for the interpolation
+  spectrum[minBin - 1] = sqrtf(spectrum[minBin - 1]);
+  spectrum[maxBin + 1] = sqrtf(spectrum[maxBin + 1]);
+
+  // Strongest local maxima, strongest first
+  float found[DYN_NOTCH_MAX_PEAKS] = {0};
+  float foundMagnitude[DYN_NOTCH_MAX_PEAKS] = {0};
+  for (int bin = minBin; bin <= maxBin; bin++)
+  {
+    float m = spectrum[bin];
+    if (m <= mean * DYN_NOTCH_PEAK_THRESHOLD || m <= spectrum[bin - 1] || m < spectrum[bin + 1])
+    {
+      continue;
+    }
+
+    int slot = DYN_NOTCH_MAX_PEAKS;
+    while (slot > 0 && m > foundMagnitude[slot - 1])
+    {
+      slot--;
+    }
+    if (slot == DYN_NOTCH_MAX_PEAKS)
+    {
+      continue;
+    }
+    for (int i = DYN_NOTCH_MAX_PEAKS - 1; i > slot; i--)
+    {
+      found[i] = found[i - 1];
+      foundMagnitude[i] = foundMagnitude[i - 1];
+    }
+
+    // Parabolic interpolation between the bins
+    float left = spectrum[bin - 1];
+    float right = spectrum[bin + 1];
+    float offset = 0.5f * (left - right) / (left - 2.0f * m + right);
+    found[slot] = (bin + offset) * binFreq;
+    foundMagnitude[slot] = m;
+  }
+
+  // Keep the notches sorted on frequency so that they follow their peak
+  for (int i = 1; i < DYN_NOTCH_MAX_PEAKS; i++)
+  {
+    for (int j = i; j > 0 && found[j] > 0.0f && (found[j - 1] == 0.0f || found[j] < found[j - 1]); j--)
+    {
+      float tmp = found[j];
+      found[j] = found[j - 1];
+      found[j - 1] = tmp;
+    }
+  }
+
+  for (int i = 0; i < DYN_NOTCH_MAX_PEAKS; i++)
+  {
+    if (found[i] > 0.0f && peakFreq[i] > 0.0f)
+    {
+      peakFreq[i] += (found[i] - peakFreq[i]) * DYN_NOTCH_SMOOTHING;
+    }
+    else
+    {
+      peakFreq[i] = found[i];
+    }
+  }
+  peakUpdateCount++;
+}
+
+static void dynamicNotchClearPeaks(void)
+{
+  historyCount = 0;
+
+  bool isActive = false;
+  for (int i = 0; i < DYN_NOTCH_MAX_PEAKS; i++)
+  {
+    isActive |= peakFreq[i] > 0.0f;
+    peakFreq[i] = 0.0f;
+  }
+
+  if (isActive)
+  {
+    peakUpdateCount++;
+  }
+}
+
+PARAM_GROUP_START(dynNotch)
+PARAM_ADD(PARAM_UINT8, enable, &enable)
+PARAM_ADD(PARAM_FLOAT, minHz, &minFreq)
+PARAM_ADD(PARAM_FLOAT, maxHz, &maxFreq)
+PARAM_ADD(PARAM_FLOAT, q, &notchQ)
+PARAM_GROUP_STOP(dynNotch)
+
+LOG_GROUP_START(dynNotch)
+LOG_ADD(LOG_FLOAT, peak1, &peakFreq[0])
+LOG_ADD(LOG_FLOAT, peak2, &peakFreq[1])
+LOG_ADD(LOG_FLOAT, peak3, &peakFreq[2])
+LOG_ADD(LOG_UINT32, dropped, &droppedSamples)
+LOG_GROUP_STOP(dynNotch)
+
+#endif // DYNAMIC_NOTCH
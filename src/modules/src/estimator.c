@@ -23,6 +23,7 @@ typedef struct {
   bool (*estimatorEnqueueTOF)(const tofMeasurement_t *tof);
   bool (*estimatorEnqueueAbsoluteHeight)(const heightMeasurement_t *height);
   bool (*estimatorEnqueueFlow)(const flowMeasurement_t *flow);
+  bool (*estimatorEnqueueSweepAngle)(const sweepAngleMeasurement_t *angle);
 } EstimatorFcns;
 
 #define NOT_IMPLEMENTED ((void*)0)
@@ -40,6 +41,7 @@ static EstimatorFcns estimatorFunctions[] = {
     .estimatorEnqueueTOF = NOT_IMPLEMENTED,
     .estimatorEnqueueAbsoluteHeight = NOT_IMPLEMENTED,
     .estimatorEnqueueFlow = NOT_IMPLEMENTED,
+    .estimatorEnqueueSweepAngle = NOT_IMPLEMENTED,
   }, // Any estimator
   {
     .init = estimatorComplementaryInit,
@@ -53,6 +55,7 @@ static EstimatorFcns estimatorFunctions[] = {
     .estimatorEnqueueTOF = NOT_IMPLEMENTED,
     .estimatorEnqueueAbsoluteHeight = NOT_IMPLEMENTED,
     .estimatorEnqueueFlow = NOT_IMPLEMENTED,
+    .estimatorEnqueueSweepAngle = NOT_IMPLEMENTED,
   },
   {
     .init = estimatorKalmanInit,
@@ -66,6 +69,7 @@ static EstimatorFcns estimatorFunctions[] = {
     .estimatorEnqueueTOF = estimatorKalmanEnqueueTOF,
     .estimatorEnqueueAbsoluteHeight = estimatorKalmanEnqueueAbsoluteHeight,
     .estimatorEnqueueFlow = estimatorKalmanEnqueueFlow,
+    .estimatorEnqueueSweepAngle = estimatorKalmanEnqueueSweepAngle,
     },
 };
 
@@ -169,3 +173,11 @@ bool estimatorEnqueueFlow(const flowMeasurement_t *flow) {
   return false;
 }
 
+bool estimatorEnqueueSweepAngle(const sweepAngleMeasurement_t *angle) {
+  if (estimatorFunctions[currentEstimator].estimatorEnqueueSweepAngle) {
+    return estimatorFunctions[currentEstimator].estimatorEnqueueSweepAngle(angle);
+  }
+
+  return false;
+}
+
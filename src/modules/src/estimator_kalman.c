@@ -57,6 +57,7 @@
  */
 
 #include "kalman_core.h"
+#include "kalman_sweep_angle.h"
 #include "estimator_kalman.h"
 
 
@@ -66,6 +67,8 @@
 #include "queue.h"
 #include "task.h"
 #include "sensors.h"
+#include "usec_time.h"
+#include "queuemonitor.h"
 
 #include "log.h"
 #include "param.h"
@@ -112,7 +115,7 @@ static inline bool stateEstimatorHasPoseMeasurement(poseMeasurement_t *pose) {
 
 // Measurements of a UWB Tx/Rx
 static xQueueHandle tdoaDataQueue;
-#define UWB_QUEUE_LENGTH (10)
+#define UWB_QUEUE_LENGTH (20)
 
 static inline bool stateEstimatorHasTDOAPacket(tdoaMeasurement_t *uwb) {
   return (pdTRUE == xQueueReceive(tdoaDataQueue, uwb, 0));
@@ -143,6 +146,14 @@ static inline bool stateEstimatorHasHeightPacket(heightMeasurement_t *height) {
   return (pdTRUE == xQueueReceive(heightDataQueue, height, 0));
 }
 
+// Measurements of Lighthouse sweep angles
+static xQueueHandle sweepAnglesDataQueue;
+#define SWEEP_ANGLES_QUEUE_LENGTH (20)
+
+static inline bool stateEstimatorHasSweepAnglesPacket(sweepAngleMeasurement_t *angles) {
+  return (pdTRUE == xQueueReceive(sweepAnglesDataQueue, angles, 0));
+}
+
 /**
  * Constants used in the estimator
  */
@@ -157,6 +168,7 @@ static inline bool stateEstimatorHasHeightPacket(heightMeasurement_t *height) {
  * Tuning parameters
  */
 #define PREDICT_RATE RATE_100_HZ // this is slower than the IMU update rate of 500Hz
+#define PREDICT_PERIOD_US (1000000 / PREDICT_RATE)
 #define BARO_RATE RATE_25_HZ
 
 // the point at which the dynamics change from stationary to flying
@@ -188,9 +200,10 @@ static kalmanCoreData_t coreData;
  */
 
 static bool isInit = false;
-static int32_t lastPrediction;
+static uint64_t imuTimestamp;
+static uint64_t lastPrediction;
 static int32_t lastBaroUpdate;
-static int32_t lastPNUpdate;
+static uint64_t lastPNUpdate;
 static Axis3f accAccumulator;
 static float thrustAccumulator;
 static Axis3f gyroAccumulator;
@@ -230,7 +243,7 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
   // Tracks whether an update to the state has been made, and the state therefore requires finalization
   bool doneUpdate = false;
 
-  uint32_t osTick = xTaskGetTickCount(); // would be nice if this had a precision higher than 1ms...
+  uint32_t osTick = xTaskGetTickCount();
 
 #ifdef KALMAN_DECOUPLE_XY
   kalmanCoreDecoupleXY(this);
@@ -251,6 +264,13 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     gyroAccumulator.y += sensors->gyro.y;
     gyroAccumulator.z += sensors->gyro.z;
     gyroAccumulatorCount++;
+
+    // Prediction and process noise run on the IMU sample time, fall back to
+    // the time of reading if the sensor driver does not timestamp its samples
+    if (!sensorsReadImuTimestamp(&imuTimestamp)) {
+      imuTimestamp = usecTimestamp();
+    }
+    sensors->interruptTimestamp = imuTimestamp;
   }
 
   // Average the thrust command from the last time steps, generated externally by the controller
@@ -258,7 +278,7 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
   thrustAccumulatorCount++;
 
   // Run the system dynamics to predict the state forward.
-  if ((osTick-lastPrediction) >= configTICK_RATE_HZ/PREDICT_RATE // update at the PREDICT_RATE
+  if (imuTimestamp >= lastPrediction + PREDICT_PERIOD_US // update at the PREDICT_RATE
       && gyroAccumulatorCount > 0
       && accAccumulatorCount > 0
       && thrustAccumulatorCount > 0)
@@ -296,10 +316,10 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     }
     quadIsFlying = (xTaskGetTickCount()-lastFlightCmd) < IN_FLIGHT_TIME_THRESHOLD;
 
-    float dt = (float)(osTick-lastPrediction)/configTICK_RATE_HZ;
+    float dt = (float)(imuTimestamp - lastPrediction) / 1000000.0f;
     kalmanCorePredict(&coreData, thrustAccumulator, &accAccumulator, &gyroAccumulator, dt, quadIsFlying);
 
-    lastPrediction = osTick;
+    lastPrediction = imuTimestamp;
 
     accAccumulator = (Axis3f){.axis={0}};
     accAccumulatorCount = 0;
@@ -315,8 +335,10 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
   /**
    * Add process noise every loop, rather than every prediction
    */
-  kalmanCoreAddProcessNoise(&coreData, (float)(osTick-lastPNUpdate)/configTICK_RATE_HZ);
-  lastPNUpdate = osTick;
+  if (imuTimestamp > lastPNUpdate) {
+    kalmanCoreAddProcessNoise(&coreData, (float)(imuTimestamp - lastPNUpdate) / 1000000.0f);
+    lastPNUpdate = imuTimestamp;
+  }
 
 
 
@@ -398,6 +420,13 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     doneUpdate = true;
   }
 
+  sweepAngleMeasurement_t sweep;
+  while (stateEstimatorHasSweepAnglesPacket(&sweep))
+  {
+    kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+    doneUpdate = true;
+  }
+
   /**
    * If an update has been made, the state is finalized:
    * - the attitude error is moved into the body attitude quaternion,
@@ -443,6 +472,15 @@ void estimatorKalmanInit(void) {
     flowDataQueue = xQueueCreate(FLOW_QUEUE_LENGTH, sizeof(flowMeasurement_t));
     tofDataQueue = xQueueCreate(TOF_QUEUE_LENGTH, sizeof(tofMeasurement_t));
     heightDataQueue = xQueueCreate(HEIGHT_QUEUE_LENGTH, sizeof(heightMeasurement_t));
+    sweepAnglesDataQueue = xQueueCreate(SWEEP_ANGLES_QUEUE_LENGTH, sizeof(sweepAngleMeasurement_t));
+    DEBUG_QUEUE_MONITOR_REGISTER(distDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(posDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(poseDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(tdoaDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(flowDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(tofDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(heightDataQueue);
+    DEBUG_QUEUE_MONITOR_REGISTER(sweepAnglesDataQueue);
   }
   else
   {
@@ -452,12 +490,14 @@ void estimatorKalmanInit(void) {
     xQueueReset(tdoaDataQueue);
     xQueueReset(flowDataQueue);
     xQueueReset(tofDataQueue);
+    xQueueReset(sweepAnglesDataQueue);
   }
 
-  lastPrediction = xTaskGetTickCount();
+  imuTimestamp = usecTimestamp();
+  lastPrediction = imuTimestamp;
   lastBaroUpdate = xTaskGetTickCount();
   lastTDOAUpdate = xTaskGetTickCount();
-  lastPNUpdate = xTaskGetTickCount();
+  lastPNUpdate = imuTimestamp;
 
   accAccumulator = (Axis3f){.axis={0}};
   gyroAccumulator = (Axis3f){.axis={0}};
@@ -492,49 +532,79 @@ static bool stateEstimatorEnqueueExternalMeasurement(xQueueHandle queue, void *m
   return (result==pdTRUE);
 }
 
+// Measurements that the producer did not timestamp are stamped at enqueue time
+static inline void stateEstimatorStampExternalMeasurement(uint64_t *timestamp)
+{
+  if (*timestamp == 0) {
+    *timestamp = usecTimestamp();
+  }
+}
+
 bool estimatorKalmanEnqueueTDOA(const tdoaMeasurement_t *uwb)
 {
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(tdoaDataQueue, (void *)uwb);
+  tdoaMeasurement_t measurement = *uwb;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(tdoaDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueuePosition(const positionMeasurement_t *pos)
 {
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(posDataQueue, (void *)pos);
+  positionMeasurement_t measurement = *pos;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(posDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueuePose(const poseMeasurement_t *pose)
 {
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(poseDataQueue, (void *)pose);
+  poseMeasurement_t measurement = *pose;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(poseDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueueDistance(const distanceMeasurement_t *dist)
 {
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(distDataQueue, (void *)dist);
+  distanceMeasurement_t measurement = *dist;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(distDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueueFlow(const flowMeasurement_t *flow)
 {
   // A flow measurement (dnx,  dny) [accumulated pixels]
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(flowDataQueue, (void *)flow);
+  flowMeasurement_t measurement = *flow;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(flowDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueueTOF(const tofMeasurement_t *tof)
 {
   // A distance (distance) [m] to the ground along the z_B axis.
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(tofDataQueue, (void *)tof);
+  tofMeasurement_t measurement = *tof;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(tofDataQueue, &measurement);
 }
 
 bool estimatorKalmanEnqueueAbsoluteHeight(const heightMeasurement_t *height)
 {
   // A distance (height) [m] to the ground along the z axis.
   ASSERT(isInit);
-  return stateEstimatorEnqueueExternalMeasurement(heightDataQueue, (void *)height);
+  heightMeasurement_t measurement = *height;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(heightDataQueue, &measurement);
+}
+
+bool estimatorKalmanEnqueueSweepAngle(const sweepAngleMeasurement_t *angle)
+{
+  ASSERT(isInit);
+  sweepAngleMeasurement_t measurement = *angle;
+  stateEstimatorStampExternalMeasurement(&measurement.timestamp);
+  return stateEstimatorEnqueueExternalMeasurement(sweepAnglesDataQueue, &measurement);
 }
 
 bool estimatorKalmanTest(void)
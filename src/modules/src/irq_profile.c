@@ -0,0 +1,205 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * irq_profile.c - Count and duration of the interrupt handlers
+ *
+ * The instrumented handlers are timed with the DWT cycle counter. For each
+ * one the number of calls, the longest and the total number of cycles and how
+ * many calls interrupted a stabilizer loop iteration are recorded. Time spent
+ * in a higher priority interrupt that preempts a handler is included in the
+ * handler.
+ *
+ * Every second the load of each handler, in permille of the CPU, is updated in
+ * the irq* log groups. Set irqProfile.dump to print all handlers on the
+ * console and irqProfile.reset to clear the statistics.
+ */
+#define DEBUG_MODULE "IRQPROF"
+
+#include "irq_profile.h"
+
+#ifdef IRQ_PROFILE
+
+#include <string.h>
+
+#include "stm32fxxx.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "debug.h"
+#include "log.h"
+#include "param.h"
+
+#define TIMER_PERIOD M2T(1000)
+
+typedef struct {
+  uint32_t count;
+  uint32_t max;
+  uint32_t total;
+  uint32_t preempt;
+  uint32_t previousTotal;
+  uint16_t load;
+} irqStats_t;
+
+static irqStats_t stats[IRQ_PROFILE_COUNT];
+static volatile bool stabilizerBusy;
+static uint32_t previousSample;
+static uint8_t triggerDump;
+static uint8_t triggerReset;
+
+static const char* const irqNames[IRQ_PROFILE_COUNT] = {
+  [irqProfileExti0] = "exti0",
+  [irqProfileExti1] = "exti1",
+  [irqProfileExti2] = "exti2",
+  [irqProfileExti3] = "exti3",
+  [irqProfileExti4] = "exti4",
+  [irqProfileExti9_5] = "exti9_5",
+  [irqProfileExti15_10] = "exti15_10",
+  [irqProfileI2c1Ev] = "i2c1Ev",
+  [irqProfileI2c1Er] = "i2c1Er",
+  [irqProfileI2c1Dma] = "i2c1Dma",
+  [irqProfileI2c3Ev] = "i2c3Ev",
+  [irqProfileI2c3Er] = "i2c3Er",
+  [irqProfileI2c3Dma] = "i2c3Dma",
+  [irqProfileDeckSpiTx] = "deckSpiTx",
+  [irqProfileDeckSpiRx] = "deckSpiRx",
+  [irqProfileImuSpiTx] = "imuSpiTx",
+  [irqProfileImuSpiRx] = "imuSpiRx",
+  [irqProfileSyslinkUart] = "slkUart",
+  [irqProfileSyslinkDma] = "slkDma",
+  [irqProfileUart1] = "uart1",
+  [irqProfileUart1RxDma] = "uart1RxDma",
+  [irqProfileUart2] = "uart2",
+  [irqProfileUsb] = "usb",
+};
+
+static void timerHandler(xTimerHandle timer);
+
+void irqProfileInit(void)
+{
+  cycleCounterInit();
+  previousSample = cycleCounterGet();
+
+  xTimerHandle timer = xTimerCreate("irqProfileTimer", TIMER_PERIOD, pdTRUE, NULL, timerHandler);
+  xTimerStart(timer, 100);
+}
+
+void irqProfileRecord(const irqProfileIrq_t irq, const uint32_t startCycles)
+{
+  uint32_t cycles = cycleCounterGet() - startCycles;
+  irqStats_t* irqStats = &stats[irq];
+
+  irqStats->count++;
+  irqStats->total += cycles;
+  if (cycles > irqStats->max) {
+    irqStats->max = cycles;
+  }
+  if (stabilizerBusy) {
+    irqStats->preempt++;
+  }
+}
+
+void irqProfileSetStabilizerBusy(const bool busy)
+{
+  stabilizerBusy = busy;
+}
+
+static void dump(void)
+{
+  DEBUG_PRINT("IRQ dump\n");
+  DEBUG_PRINT("Name\tCount\tMax\tTotal\tPreempt\tLoad\n");
+  for (int i = 0; i < IRQ_PROFILE_COUNT; i++) {
+    irqStats_t* irqStats = &stats[i];
+    if (irqStats->count > 0) {
+      DEBUG_PRINT("%s\t%u\t%u\t%u\t%u\t%u.%u\n", irqNames[i],
+                  (unsigned int)irqStats->count, (unsigned int)irqStats->max,
+                  (unsigned int)irqStats->total, (unsigned int)irqStats->preempt,
+                  irqStats->load / 10, irqStats->load % 10);
+    }
+  }
+}
+
+static void timerHandler(xTimerHandle timer)
+{
+  uint32_t now = cycleCounterGet();
+  uint32_t elapsed = now - previousSample;
+  previousSample = now;
+
+  for (int i = 0; i < IRQ_PROFILE_COUNT; i++) {
+    irqStats_t* irqStats = &stats[i];
+    uint32_t total = irqStats->total;
+    irqStats->load = ((uint64_t)(total - irqStats->previousTotal) * 1000) / elapsed;
+    irqStats->previousTotal = total;
+  }
+
+  if (triggerDump) {
+    dump();
+    triggerDump = 0;
+  }
+
+  if (triggerReset) {
+    // Handlers above the FreeRTOS syscall priority are instrumented too, so
+    // all interrupts are masked and not only the ones taskENTER_CRITICAL masks
+    __disable_irq();
+    memset(stats, 0, sizeof(stats));
+    __enable_irq();
+    triggerReset = 0;
+  }
+}
+
+PARAM_GROUP_START(irqProfile)
+PARAM_ADD(PARAM_UINT8, dump, &triggerDump)
+PARAM_ADD(PARAM_UINT8, reset, &triggerReset)
+PARAM_GROUP_STOP(irqProfile)
+
+#define IRQ_LOG_GROUP(NAME, IRQ) \
+  LOG_GROUP_START(NAME) \
+  LOG_ADD(LOG_UINT32, cnt, &stats[IRQ].count) \
+  LOG_ADD(LOG_UINT32, max, &stats[IRQ].max) \
+  LOG_ADD(LOG_UINT16, load, &stats[IRQ].load) \
+  LOG_GROUP_STOP(NAME)
+
+IRQ_LOG_GROUP(irqExti0, irqProfileExti0)
+IRQ_LOG_GROUP(irqExti1, irqProfileExti1)
+IRQ_LOG_GROUP(irqExti2, irqProfileExti2)
+IRQ_LOG_GROUP(irqExti3, irqProfileExti3)
+IRQ_LOG_GROUP(irqExti4, irqProfileExti4)
+IRQ_LOG_GROUP(irqExti9_5, irqProfileExti9_5)
+IRQ_LOG_GROUP(irqExti15_10, irqProfileExti15_10)
+IRQ_LOG_GROUP(irqI2c1Ev, irqProfileI2c1Ev)
+IRQ_LOG_GROUP(irqI2c1Er, irqProfileI2c1Er)
+IRQ_LOG_GROUP(irqI2c1Dma, irqProfileI2c1Dma)
+IRQ_LOG_GROUP(irqI2c3Ev, irqProfileI2c3Ev)
+IRQ_LOG_GROUP(irqI2c3Er, irqProfileI2c3Er)
+IRQ_LOG_GROUP(irqI2c3Dma, irqProfileI2c3Dma)
+IRQ_LOG_GROUP(irqDeckSpiTx, irqProfileDeckSpiTx)
+IRQ_LOG_GROUP(irqDeckSpiRx, irqProfileDeckSpiRx)
+IRQ_LOG_GROUP(irqImuSpiTx, irqProfileImuSpiTx)
+IRQ_LOG_GROUP(irqImuSpiRx, irqProfileImuSpiRx)
+IRQ_LOG_GROUP(irqSyslinkUart, irqProfileSyslinkUart)
+IRQ_LOG_GROUP(irqSyslinkDma, irqProfileSyslinkDma)
+IRQ_LOG_GROUP(irqUart1, irqProfileUart1)
+IRQ_LOG_GROUP(irqUart1RxDma, irqProfileUart1RxDma)
+IRQ_LOG_GROUP(irqUart2, irqProfileUart2)
+IRQ_LOG_GROUP(irqUsb, irqProfileUsb)
+
+#endif // IRQ_PROFILE
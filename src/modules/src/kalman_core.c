@@ -223,7 +223,7 @@ void kalmanCoreInit(kalmanCoreData_t* this) {
   this->baroReferenceHeight = 0.0;
 }
 
-static void scalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
+void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
 {
   // The Kalman gain as a column vector
   static float K[KC_STATE_DIM];
@@ -307,14 +307,14 @@ void kalmanCoreUpdateWithBaro(kalmanCoreData_t* this, baro_t *baro, bool quadIsF
   }
 
   float meas = (baro->asl - this->baroReferenceHeight);
-  scalarUpdate(this, &H, meas - this->S[KC_STATE_Z], measNoiseBaro);
+  kalmanCoreScalarUpdate(this, &H, meas - this->S[KC_STATE_Z], measNoiseBaro);
 }
 
 void kalmanCoreUpdateWithAbsoluteHeight(kalmanCoreData_t* this, heightMeasurement_t* height) {
   float h[KC_STATE_DIM] = {0};
   arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
   h[KC_STATE_Z] = 1;
-  scalarUpdate(this, &H, height->height - this->S[KC_STATE_Z], height->stdDev);
+  kalmanCoreScalarUpdate(this, &H, height->height - this->S[KC_STATE_Z], height->stdDev);
 }
 
 void kalmanCoreUpdateWithPosition(kalmanCoreData_t* this, positionMeasurement_t *xyz)
@@ -325,7 +325,7 @@ void kalmanCoreUpdateWithPosition(kalmanCoreData_t* this, positionMeasurement_t
     float h[KC_STATE_DIM] = {0};
     arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
     h[KC_STATE_X+i] = 1;
-    scalarUpdate(this, &H, xyz->pos[i] - this->S[KC_STATE_X+i], xyz->stdDev);
+    kalmanCoreScalarUpdate(this, &H, xyz->pos[i] - this->S[KC_STATE_X+i], xyz->stdDev);
   }
 }
 
@@ -337,7 +337,7 @@ void kalmanCoreUpdateWithPose(kalmanCoreData_t* this, poseMeasurement_t *pose)
     float h[KC_STATE_DIM] = {0};
     arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
     h[KC_STATE_X+i] = 1;
-    scalarUpdate(this, &H, pose->pos[i] - this->S[KC_STATE_X+i], pose->stdDevPos);
+    kalmanCoreScalarUpdate(this, &H, pose->pos[i] - this->S[KC_STATE_X+i], pose->stdDevPos);
   }
 
   // compute orientation error
@@ -352,15 +352,15 @@ void kalmanCoreUpdateWithPose(kalmanCoreData_t* this, poseMeasurement_t *pose)
     float h[KC_STATE_DIM] = {0};
     arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
     h[KC_STATE_D0] = 1;
-    scalarUpdate(this, &H, err_quat.x, pose->stdDevQuat);
+    kalmanCoreScalarUpdate(this, &H, err_quat.x, pose->stdDevQuat);
     h[KC_STATE_D0] = 0;
 
     h[KC_STATE_D1] = 1;
-    scalarUpdate(this, &H, err_quat.y, pose->stdDevQuat);
+    kalmanCoreScalarUpdate(this, &H, err_quat.y, pose->stdDevQuat);
     h[KC_STATE_D1] = 0;
 
     h[KC_STATE_D2] = 1;
-    scalarUpdate(this, &H, err_quat.z, pose->stdDevQuat);
+    kalmanCoreScalarUpdate(this, &H, err_quat.z, pose->stdDevQuat);
   }
 }
 
@@ -392,7 +392,7 @@ void kalmanCoreUpdateWithDistance(kalmanCoreData_t* this, distanceMeasurement_t
     h[KC_STATE_Z] = 0.0f;
   }
 
-  scalarUpdate(this, &H, measuredDistance-predictedDistance, d->stdDev);
+  kalmanCoreScalarUpdate(this, &H, measuredDistance-predictedDistance, d->stdDev);
 }
 
 
@@ -451,7 +451,7 @@ void kalmanCoreUpdateWithTDOA(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa)
 
       bool sampleIsGood = outlierFilterValidateTdoaSteps(tdoa, error, &jacobian, &estimatedPosition);
       if (sampleIsGood) {
-        scalarUpdate(this, &H, error, tdoa->stdDev);
+        kalmanCoreScalarUpdate(this, &H, error, tdoa->stdDev);
       }
     }
   }
@@ -518,7 +518,7 @@ void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, flowMeasurement_t *flow, s
   hx[KC_STATE_PX] = (Npix * flow->dt / thetapix) * (this->R[2][2] / z_g);
 
   //First update
-  scalarUpdate(this, &Hx, measuredNX-predictedNX, flow->stdDevX);
+  kalmanCoreScalarUpdate(this, &Hx, measuredNX-predictedNX, flow->stdDevX);
 
   // ~~~ Y velocity prediction and update ~~~
   float hy[KC_STATE_DIM] = {0};
@@ -531,7 +531,7 @@ void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, flowMeasurement_t *flow, s
   hy[KC_STATE_PY] = (Npix * flow->dt / thetapix) * (this->R[2][2] / z_g);
 
   // Second update
-  scalarUpdate(this, &Hy, measuredNY-predictedNY, flow->stdDevY);
+  kalmanCoreScalarUpdate(this, &Hy, measuredNY-predictedNY, flow->stdDevY);
 }
 
 
@@ -558,11 +558,10 @@ void kalmanCoreUpdateWithTof(kalmanCoreData_t* this, tofMeasurement_t *tof)
     //h[KC_STATE_Z] = 1 / cosf(angle);
 
     // Scalar update
-    scalarUpdate(this, &H, measuredDistance-predictedDistance, tof->stdDev);
+    kalmanCoreScalarUpdate(this, &H, measuredDistance-predictedDistance, tof->stdDev);
   }
 }
 
-
 void kalmanCorePredict(kalmanCoreData_t* this, float cmdThrust, Axis3f *acc, Axis3f *gyro, float dt, bool quadIsFlying)
 {
   /* Here we discretize (euler forward) and linearise the quadrocopter dynamics in order
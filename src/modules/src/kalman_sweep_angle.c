@@ -0,0 +1,81 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kalman_sweep_angle.c - Lighthouse sweep angle measurement model for the
+ *                        Kalman filter
+ */
+
+#include <math.h>
+
+#include "kalman_sweep_angle.h"
+
+void kalmanCoreUpdateWithSweepAngle(kalmanCoreData_t* this, sweepAngleMeasurement_t *sweep)
+{
+  // Sensor position in the global frame, including its offset on the deck
+  float s[3];
+  for (int i = 0; i < 3; i++) {
+    s[i] = this->S[KC_STATE_X + i] - sweep->baseStationPos[i];
+    for (int j = 0; j < 3; j++) {
+      s[i] += this->R[i][j] * sweep->sensorPos[j];
+    }
+  }
+
+  // Sensor position in the base station frame, the base station looks along -z
+  float p[3];
+  for (int i = 0; i < 3; i++) {
+    p[i] = sweep->baseStationRot[i][0] * s[0] + sweep->baseStationRot[i][1] * s[1] + sweep->baseStationRot[i][2] * s[2];
+  }
+
+  // Measurement equation
+  //
+  // horizontal sweep: alpha = atan2(-x, -z)
+  // vertical sweep:   alpha = atan2(y, -z)
+  float u = (sweep->axis == 0) ? -p[0] : p[1];
+  float v = -p[2];
+  float r2 = u * u + v * v;
+
+  if (v <= 0.0f || r2 < 1e-6f) {
+    // Behind the base station or on top of it, the angle is not observable
+    return;
+  }
+
+  float predictedAngle = atan2f(u, v);
+  float error = sweep->angle - predictedAngle;
+
+  // Gradient of the angle in the base station frame
+  float g[3] = {0};
+  if (sweep->axis == 0) {
+    g[0] = -v / r2;
+  } else {
+    g[1] = v / r2;
+  }
+  g[2] = u / r2;
+
+  float h[KC_STATE_DIM] = {0};
+  arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+  for (int i = 0; i < 3; i++) {
+    h[KC_STATE_X + i] = g[0] * sweep->baseStationRot[0][i] + g[1] * sweep->baseStationRot[1][i] + g[2] * sweep->baseStationRot[2][i];
+  }
+
+  kalmanCoreScalarUpdate(this, &H, error, sweep->stdDev);
+}
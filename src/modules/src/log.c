@@ -48,6 +48,7 @@
 #include "console.h"
 #include "cfassert.h"
 #include "debug.h"
+#include "static_mem.h"
 
 #if 0
 #define LOG_DEBUG(fmt, ...) DEBUG_PRINT("D/log " fmt, ## __VA_ARGS__)
@@ -155,6 +156,8 @@ static int logStartBlock(int id, unsigned int period);
 static int logStopBlock(int id);
 static void logReset();
 
+STATIC_MEM_TASK_ALLOC(logTask, LOG_TASK_STACKSIZE);
+
 void logInit(void)
 {
   int i;
@@ -211,8 +214,7 @@ void logInit(void)
   logReset();
 
   //Start the log task
-  xTaskCreate(logTask, LOG_TASK_NAME,
-              LOG_TASK_STACKSIZE, NULL, LOG_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(logTask, logTask, LOG_TASK_NAME, NULL, LOG_TASK_PRI, NULL);
 
   isInit = true;
 }
@@ -655,7 +657,7 @@ static int logStartBlock(int id, unsigned int period)
     xTimerStart(logBlocks[i].timer, 100);
   } else {
     // single-shoot run
-    workerSchedule(logRunBlock, &logBlocks[i]);
+    workerSchedulePriority(logRunBlock, &logBlocks[i], workerPriorityHigh);
   }
 
   return 0;
@@ -681,7 +683,7 @@ static int logStopBlock(int id)
 /* This function is called by the timer subsystem */
 void logBlockTimed(xTimerHandle timer)
 {
-  workerSchedule(logRunBlock, pvTimerGetTimerID(timer));
+  workerSchedulePriority(logRunBlock, pvTimerGetTimerID(timer), workerPriorityHigh);
 }
 
 /* Appends data to a packet if space is available; returns false on failure. */
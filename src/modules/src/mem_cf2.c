@@ -50,6 +50,7 @@
 #include "console.h"
 #include "assert.h"
 #include "debug.h"
+#include "static_mem.h"
 
 #include "log.h"
 #include "param.h"
@@ -132,6 +133,8 @@ static const OwSerialNum eepromSerialNum =
 static const uint8_t noData[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 static CRTPPacket p;
 
+STATIC_MEM_TASK_ALLOC(memTask, MEM_TASK_STACKSIZE);
+
 void memInit(void)
 {
   if(isInit)
@@ -143,8 +146,7 @@ void memInit(void)
     isInit = false;
   
   //Start the mem task
-  xTaskCreate(memTask, MEM_TASK_NAME,
-              MEM_TASK_STACKSIZE, NULL, MEM_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(memTask, memTask, MEM_TASK_NAME, NULL, MEM_TASK_PRI, NULL);
 }
 
 bool memTest(void)
@@ -36,6 +36,7 @@
 #include "crc.h"
 #include "console.h"
 #include "debug.h"
+#include "static_mem.h"
 
 #if 0
 #define PARAM_DEBUG(fmt, ...) DEBUG_PRINT("D/param " fmt, ## __VA_ARGS__)
@@ -90,6 +91,8 @@ static CRTPPacket p;
 
 static bool isInit = false;
 
+STATIC_MEM_TASK_ALLOC(paramTask, PARAM_TASK_STACKSIZE);
+
 void paramInit(void)
 {
   int i;
@@ -138,8 +141,7 @@ void paramInit(void)
 
 
   //Start the param task
-	xTaskCreate(paramTask, PARAM_TASK_NAME,
-	            PARAM_TASK_STACKSIZE, NULL, PARAM_TASK_PRI, NULL);
+	STATIC_MEM_TASK_CREATE(paramTask, paramTask, PARAM_TASK_NAME, NULL, PARAM_TASK_PRI, NULL);
 
   //TODO: Handle stored parameters!
 
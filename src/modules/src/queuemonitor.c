@@ -23,24 +23,48 @@
  *
  *
  * queuemonitor.c - Monitoring functionality for queues
+ *
+ * The residency time of an item is the time from when it is sent to a queue
+ * until it is received. Up to TIME_STAMP_DEPTH items per queue carry an
+ * enqueue time stamp, identified by their position in the stream of sent
+ * items. When all time stamps are in use the next items are not timed, which
+ * spreads the measured items over a deep queue instead of only timing the
+ * first ones. The residency times are collected in a log2 histogram in
+ * microseconds from which the percentiles are computed every second.
+ *
+ * The trace hooks run with interrupts masked by the FreeRTOS critical section
+ * of the queue operation.
  */
 #define DEBUG_MODULE "QM"
 
 #include "queuemonitor.h"
 
-#ifdef DEBUG_QUEUE_MONITOR
-
 #include <stdbool.h>
+#include <string.h>
+#include "task.h"
 #include "timers.h"
 #include "debug.h"
 #include "cfassert.h"
+#include "cycle_counter.h"
+#include "log.h"
+#include "param.h"
+
+#define MAX_NR_OF_QUEUES 24
+#define TIMER_PERIOD M2T(1000)
+#define DISPLAY_PERIOD 10 // In timer periods
 
-#define MAX_NR_OF_QUEUES 20
-#define TIMER_PERIOD M2T(10000)
+#define TIME_STAMP_DEPTH 4
+#define HISTOGRAM_BINS 16
 
 #define RESET_COUNTERS_AFTER_DISPLAY true
 #define DISPLAY_ONLY_OVERFLOW_QUEUES true
 
+typedef struct
+{
+  uint16_t sequence;
+  uint32_t time;
+} TimeStamp;
+
 typedef struct
 {
   char* fileName;
@@ -48,6 +72,24 @@ typedef struct
   int sendCount;
   int maxWaiting;
   int fullCount;
+
+  // Sequence numbers of the next item to be sent and received
+  uint16_t sendSequence;
+  uint16_t receiveSequence;
+  TimeStamp timeStamps[TIME_STAMP_DEPTH];
+  uint8_t timeStampHead;
+  uint8_t timeStampCount;
+  // Residency times since the last timer period, bin n holds [2^(n-1), 2^n) us
+  uint16_t histogram[HISTOGRAM_BINS];
+  uint32_t periodMaxResidency;
+
+  // Log variables, residency times in us
+  uint8_t highWater;
+  uint16_t drops;
+  uint16_t p50;
+  uint16_t p90;
+  uint16_t p99;
+  uint16_t maxResidency;
 } Data;
 
 static Data data[MAX_NR_OF_QUEUES];
@@ -55,20 +97,26 @@ static Data data[MAX_NR_OF_QUEUES];
 static xTimerHandle timer;
 static unsigned char nrOfQueues = 1; // Unregistered queues will end up at 0
 static bool initialized = false;
+static uint32_t cyclesPerUs;
+static uint8_t triggerDump;
+static uint8_t triggerReset;
 
 static void timerHandler(xTimerHandle timer);
+#ifdef DEBUG_QUEUE_MONITOR
 static void debugPrint();
 static bool filter(Data* queueData);
 static void debugPrintQueue(Data* queueData);
-static Data* getQueueData(xQueueHandle* xQueue);
-static int getMaxWaiting(xQueueHandle* xQueue, int prevPeak);
 static void resetCounters();
-
-unsigned char ucQueueGetQueueNumber( xQueueHandle xQueue );
-
+#endif
+static void updatePercentiles(Data* queueData);
+static void dump();
+static void resetTelemetry();
 
 void queueMonitorInit() {
   ASSERT(!initialized);
+  cycleCounterInit();
+  cyclesPerUs = SystemCoreClock / 1000000;
+
   timer = xTimerCreate( "queueMonitorTimer", TIMER_PERIOD,
     pdTRUE, NULL, timerHandler );
   xTimerStart(timer, 100);
@@ -79,20 +127,95 @@ void queueMonitorInit() {
   initialized = true;
 }
 
-void qm_traceQUEUE_SEND(void* xQueue) {
-  if(initialized) {
-    Data* queueData = getQueueData(xQueue);
+void qm_traceQUEUE_SEND(unsigned int queueNumber, unsigned int waiting, unsigned int length) {
+  if (queueNumber >= nrOfQueues) {
+    return;
+  }
+
+  Data* queueData = &data[queueNumber];
+  uint32_t now = cycleCounterGet();
+
+  queueData->sendCount++;
+
+  if (waiting == 0) {
+    // Forget items that left the queue without being received, for instance
+    // by xQueueReset()
+    queueData->receiveSequence = queueData->sendSequence;
+    queueData->timeStampCount = 0;
+  }
+
+  if (waiting >= length) {
+    // xQueueOverwrite() replaces the only item of a full queue of length one
+    queueData->drops++;
+    queueData->timeStampHead = 0;
+    queueData->timeStampCount = 1;
+    queueData->timeStamps[0].sequence = queueData->receiveSequence;
+    queueData->timeStamps[0].time = now;
+    return;
+  }
+
+  // We get here before the current item is added to the queue.
+  // Must add 1 to get the peak value.
+  if ((int)waiting + 1 > queueData->maxWaiting) {
+    queueData->maxWaiting = waiting + 1;
+  }
+  if (waiting + 1 > queueData->highWater) {
+    queueData->highWater = (waiting + 1 > UINT8_MAX) ? UINT8_MAX : waiting + 1;
+  }
+
+  if (queueData->timeStampCount < TIME_STAMP_DEPTH) {
+    TimeStamp* timeStamp = &queueData->timeStamps[(queueData->timeStampHead + queueData->timeStampCount) % TIME_STAMP_DEPTH];
+    timeStamp->sequence = queueData->sendSequence;
+    timeStamp->time = now;
+    queueData->timeStampCount++;
+  }
+  queueData->sendSequence++;
+}
 
-    queueData->sendCount++;
-    queueData->maxWaiting = getMaxWaiting(xQueue, queueData->maxWaiting);
+void qm_traceQUEUE_SEND_FAILED(unsigned int queueNumber) {
+  if (queueNumber >= nrOfQueues) {
+    return;
   }
+
+  Data* queueData = &data[queueNumber];
+
+  queueData->fullCount++;
+  queueData->drops++;
 }
 
-void qm_traceQUEUE_SEND_FAILED(void* xQueue) {
-  if(initialized) {
-    Data* queueData = getQueueData(xQueue);
+void qm_traceQUEUE_RECEIVE(unsigned int queueNumber) {
+  if (queueNumber >= nrOfQueues) {
+    return;
+  }
+
+  Data* queueData = &data[queueNumber];
+  uint16_t sequence = queueData->receiveSequence++;
 
-    queueData->fullCount++;
+  // Drop time stamps of items that were never received
+  while (queueData->timeStampCount > 0 &&
+         (int16_t)(queueData->timeStamps[queueData->timeStampHead].sequence - sequence) < 0) {
+    queueData->timeStampHead = (queueData->timeStampHead + 1) % TIME_STAMP_DEPTH;
+    queueData->timeStampCount--;
+  }
+
+  if (queueData->timeStampCount == 0 ||
+      queueData->timeStamps[queueData->timeStampHead].sequence != sequence) {
+    return;
+  }
+
+  uint32_t residency = (cycleCounterGet() - queueData->timeStamps[queueData->timeStampHead].time) / cyclesPerUs;
+  queueData->timeStampHead = (queueData->timeStampHead + 1) % TIME_STAMP_DEPTH;
+  queueData->timeStampCount--;
+
+  int bin = (residency == 0) ? 0 : 32 - __builtin_clz(residency);
+  if (bin >= HISTOGRAM_BINS) {
+    bin = HISTOGRAM_BINS - 1;
+  }
+  if (queueData->histogram[bin] < UINT16_MAX) {
+    queueData->histogram[bin]++;
+  }
+  if (residency > queueData->periodMaxResidency) {
+    queueData->periodMaxResidency = residency;
   }
 }
 
@@ -108,23 +231,51 @@ void qmRegisterQueue(xQueueHandle* xQueue, char* fileName, char* queueName) {
   nrOfQueues++;
 }
 
-static Data* getQueueData(xQueueHandle* xQueue) {
-  unsigned char number = uxQueueGetQueueNumber(xQueue);
-  ASSERT(number < MAX_NR_OF_QUEUES);
-  return &data[number];
+static uint16_t percentile(const uint16_t* histogram, uint32_t total, uint32_t percent) {
+  uint32_t threshold = (total * percent + 99) / 100;
+  uint32_t count = 0;
+  int bin;
+
+  for (bin = 0; bin < HISTOGRAM_BINS - 1; bin++) {
+    count += histogram[bin];
+    if (count >= threshold) {
+      break;
+    }
+  }
+
+  // Upper limit of the bin
+  return (uint16_t)((1u << bin) > UINT16_MAX ? UINT16_MAX : (1u << bin));
 }
 
-static int getMaxWaiting(xQueueHandle* xQueue, int prevPeak) {
-  // We get here before the current item is added to the queue.
-  // Must add 1 to get the peak value.
-  unsigned portBASE_TYPE waiting = uxQueueMessagesWaitingFromISR(xQueue) + 1;
+static void updatePercentiles(Data* queueData) {
+  uint16_t histogram[HISTOGRAM_BINS];
+  uint32_t maxResidency;
 
-  if (waiting > prevPeak) {
-    return waiting;
+  taskENTER_CRITICAL();
+  memcpy(histogram, queueData->histogram, sizeof(histogram));
+  memset(queueData->histogram, 0, sizeof(queueData->histogram));
+  maxResidency = queueData->periodMaxResidency;
+  queueData->periodMaxResidency = 0;
+  taskEXIT_CRITICAL();
+
+  uint32_t total = 0;
+  for (int i = 0; i < HISTOGRAM_BINS; i++) {
+    total += histogram[i];
   }
-  return prevPeak;
+
+  if (total == 0) {
+    queueData->p50 = 0;
+    queueData->p90 = 0;
+    queueData->p99 = 0;
+  } else {
+    queueData->p50 = percentile(histogram, total, 50);
+    queueData->p90 = percentile(histogram, total, 90);
+    queueData->p99 = percentile(histogram, total, 99);
+  }
+  queueData->maxResidency = (maxResidency > UINT16_MAX) ? UINT16_MAX : maxResidency;
 }
 
+#ifdef DEBUG_QUEUE_MONITOR
 static void debugPrint() {
   int i = 0;
   for (i = 0; i < nrOfQueues; i++) {
@@ -165,9 +316,93 @@ static void resetCounters() {
     queueData->fullCount = 0;
   }
 }
+#endif // DEBUG_QUEUE_MONITOR
+
+static void dump() {
+  DEBUG_PRINT("Queue dump\n");
+  DEBUG_PRINT("Log\tHw\tDrop\tP50\tP90\tP99\tMax\tQueue\n");
+  for (int i = 1; i < nrOfQueues; i++) {
+    Data* queueData = &data[i];
+    DEBUG_PRINT("queue%i\t%u\t%u\t%u\t%u\t%u\t%u\t%s:%s\n", i,
+      queueData->highWater, queueData->drops, queueData->p50, queueData->p90,
+      queueData->p99, queueData->maxResidency, queueData->fileName, queueData->queueName);
+  }
+}
+
+static void resetTelemetry() {
+  for (int i = 0; i < nrOfQueues; i++) {
+    Data* queueData = &data[i];
+
+    taskENTER_CRITICAL();
+    queueData->highWater = 0;
+    queueData->drops = 0;
+    taskEXIT_CRITICAL();
+  }
+}
 
 static void timerHandler(xTimerHandle timer) {
-  debugPrint();
+#ifdef DEBUG_QUEUE_MONITOR
+  static int periods = 0;
+#endif
+
+  for (int i = 1; i < nrOfQueues; i++) {
+    updatePercentiles(&data[i]);
+  }
+
+  if (triggerDump) {
+    dump();
+    triggerDump = 0;
+  }
+
+  if (triggerReset) {
+    resetTelemetry();
+    triggerReset = 0;
+  }
+
+#ifdef DEBUG_QUEUE_MONITOR
+  periods++;
+  if (periods >= DISPLAY_PERIOD) {
+    periods = 0;
+    debugPrint();
+  }
+#endif
 }
 
-#endif // DEBUG_QUEUE_MONITOR
+PARAM_GROUP_START(queueMonitor)
+PARAM_ADD(PARAM_UINT8, dump, &triggerDump)
+PARAM_ADD(PARAM_UINT8, reset, &triggerReset)
+PARAM_GROUP_STOP(queueMonitor)
+
+#define QUEUE_LOG_GROUP(NAME, NUMBER) \
+  LOG_GROUP_START(NAME) \
+  LOG_ADD(LOG_UINT8, hw, &data[NUMBER].highWater) \
+  LOG_ADD(LOG_UINT16, drop, &data[NUMBER].drops) \
+  LOG_ADD(LOG_UINT16, p50, &data[NUMBER].p50) \
+  LOG_ADD(LOG_UINT16, p90, &data[NUMBER].p90) \
+  LOG_ADD(LOG_UINT16, p99, &data[NUMBER].p99) \
+  LOG_ADD(LOG_UINT16, max, &data[NUMBER].maxResidency) \
+  LOG_GROUP_STOP(NAME)
+
+QUEUE_LOG_GROUP(queue1, 1)
+QUEUE_LOG_GROUP(queue2, 2)
+QUEUE_LOG_GROUP(queue3, 3)
+QUEUE_LOG_GROUP(queue4, 4)
+QUEUE_LOG_GROUP(queue5, 5)
+QUEUE_LOG_GROUP(queue6, 6)
+QUEUE_LOG_GROUP(queue7, 7)
+QUEUE_LOG_GROUP(queue8, 8)
+QUEUE_LOG_GROUP(queue9, 9)
+QUEUE_LOG_GROUP(queue10, 10)
+QUEUE_LOG_GROUP(queue11, 11)
+QUEUE_LOG_GROUP(queue12, 12)
+QUEUE_LOG_GROUP(queue13, 13)
+QUEUE_LOG_GROUP(queue14, 14)
+QUEUE_LOG_GROUP(queue15, 15)
+QUEUE_LOG_GROUP(queue16, 16)
+QUEUE_LOG_GROUP(queue17, 17)
+QUEUE_LOG_GROUP(queue18, 18)
+QUEUE_LOG_GROUP(queue19, 19)
+QUEUE_LOG_GROUP(queue20, 20)
+QUEUE_LOG_GROUP(queue21, 21)
+QUEUE_LOG_GROUP(queue22, 22)
+QUEUE_LOG_GROUP(queue23, 23)
@@ -27,16 +27,24 @@
 #include <stdint.h>
 
 #include "log.h"
+#include "usec_time.h"
 
 #include "range.h"
 
 static uint16_t ranges[RANGE_T_END] = {0,};
+static uint64_t timestamps[RANGE_T_END] = {0,};
 
 void rangeSet(rangeDirection_t direction, float range_m)
+{
+  rangeSetWithTimestamp(direction, range_m, usecTimestamp());
+}
+
+void rangeSetWithTimestamp(rangeDirection_t direction, float range_m, uint64_t timestamp)
 {
   if (direction > (RANGE_T_END-1)) return;
 
   ranges[direction] = range_m * 1000;
+  timestamps[direction] = timestamp;
 }
 
 float rangeGet(rangeDirection_t direction)
@@ -46,6 +54,13 @@ float rangeGet(rangeDirection_t direction)
   return ranges[direction];
 }
 
+uint64_t rangeGetTimestamp(rangeDirection_t direction)
+{
+  if (direction > (RANGE_T_END-1)) return 0;
+
+  return timestamps[direction];
+}
+
 LOG_GROUP_START(range)
 LOG_ADD(LOG_UINT16, front, &ranges[rangeFront])
 LOG_ADD(LOG_UINT16, back, &ranges[rangeBack])
@@ -30,6 +30,8 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+#include "stm32fxxx.h"
+
 #include "system.h"
 #include "log.h"
 #include "param.h"
@@ -38,6 +40,8 @@
 #include "pm.h"
 
 #include "stabilizer.h"
+#include "stabilizer_profile.h"
+#include "irq_profile.h"
 
 #include "sensors.h"
 #include "commander.h"
@@ -49,6 +53,7 @@
 #include "estimator.h"
 #include "usddeck.h"
 #include "quatcompress.h"
+#include "static_mem.h"
 
 static bool isInit;
 static bool emergencyStop = false;
@@ -68,6 +73,30 @@ static control_t control;
 static StateEstimatorType estimatorType;
 static ControllerType controllerType;
 
+#ifdef STABILIZER_FAST_RATE_LOOP
+// Output of the outer loops, handed over to the rate loop
+typedef struct {
+  control_t control;
+  attitude_t rateReference;
+  bool useRateLoop;
+  bool enableOutput;
+} rateLoopInput_t;
+
+/* Lock free mailbox from the outer loop task to the rate loop. Both run on
+ * the same core and the rate loop has the higher priority, so it can only
+ * interrupt the writer, never the other way around. The writer fills the
+ * buffer that is not published and then flips the index, which means the
+ * rate loop always reads a complete set of references.
+ */
+static rateLoopInput_t rateLoopMailbox[2];
+static volatile uint8_t rateLoopMailboxIndex;
+
+static control_t rateLoopControl;
+static TaskHandle_t outerTaskHandle;
+static uint32_t outerLoopOverruns;
+static uint32_t rateLoopNoGyro;
+#endif
+
 typedef enum { configureAcc, measureNoiseFloor, measureProp, testBattery, restartBatTest, evaluateResult, testDone } TestState;
 #ifdef RUN_PROP_TEST_AT_STARTUP
   static TestState testState = configureAcc;
@@ -112,12 +141,15 @@ static struct {
 } setpointCompressed;
 
 static void stabilizerTask(void* param);
+#ifdef STABILIZER_FAST_RATE_LOOP
+static void stabilizerOuterTask(void* param);
+#endif
 static void testProps(sensorData_t *sensors);
 
-static void calcSensorToOutputLatency(const sensorData_t *sensorData)
+static void calcSensorToOutputLatency(const uint64_t interruptTimestamp)
 {
   uint64_t outTimestamp = usecTimestamp();
-  inToOutLatency = outTimestamp - sensorData->interruptTimestamp;
+  inToOutLatency = outTimestamp - interruptTimestamp;
 }
 
 static void compressState()
@@ -162,12 +194,20 @@ static void compressSetpoint()
   setpointCompressed.az = setpoint.acceleration.z * 1000.0f;
 }
 
+STATIC_MEM_TASK_ALLOC(stabilizerTask, STABILIZER_TASK_STACKSIZE);
+#ifdef STABILIZER_FAST_RATE_LOOP
+STATIC_MEM_TASK_ALLOC(stabilizerOuterTask, STABILIZER_OUTER_TASK_STACKSIZE);
+#endif
+
 void stabilizerInit(StateEstimatorType estimator)
 {
   if(isInit)
     return;
 
   sensorsInit();
+#ifdef STABILIZER_PROFILE
+  stabilizerProfileInit();
+#endif
   stateEstimatorInit(estimator);
   controllerInit(ControllerTypeAny);
   powerDistributionInit();
@@ -178,8 +218,10 @@ void stabilizerInit(StateEstimatorType estimator)
   estimatorType = getStateEstimator();
   controllerType = getControllerType();
 
-  xTaskCreate(stabilizerTask, STABILIZER_TASK_NAME,
-              STABILIZER_TASK_STACKSIZE, NULL, STABILIZER_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(stabilizerTask, stabilizerTask, STABILIZER_TASK_NAME, NULL, STABILIZER_TASK_PRI, NULL);
+#ifdef STABILIZER_FAST_RATE_LOOP
+  STATIC_MEM_TASK_CREATE(stabilizerOuterTask, stabilizerOuterTask, STABILIZER_OUTER_TASK_NAME, NULL, STABILIZER_OUTER_TASK_PRI, &outerTaskHandle);
+#endif
 
   isInit = true;
 }
@@ -207,11 +249,152 @@ static void checkEmergencyStopTimeout()
   }
 }
 
-/* The stabilizer loop runs at 1kHz (stock) or 500Hz (kalman). It is the
+#ifdef STABILIZER_FAST_RATE_LOOP
+static void publishRateLoopInput(bool enableOutput)
+{
+  rateLoopInput_t *input = &rateLoopMailbox[rateLoopMailboxIndex ^ 1];
+
+  input->control = control;
+  input->useRateLoop = controllerGetRateReference(&input->rateReference);
+  input->enableOutput = enableOutput;
+
+  // Make sure the buffer is written before it is published
+  __DMB();
+  rateLoopMailboxIndex ^= 1;
+}
+
+/* Runs on every IMU sample: gyro, body rate PID and motor mixer, with the
+ * references from the last run of the outer loops.
+ */
+static void rateLoopUpdate(void)
+{
+  const rateLoopInput_t *input = &rateLoopMailbox[rateLoopMailboxIndex];
+
+  // The propeller test drives the motors itself
+  if (!input->enableOutput) {
+    return;
+  }
+
+  STABILIZER_PROFILE_START(stabilizerStageRateLoop);
+
+  Axis3f gyro;
+  uint64_t interruptTimestamp;
+  bool hasGyro = sensorsPeekGyro(&gyro, &interruptTimestamp);
+
+  if (input->useRateLoop && !hasGyro) {
+    // The outer loops leave the torque to the rate loop, hold the one of the
+    // last sample until there is a new gyro sample
+    const control_t lastControl = rateLoopControl;
+    rateLoopControl = input->control;
+    rateLoopControl.roll = lastControl.roll;
+    rateLoopControl.pitch = lastControl.pitch;
+    rateLoopControl.yaw = lastControl.yaw;
+    rateLoopNoGyro++;
+  } else {
+    rateLoopControl = input->control;
+    if (input->useRateLoop) {
+      STABILIZER_PROFILE_START(stabilizerStageRate);
+      controllerRate(&rateLoopControl, &input->rateReference, &gyro);
+      STABILIZER_PROFILE_STOP(stabilizerStageRate);
+    }
+  }
+
+  STABILIZER_PROFILE_START(stabilizerStagePowerDistribution);
+  if (emergencyStop) {
+    powerStop();
+  } else {
+    powerDistribution(&rateLoopControl);
+  }
+  STABILIZER_PROFILE_STOP(stabilizerStagePowerDistribution);
+
+  if (hasGyro) {
+    calcSensorToOutputLatency(interruptTimestamp);
+  }
+
+  STABILIZER_PROFILE_STOP(stabilizerStageRateLoop);
+}
+#endif
+
+/* Estimator, commander and controller. Runs at 1kHz in the stabilizer task,
+ * or in its own lower priority task when the rate loop is decoupled. It is the
  * responsibility of the different functions to run slower by skipping call
  * (ie. returning without modifying the output structure).
  */
+static void stabilizerOuterUpdate(const uint32_t tick)
+{
+  STABILIZER_PROFILE_START(stabilizerStageLoop);
+
+  if (startPropTest != false) {
+    // TODO: What happens with estimator when we run tests after startup?
+    testState = configureAcc;
+    startPropTest = false;
+  }
+
+  if (testState != testDone) {
+#ifdef STABILIZER_FAST_RATE_LOOP
+    publishRateLoopInput(false);
+#endif
+    sensorsAcquire(&sensorData, tick);
+    testProps(&sensorData);
+  } else {
+    // allow to update estimator dynamically
+    if (getStateEstimator() != estimatorType) {
+      stateEstimatorInit(estimatorType);
+      estimatorType = getStateEstimator();
+    }
+    // allow to update controller dynamically
+    if (getControllerType() != controllerType) {
+      controllerInit(controllerType);
+      controllerType = getControllerType();
+    }
+
+    STABILIZER_PROFILE_START(stabilizerStageEstimator);
+    stateEstimator(&state, &sensorData, &control, tick);
+    STABILIZER_PROFILE_STOP(stabilizerStageEstimator);
+    compressState();
 
+    STABILIZER_PROFILE_START(stabilizerStageCommander);
+    commanderGetSetpoint(&setpoint, &state);
+    STABILIZER_PROFILE_STOP(stabilizerStageCommander);
+    compressSetpoint();
+
+    STABILIZER_PROFILE_START(stabilizerStageSitAw);
+    sitAwUpdateSetpoint(&setpoint, &sensorData, &state);
+    STABILIZER_PROFILE_STOP(stabilizerStageSitAw);
+
+    STABILIZER_PROFILE_START(stabilizerStageController);
+    controller(&control, &setpoint, &sensorData, &state, tick);
+    STABILIZER_PROFILE_STOP(stabilizerStageController);
+
+    checkEmergencyStopTimeout();
+
+#ifdef STABILIZER_FAST_RATE_LOOP
+    publishRateLoopInput(true);
+#else
+    STABILIZER_PROFILE_START(stabilizerStagePowerDistribution);
+    if (emergencyStop) {
+      powerStop();
+    } else {
+      powerDistribution(&control);
+    }
+    STABILIZER_PROFILE_STOP(stabilizerStagePowerDistribution);
+#endif
+
+    // Log data to uSD card if configured
+    if (   usddeckLoggingEnabled()
+        && usddeckLoggingMode() == usddeckLoggingMode_SynchronousStabilizer
+        && RATE_DO_EXECUTE(usddeckFrequency(), tick)) {
+      usddeckTriggerLogging();
+    }
+  }
+
+  STABILIZER_PROFILE_STOP(stabilizerStageLoop);
+}
+
+/* The stabilizer loop runs at 1kHz (stock) or 500Hz (kalman). With
+ * STABILIZER_FAST_RATE_LOOP it only runs the rate loop, on every IMU sample,
+ * and wakes up the outer loop task for the rest.
+ */
 static void stabilizerTask(void* param)
 {
   uint32_t tick;
@@ -236,57 +419,44 @@ static void stabilizerTask(void* param)
   while(1) {
     // The sensor should unlock at 1kHz
     sensorsWaitDataReady();
+    IRQ_PROFILE_STABILIZER_BUSY(true);
 
-    if (startPropTest != false) {
-      // TODO: What happens with estimator when we run tests after startup?
-      testState = configureAcc;
-      startPropTest = false;
-    }
-
-    if (testState != testDone) {
-      sensorsAcquire(&sensorData, tick);
-      testProps(&sensorData);
-    } else {
-      // allow to update estimator dynamically
-      if (getStateEstimator() != estimatorType) {
-        stateEstimatorInit(estimatorType);
-        estimatorType = getStateEstimator();
-      }
-      // allow to update controller dynamically
-      if (getControllerType() != controllerType) {
-        controllerInit(controllerType);
-        controllerType = getControllerType();
-      }
-
-      stateEstimator(&state, &sensorData, &control, tick);
-      compressState();
-      
-      commanderGetSetpoint(&setpoint, &state);
-      compressSetpoint();
+#ifdef STABILIZER_FAST_RATE_LOOP
+    rateLoopUpdate();
 
-      sitAwUpdateSetpoint(&setpoint, &sensorData, &state);
+    // Hand the tick to the outer loop, so its rate decimation follows the
+    // stabilizer tick even if it misses samples
+    xTaskNotify(outerTaskHandle, tick, eSetValueWithOverwrite);
+#else
+    stabilizerOuterUpdate(tick);
+    calcSensorToOutputLatency(sensorData.interruptTimestamp);
+#endif
+    IRQ_PROFILE_STABILIZER_BUSY(false);
+    tick++;
+  }
+}
 
-      controller(&control, &setpoint, &sensorData, &state, tick);
+#ifdef STABILIZER_FAST_RATE_LOOP
+static void stabilizerOuterTask(void* param)
+{
+  uint32_t tick;
+  uint32_t lastTick = 0;
 
-      checkEmergencyStopTimeout();
+  systemWaitStart();
 
-      if (emergencyStop) {
-        powerStop();
-      } else {
-        powerDistribution(&control);
-      }
+  while(1) {
+    xTaskNotifyWait(0, 0, &tick, portMAX_DELAY);
 
-      // Log data to uSD card if configured
-      if (   usddeckLoggingEnabled()
-          && usddeckLoggingMode() == usddeckLoggingMode_SynchronousStabilizer
-          && RATE_DO_EXECUTE(usddeckFrequency(), tick)) {
-        usddeckTriggerLogging();
-      }
+    // The outer loop was still busy with earlier ticks if some were skipped
+    if (lastTick != 0) {
+      outerLoopOverruns += tick - lastTick - 1;
     }
-    calcSensorToOutputLatency(&sensorData);
-    tick++;
+    lastTick = tick;
+
+    stabilizerOuterUpdate(tick);
   }
 }
+#endif
 
 void stabilizerSetEmergencyStop()
 {
@@ -649,3 +819,13 @@ LOG_GROUP_START(latency)
 LOG_ADD(LOG_UINT32, intToOut, &inToOutLatency)
 LOG_GROUP_STOP(latency)
 
+#ifdef STABILIZER_FAST_RATE_LOOP
+LOG_GROUP_START(rateLoop)
+LOG_ADD(LOG_INT16, roll, &rateLoopControl.roll)
+LOG_ADD(LOG_INT16, pitch, &rateLoopControl.pitch)
+LOG_ADD(LOG_INT16, yaw, &rateLoopControl.yaw)
+LOG_ADD(LOG_UINT32, overruns, &outerLoopOverruns)
+LOG_ADD(LOG_UINT32, noGyro, &rateLoopNoGyro)
+LOG_GROUP_STOP(rateLoop)
+#endif
+
@@ -0,0 +1,183 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * stabilizer_profile.c - Cycle counts of the stabilizer loop stages
+ *
+ * Each stage is timed with the DWT cycle counter and keeps min, max and mean
+ * cycles and a histogram of its duration. The histogram bins are powers of
+ * two in microseconds: below 8 us, 8-16 us, 16-32 us and so on up to 512 us
+ * and above. Times are wall clock, so interrupts and higher priority tasks
+ * that preempt a stage are included.
+ *
+ * The whole loop is also checked against the RATE_MAIN_LOOP budget. With
+ * STABILIZER_FAST_RATE_LOOP the loop stage is the outer loop task, and the
+ * rate loop of the stabilizer task is timed and checked against its own
+ * BODY_RATE_LOOP_RATE budget.
+ *
+ * Set the stabProfile.reset parameter to clear all statistics. The stages run
+ * in different tasks, so each stage clears its own statistics the next time
+ * it is stopped, in the task that owns it.
+ */
+#include "stabilizer_profile.h"
+
+#ifdef STABILIZER_PROFILE
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "stabilizer_types.h"
+#include "cycle_counter.h"
+#include "log.h"
+#include "param.h"
+
+#define HISTOGRAM_BINS 8
+// Upper edge of the first bin, 8 us
+#define HISTOGRAM_FIRST_BIN_LOG2_US 3
+
+// The stage that turns a reset request into a new reset generation. It must
+// be stopped from one task only.
+#ifdef STABILIZER_FAST_RATE_LOOP
+  #define RESET_STAGE stabilizerStageRateLoop
+#else
+  #define RESET_STAGE stabilizerStageLoop
+#endif
+
+typedef struct {
+  uint32_t start;
+  uint32_t min;
+  uint32_t max;
+  uint32_t mean;
+  uint64_t total;
+  uint32_t count;
+  uint32_t histogram[HISTOGRAM_BINS];
+  uint32_t overruns;
+  uint8_t resetGeneration;
+} stageStats_t;
+
+static stageStats_t stages[STABILIZER_STAGE_COUNT];
+// Cycle budget per stage, 0 for stages that are not checked
+static uint32_t budgets[STABILIZER_STAGE_COUNT];
+static uint32_t cyclesPerUs;
+static uint8_t reset;
+static volatile uint8_t resetGeneration;
+
+static void resetStats(stageStats_t* stats)
+{
+  const uint8_t generation = resetGeneration;
+  memset(stats, 0, sizeof(stageStats_t));
+  stats->resetGeneration = generation;
+}
+
+static uint32_t histogramBin(const uint32_t cycles)
+{
+  uint32_t us = cycles / cyclesPerUs;
+  if (us < (1 << HISTOGRAM_FIRST_BIN_LOG2_US)) {
+    return 0;
+  }
+
+  uint32_t bin = (31 - __builtin_clz(us)) - HISTOGRAM_FIRST_BIN_LOG2_US + 1;
+  if (bin >= HISTOGRAM_BINS) {
+    bin = HISTOGRAM_BINS - 1;
+  }
+
+  return bin;
+}
+
+void stabilizerProfileInit(void)
+{
+  cycleCounterInit();
+
+  cyclesPerUs = SystemCoreClock / 1000000;
+  budgets[stabilizerStageLoop] = SystemCoreClock / RATE_MAIN_LOOP;
+  budgets[stabilizerStageRateLoop] = SystemCoreClock / BODY_RATE_LOOP_RATE;
+  memset(stages, 0, sizeof(stages));
+}
+
+void stabilizerProfileStart(const stabilizerStage_t stage)
+{
+  stages[stage].start = cycleCounterGet();
+}
+
+void stabilizerProfileStop(const stabilizerStage_t stage)
+{
+  stageStats_t* stats = &stages[stage];
+  uint32_t cycles = cycleCounterGet() - stats->start;
+
+  if (stage == RESET_STAGE && reset) {
+    resetGeneration++;
+    reset = 0;
+  }
+  if (stats->resetGeneration != resetGeneration) {
+    resetStats(stats);
+  }
+
+  if (stats->count == 0 || cycles < stats->min) {
+    stats->min = cycles;
+  }
+  if (cycles > stats->max) {
+    stats->max = cycles;
+  }
+
+  stats->total += cycles;
+  stats->count++;
+  stats->mean = stats->total / stats->count;
+  stats->histogram[histogramBin(cycles)]++;
+
+  if (budgets[stage] != 0 && cycles > budgets[stage]) {
+    stats->overruns++;
+  }
+}
+
+PARAM_GROUP_START(stabProfile)
+PARAM_ADD(PARAM_UINT8, reset, &reset)
+PARAM_GROUP_STOP(stabProfile)
+
+#define STAGE_LOG_GROUP(NAME, STAGE) \
+  LOG_GROUP_START(NAME) \
+  LOG_ADD(LOG_UINT32, min, &stages[STAGE].min) \
+  LOG_ADD(LOG_UINT32, max, &stages[STAGE].max) \
+  LOG_ADD(LOG_UINT32, mean, &stages[STAGE].mean) \
+  LOG_ADD(LOG_UINT32, h0, &stages[STAGE].histogram[0]) \
+  LOG_ADD(LOG_UINT32, h1, &stages[STAGE].histogram[1]) \
+  LOG_ADD(LOG_UINT32, h2, &stages[STAGE].histogram[2]) \
+  LOG_ADD(LOG_UINT32, h3, &stages[STAGE].histogram[3]) \
+  LOG_ADD(LOG_UINT32, h4, &stages[STAGE].histogram[4]) \
+  LOG_ADD(LOG_UINT32, h5, &stages[STAGE].histogram[5]) \
+  LOG_ADD(LOG_UINT32, h6, &stages[STAGE].histogram[6]) \
+  LOG_ADD(LOG_UINT32, h7, &stages[STAGE].histogram[7]) \
+  LOG_ADD(LOG_UINT32, overrun, &stages[STAGE].overruns) \
+  LOG_GROUP_STOP(NAME)
+
+STAGE_LOG_GROUP(profEst, stabilizerStageEstimator)
+STAGE_LOG_GROUP(profCmd, stabilizerStageCommander)
+STAGE_LOG_GROUP(profSitAw, stabilizerStageSitAw)
+STAGE_LOG_GROUP(profCtrl, stabilizerStageController)
+STAGE_LOG_GROUP(profPwr, stabilizerStagePowerDistribution)
+STAGE_LOG_GROUP(profLoop, stabilizerStageLoop)
+#ifdef STABILIZER_FAST_RATE_LOOP
+// Without the fast rate loop the rate PID is part of profCtrl
+STAGE_LOG_GROUP(profRate, stabilizerStageRate)
+STAGE_LOG_GROUP(profRLoop, stabilizerStageRateLoop)
+#endif
+
+#endif // STABILIZER_PROFILE
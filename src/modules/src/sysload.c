@@ -22,29 +22,45 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  * sysload.c - System load monitor
+ *
+ * Samples the CPU load and stack headroom of all tasks. The result is printed
+ * on the console when system.taskDump is set, and published every second in
+ * the sysload log group when system.loadLog is set.
  */
 
 #define DEBUG_MODULE "SYSLOAD"
 
 #include <stdbool.h>
 #include "FreeRTOS.h"
+#include "task.h"
 #include "timers.h"
 #include "debug.h"
 #include "cfassert.h"
 #include "param.h"
+#include "log.h"
 
 #include "sysload.h"
 
 #define TIMER_PERIOD M2T(1000)
 
+// Log slot format: task number in bit 31-24, load in permille in bit 23-12
+// and stack headroom in words in bit 11-0. Unused slots are 0.
+#define SLOT_TASK_SHIFT 24
+#define SLOT_LOAD_SHIFT 12
+#define SLOT_FIELD_MAX  0xFFF
+
 static void timerHandler(xTimerHandle timer);
 
 static bool initialized = false;
 static uint8_t triggerDump = 0;
+static uint8_t enableLog = 0;
 
 typedef struct {
   uint32_t ulRunTimeCounter;
   uint32_t xTaskNumber;
+  uint16_t load;
+  uint16_t stackHeadroom;
+  bool present;
 } taskData_t;
 
 #define TASK_MAX_COUNT 32
@@ -52,6 +68,14 @@ static taskData_t previousSnapshot[TASK_MAX_COUNT];
 static int taskTopIndex = 0;
 static uint32_t previousTotalRunTime = 0;
 
+// Too large for the timer task stack
+static TaskStatus_t taskStats[TASK_MAX_COUNT];
+
+static uint32_t logSlots[TASK_MAX_COUNT];
+static uint16_t cpuLoad;
+static uint8_t taskCount;
+static uint8_t tasksNotMonitored;
+
 void sysLoadInit() {
   ASSERT(!initialized);
 
@@ -71,7 +95,10 @@ static taskData_t* getPreviousTaskData(uint32_t xTaskNumber) {
   }
 
   // Allocate a new entry
-  ASSERT(taskTopIndex < TASK_MAX_COUNT);
+  if (taskTopIndex >= TASK_MAX_COUNT) {
+    return 0;
+  }
+
   taskData_t* result = &previousSnapshot[taskTopIndex];
   result->xTaskNumber = xTaskNumber;
 
@@ -80,36 +107,98 @@ static taskData_t* getPreviousTaskData(uint32_t xTaskNumber) {
   return result;
 }
 
-static void timerHandler(xTimerHandle timer) {
-  if (triggerDump != 0) {
-    uint32_t totalRunTime;
-
-    TaskStatus_t taskStats[TASK_MAX_COUNT];
-    uint32_t taskCount = uxTaskGetSystemState(taskStats, TASK_MAX_COUNT, &totalRunTime);
-    ASSERT(taskCount < TASK_MAX_COUNT);
-
-    uint32_t totalDelta = totalRunTime - previousTotalRunTime;
-    float f = 100.0 / totalDelta;
-
-    // Dumps the the CPU load and stack usage for all tasks
-    // CPU usage is since last dump in % compared to total time spent in tasks. Note that time spent in interrupts will be included in measured time.
-    // Stack usage is displayed as nr of unused bytes at peak stack usage.
-
-    DEBUG_PRINT("Task dump\n");
-    DEBUG_PRINT("Load\tStack left\tName\n");
-    for (uint32_t i = 0; i < taskCount; i++) {
-      TaskStatus_t* stats = &taskStats[i];
-      taskData_t* previousTaskData = getPreviousTaskData(stats->xTaskNumber);
-
-      uint32_t taskRunTime = stats->ulRunTimeCounter;
-      float load = f * (taskRunTime - previousTaskData->ulRunTimeCounter);
-      DEBUG_PRINT("%.2f \t%u \t%s\n", (double)load, stats->usStackHighWaterMark, stats->pcTaskName);
-      
-      previousTaskData->ulRunTimeCounter = taskRunTime;
+static uint32_t saturate(uint32_t value) {
+  return value > SLOT_FIELD_MAX ? SLOT_FIELD_MAX : value;
+}
+
+/* Load since the previous sample in permille of the total time spent in
+ * tasks. Note that time spent in interrupts will be included in measured time.
+ * Stack headroom is the number of unused words at peak stack usage.
+ */
+static void sample() {
+  uint32_t totalRunTime;
+  uint32_t count = uxTaskGetSystemState(taskStats, TASK_MAX_COUNT, &totalRunTime);
+
+  if (count == 0) {
+    // More tasks than TASK_MAX_COUNT, nothing is returned
+    tasksNotMonitored = uxTaskGetNumberOfTasks() - TASK_MAX_COUNT;
+    taskCount = 0;
+    return;
+  }
+
+  uint32_t totalDelta = totalRunTime - previousTotalRunTime;
+  if (totalDelta == 0) {
+    return;
+  }
+
+  for (int i = 0; i < taskTopIndex; i++) {
+    previousSnapshot[i].present = false;
+  }
+
+  TaskHandle_t idleTask = xTaskGetIdleTaskHandle();
+  uint8_t notMonitored = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    TaskStatus_t* stats = &taskStats[i];
+    taskData_t* previousTaskData = getPreviousTaskData(stats->xTaskNumber);
+    if (!previousTaskData) {
+      notMonitored++;
+      continue;
     }
 
-    previousTotalRunTime = totalRunTime;
+    uint32_t taskRunTime = stats->ulRunTimeCounter;
+    uint64_t taskDelta = taskRunTime - previousTaskData->ulRunTimeCounter;
+    previousTaskData->load = (taskDelta * 1000) / totalDelta;
+    previousTaskData->stackHeadroom = stats->usStackHighWaterMark;
+    previousTaskData->present = true;
+    previousTaskData->ulRunTimeCounter = taskRunTime;
 
+    if (stats->xHandle == idleTask) {
+      cpuLoad = 1000 - previousTaskData->load;
+    }
+  }
+
+  for (int i = 0; i < taskTopIndex; i++) {
+    taskData_t* taskData = &previousSnapshot[i];
+    if (taskData->present) {
+      logSlots[i] = (taskData->xTaskNumber << SLOT_TASK_SHIFT) |
+                    (saturate(taskData->load) << SLOT_LOAD_SHIFT) |
+                    saturate(taskData->stackHeadroom);
+    } else {
+      logSlots[i] = 0;
+    }
+  }
+
+  taskCount = count;
+  tasksNotMonitored = notMonitored;
+  previousTotalRunTime = totalRunTime;
+}
+
+static void dump() {
+  // Dumps the the CPU load and stack usage for all tasks
+  DEBUG_PRINT("Task dump\n");
+  DEBUG_PRINT("Load\tStack left\tNbr\tName\n");
+  for (uint32_t i = 0; i < taskCount; i++) {
+    TaskStatus_t* stats = &taskStats[i];
+    taskData_t* taskData = getPreviousTaskData(stats->xTaskNumber);
+    if (taskData) {
+      DEBUG_PRINT("%u.%u \t%u \t%u \t%s\n", taskData->load / 10, taskData->load % 10,
+                  stats->usStackHighWaterMark, (unsigned int)stats->xTaskNumber, stats->pcTaskName);
+    }
+  }
+
+  if (tasksNotMonitored) {
+    DEBUG_PRINT("%u tasks not monitored, increase TASK_MAX_COUNT\n", tasksNotMonitored);
+  }
+}
+
+static void timerHandler(xTimerHandle timer) {
+  if (enableLog != 0 || triggerDump != 0) {
+    sample();
+  }
+
+  if (triggerDump != 0) {
+    dump();
     triggerDump = 0;
   }
 }
@@ -117,4 +206,43 @@ static void timerHandler(xTimerHandle timer) {
 
 PARAM_GROUP_START(system)
 PARAM_ADD(PARAM_UINT8, taskDump, &triggerDump)
+PARAM_ADD(PARAM_UINT8, loadLog, &enableLog)
 PARAM_GROUP_STOP(system)
+
+LOG_GROUP_START(sysload)
+LOG_ADD(LOG_UINT16, cpu, &cpuLoad)
+LOG_ADD(LOG_UINT8, tasks, &taskCount)
+LOG_ADD(LOG_UINT8, lost, &tasksNotMonitored)
+LOG_ADD(LOG_UINT32, t00, &logSlots[0])
+LOG_ADD(LOG_UINT32, t01, &logSlots[1])
+LOG_ADD(LOG_UINT32, t02, &logSlots[2])
+LOG_ADD(LOG_UINT32, t03, &logSlots[3])
+LOG_ADD(LOG_UINT32, t04, &logSlots[4])
+LOG_ADD(LOG_UINT32, t05, &logSlots[5])
+LOG_ADD(LOG_UINT32, t06, &logSlots[6])
+LOG_ADD(LOG_UINT32, t07, &logSlots[7])
+LOG_ADD(LOG_UINT32, t08, &logSlots[8])
+LOG_ADD(LOG_UINT32, t09, &logSlots[9])
+LOG_ADD(LOG_UINT32, t10, &logSlots[10])
+LOG_ADD(LOG_UINT32, t11, &logSlots[11])
+LOG_ADD(LOG_UINT32, t12, &logSlots[12])
+LOG_ADD(LOG_UINT32, t13, &logSlots[13])
+LOG_ADD(LOG_UINT32, t14, &logSlots[14])
+LOG_ADD(LOG_UINT32, t15, &logSlots[15])
+LOG_ADD(LOG_UINT32, t16, &logSlots[16])
+LOG_ADD(LOG_UINT32, t17, &logSlots[17])
+LOG_ADD(LOG_UINT32, t18, &logSlots[18])
+LOG_ADD(LOG_UINT32, t19, &logSlots[19])
+LOG_ADD(LOG_UINT32, t20, &logSlots[20])
+LOG_ADD(LOG_UINT32, t21, &logSlots[21])
+LOG_ADD(LOG_UINT32, t22, &logSlots[22])
+LOG_ADD(LOG_UINT32, t23, &logSlots[23])
+LOG_ADD(LOG_UINT32, t24, &logSlots[24])
+LOG_ADD(LOG_UINT32, t25, &logSlots[25])
+LOG_ADD(LOG_UINT32, t26, &logSlots[26])
+LOG_ADD(LOG_UINT32, t27, &logSlots[27])
+LOG_ADD(LOG_UINT32, t28, &logSlots[28])
+LOG_ADD(LOG_UINT32, t29, &logSlots[29])
+LOG_ADD(LOG_UINT32, t30, &logSlots[30])
+LOG_ADD(LOG_UINT32, t31, &logSlots[31])
+LOG_GROUP_STOP(sysload)
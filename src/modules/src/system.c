@@ -61,8 +61,10 @@
 #include "buzzer.h"
 #include "sound.h"
 #include "sysload.h"
+#include "irq_profile.h"
 #include "deck.h"
 #include "extrx.h"
+#include "static_mem.h"
 
 /* Private variable */
 static bool selftestPassed;
@@ -75,12 +77,13 @@ xSemaphoreHandle canStartMutex;
 /* Private functions */
 static void systemTask(void *arg);
 
+STATIC_MEM_TASK_ALLOC(systemTask, SYSTEM_TASK_STACKSIZE);
+
 /* Public functions */
 void systemLaunch(void)
 {
-  xTaskCreate(systemTask, SYSTEM_TASK_NAME,
-              SYSTEM_TASK_STACKSIZE, NULL,
-              SYSTEM_TASK_PRI, NULL);
+  STATIC_MEM_TASK_CREATE(systemTask, systemTask, SYSTEM_TASK_NAME, NULL,
+                         SYSTEM_TASK_PRI, NULL);
 
 }
 
@@ -144,8 +147,10 @@ void systemTask(void *arg)
   ledInit();
   ledSet(CHG_LED, 1);
 
-#ifdef DEBUG_QUEUE_MONITOR
   queueMonitorInit();
+
+#ifdef IRQ_PROFILE
+  irqProfileInit();
 #endif
 
 #ifdef ENABLE_UART1
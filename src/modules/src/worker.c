@@ -22,69 +22,332 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  * worker.c - Worker system that can execute asynchronous actions in tasks
+ *
+ * Scheduled work is kept in a fixed pool with one FIFO list per priority.
+ * Scheduling the same function and argument again while it is pending is
+ * coalesced into the pending work. The time each function and argument pair
+ * waited and executed is accounted, set worker.dump to print it on the
+ * console.
  */
+#define DEBUG_MODULE "WORKER"
+
 #include "worker.h"
 
 #include <errno.h>
+#include <string.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "queuemonitor.h"
+#include "semphr.h"
+#include "timers.h"
 
 #include "console.h"
+#include "debug.h"
+#include "usec_time.h"
+#include "log.h"
+#include "param.h"
+#include "test_support.h"
 
-#define WORKER_QUEUE_LENGTH 5
+#define WORKER_POOL_SIZE 20
+#define WORKER_STATS_SIZE 24
+#define TIMER_PERIOD M2T(1000)
 
 struct worker_work {
   void (*function)(void*);
   void* arg;
+  workerPriority_t priority;
+  uint32_t coalesced;
+  uint64_t scheduled;
+  struct worker_work* next;
+};
+
+struct worker_list {
+  struct worker_work* head;
+  struct worker_work* tail;
+};
+
+struct worker_stats {
+  void (*function)(void*);
+  void* arg;
+  uint32_t count;
+  uint32_t coalesced;
+  uint32_t totalTime;
+  uint32_t maxTime;
+  uint32_t maxWait;
 };
 
-static xQueueHandle workerQueue;
+static struct worker_work pool[WORKER_POOL_SIZE];
+static struct worker_work* freeList;
+static struct worker_list pending[WORKER_PRIORITY_COUNT];
+static xSemaphoreHandle workAvailable;
+
+// Accounting, only updated by the worker loop. Times in us. The drop count is
+// updated by the scheduling task, in a critical section.
+static struct worker_stats stats[WORKER_STATS_SIZE];
+static struct worker_stats otherStats;
+TESTABLE_STATIC uint32_t dropCount;
+TESTABLE_STATIC uint32_t coalescedCount;
+static uint32_t maxWait[WORKER_PRIORITY_COUNT];
+static uint8_t triggerDump;
+// Set by the reset parameter, the worker loop clears the accounting
+TESTABLE_STATIC uint8_t triggerReset;
+
+static void timerHandler(xTimerHandle timer);
 
 void workerInit()
 {
-  if (workerQueue)
+  if (workAvailable)
     return;
 
-  workerQueue = xQueueCreate(WORKER_QUEUE_LENGTH, sizeof(struct worker_work));
-  DEBUG_QUEUE_MONITOR_REGISTER(workerQueue);
+  for (int i = 0; i < WORKER_POOL_SIZE - 1; i++)
+    pool[i].next = &pool[i + 1];
+  freeList = &pool[0];
+
+  workAvailable = xSemaphoreCreateBinary();
+
+  xTimerHandle timer = xTimerCreate("workerTimer", TIMER_PERIOD, pdTRUE, NULL, timerHandler);
+  xTimerStart(timer, 100);
 }
 
 bool workerTest()
 {
-  return (workerQueue != NULL);
+  return (workAvailable != NULL);
+}
+
+static void listAppend(struct worker_list* list, struct worker_work* work)
+{
+  work->next = NULL;
+  if (list->tail)
+    list->tail->next = work;
+  else
+    list->head = work;
+  list->tail = work;
+}
+
+static void listRemove(struct worker_list* list, struct worker_work* work, struct worker_work* previous)
+{
+  if (previous)
+    previous->next = work->next;
+  else
+    list->head = work->next;
+
+  if (list->tail == work)
+    list->tail = previous;
+}
+
+// Must be called in a critical section
+static struct worker_work* takeNextWork()
+{
+  for (int priority = 0; priority < WORKER_PRIORITY_COUNT; priority++)
+  {
+    struct worker_work* work = pending[priority].head;
+    if (work)
+    {
+      listRemove(&pending[priority], work, NULL);
+      return work;
+    }
+  }
+
+  return NULL;
+}
+
+static struct worker_stats* getStats(void (*function)(void*), void* arg)
+{
+  for (int i = 0; i < WORKER_STATS_SIZE; i++)
+  {
+    if (stats[i].function == function && stats[i].arg == arg)
+      return &stats[i];
+
+    if (stats[i].function == NULL)
+    {
+      stats[i].function = function;
+      stats[i].arg = arg;
+      return &stats[i];
+    }
+  }
+
+  // Table full, account in a common entry
+  return &otherStats;
+}
+
+static void account(const struct worker_work* work, uint64_t start, uint64_t end)
+{
+  uint32_t wait = start - work->scheduled;
+  uint32_t time = end - start;
+  struct worker_stats* workStats = getStats(work->function, work->arg);
+
+  workStats->count++;
+  workStats->coalesced += work->coalesced;
+  workStats->totalTime += time;
+  if (time > workStats->maxTime)
+    workStats->maxTime = time;
+  if (wait > workStats->maxWait)
+    workStats->maxWait = wait;
+
+  coalescedCount += work->coalesced;
+  if (wait > maxWait[work->priority])
+    maxWait[work->priority] = wait;
+}
+
+static void resetStats()
+{
+  memset(stats, 0, sizeof(stats));
+  memset(&otherStats, 0, sizeof(otherStats));
+  memset(maxWait, 0, sizeof(maxWait));
+  coalescedCount = 0;
+
+  taskENTER_CRITICAL();
+  dropCount = 0;
+  taskEXIT_CRITICAL();
 }
 
 void workerLoop()
 {
   struct worker_work work;
 
-  if (!workerQueue)
+  if (!workAvailable)
     return;
 
   while (1)
   {
-    xQueueReceive(workerQueue, &work, portMAX_DELAY);
-    
-    if (work.function)
+    xSemaphoreTake(workAvailable, portMAX_DELAY);
+
+    if (triggerReset)
+    {
+      resetStats();
+      triggerReset = 0;
+    }
+
+    while (1)
+    {
+      taskENTER_CRITICAL();
+      struct worker_work* next = takeNextWork();
+      if (next)
+      {
+        work = *next;
+        next->next = freeList;
+        freeList = next;
+      }
+      taskEXIT_CRITICAL();
+
+      if (!next)
+        break;
+
+      uint64_t start = usecTimestamp();
       work.function(work.arg);
+      account(&work, start, usecTimestamp());
+    }
   }
 }
 
 int workerSchedule(void (*function)(void*), void *arg)
 {
-  struct worker_work work;
-  
-  if (!function)
+  return workerSchedulePriority(function, arg, workerPriorityNormal);
+}
+
+int workerSchedulePriority(void (*function)(void*), void *arg, workerPriority_t priority)
+{
+  if (!function || priority >= WORKER_PRIORITY_COUNT)
     return ENOEXEC;
-  
-  work.function = function;
-  work.arg = arg;
-  if (xQueueSend(workerQueue, &work, 0) == pdFALSE)
-    return ENOMEM;
 
-  return 0; 
+  uint64_t now = usecTimestamp();
+  int result = 0;
+
+  taskENTER_CRITICAL();
+
+  // Coalesce with pending work, moving it up if scheduled with a higher priority
+  struct worker_work* found = NULL;
+  for (int p = 0; p < WORKER_PRIORITY_COUNT && !found; p++)
+  {
+    struct worker_work* previous = NULL;
+    for (struct worker_work* work = pending[p].head; work; previous = work, work = work->next)
+    {
+      if (work->function == function && work->arg == arg)
+      {
+        found = work;
+        if ((int)priority < p)
+        {
+          listRemove(&pending[p], work, previous);
+          work->priority = priority;
+          listAppend(&pending[priority], work);
+        }
+        break;
+      }
+    }
+  }
+
+  if (found)
+  {
+    found->coalesced++;
+  }
+  else if (freeList)
+  {
+    struct worker_work* work = freeList;
+    freeList = work->next;
+
+    work->function = function;
+    work->arg = arg;
+    work->priority = priority;
+    work->coalesced = 0;
+    work->scheduled = now;
+    listAppend(&pending[priority], work);
+  }
+  else
+  {
+    dropCount++;
+    result = ENOMEM;
+  }
+
+  taskEXIT_CRITICAL();
+
+  if (result == 0 && !found)
+    xSemaphoreGive(workAvailable);
+
+  return result;
+}
+
+static void dump()
+{
+  DEBUG_PRINT("Worker dump\n");
+  DEBUG_PRINT("Function\tArg\tCount\tCoalesced\tTotal\tMax\tMax wait\n");
+  for (int i = 0; i <= WORKER_STATS_SIZE; i++)
+  {
+    struct worker_stats* workStats = (i < WORKER_STATS_SIZE) ? &stats[i] : &otherStats;
+    if (workStats->count > 0)
+    {
+      DEBUG_PRINT("%p\t%p\t%u\t%u\t%u\t%u\t%u\n", workStats->function, workStats->arg,
+                  (unsigned int)workStats->count, (unsigned int)workStats->coalesced,
+                  (unsigned int)workStats->totalTime, (unsigned int)workStats->maxTime,
+                  (unsigned int)workStats->maxWait);
+    }
+  }
+  DEBUG_PRINT("Dropped: %u\n", (unsigned int)dropCount);
 }
 
+static void timerHandler(xTimerHandle timer)
+{
+  if (triggerDump)
+  {
+    dump();
+    triggerDump = 0;
+  }
+
+  // Wake the worker loop, it clears the accounting it owns
+  if (triggerReset)
+  {
+    xSemaphoreGive(workAvailable);
+  }
+}
+
+PARAM_GROUP_START(worker)
+PARAM_ADD(PARAM_UINT8, dump, &triggerDump)
+PARAM_ADD(PARAM_UINT8, reset, &triggerReset)
+PARAM_GROUP_STOP(worker)
+
+LOG_GROUP_START(worker)
+LOG_ADD(LOG_UINT32, drop, &dropCount)
+LOG_ADD(LOG_UINT32, coalesced, &coalescedCount)
+LOG_ADD(LOG_UINT32, waitHigh, &maxWait[workerPriorityHigh])
+LOG_ADD(LOG_UINT32, waitNormal, &maxWait[workerPriorityNormal])
+LOG_ADD(LOG_UINT32, waitLow, &maxWait[workerPriorityLow])
+LOG_GROUP_STOP(worker)
@@ -0,0 +1,92 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * biquad_cascade.h - Three axis Butterworth low pass and notch filters built on the
+ *                    CMSIS DSP biquad cascade, with optional decimation
+ */
+#ifndef BIQUAD_CASCADE_H_
+#define BIQUAD_CASCADE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "imu_types.h"
+#include "cf_math.h"
+
+// Each stage is one biquad, that is two poles
+#define BIQUAD_CASCADE_MAX_STAGES 4
+// Max number of samples passed to one apply call
+#define BIQUAD_CASCADE_MAX_BLOCK_SIZE 8
+
+typedef struct {
+  arm_biquad_cascade_df2T_instance_f32 instance[3];
+  float coeffs[5 * BIQUAD_CASCADE_MAX_STAGES];
+  float state[3][2 * BIQUAD_CASCADE_MAX_STAGES];
+  uint8_t numStages;
+} biquadCascade3Data;
+
+/**
+ * Anti-alias filter and decimator at the input rate followed by a low pass
+ * filter at the output rate.
+ */
+typedef struct {
+  biquadCascade3Data antiAlias;
+  biquadCascade3Data lowPass;
+  uint8_t decimation;
+  uint8_t phase;
+} filterPipeline3Data;
+
+/**
+ * Initialize a Butterworth low pass filter of order 2 * numStages. Zero stages,
+ * or a cutoff at or above the Nyquist frequency, gives a pass through filter.
+ */
+void biquadCascade3Init(biquadCascade3Data* data, float sampleFreq, float cutoffFreq, uint8_t numStages);
+
+/**
+ * Filter count samples of all three axes, in place.
+ */
+void biquadCascade3Apply(biquadCascade3Data* data, Axis3f* samples, uint32_t count);
+
+/**
+ * Initialize a cascade of numStages notch filters, all passing through until
+ * their center frequency is set.
+ */
+void biquadCascade3InitNotch(biquadCascade3Data* data, uint8_t numStages);
+
+/**
+ * Move one notch of the cascade without resetting the filter state. A center
+ * frequency of zero, or at or above the Nyquist frequency, disables the notch.
+ */
+void biquadCascade3SetNotch(biquadCascade3Data* data, uint8_t stage, float sampleFreq, float centerFreq, float q);
+
+void filterPipeline3Init(filterPipeline3Data* data, float outputFreq, uint8_t decimation,
+                         float antiAliasCutoffFreq, uint8_t antiAliasStages,
+                         float cutoffFreq, uint8_t stages);
+
+/**
+ * Push count samples at the input rate through the pipeline. Returns true if
+ * at least one output sample was produced, out is then set to the latest one.
+ */
+bool filterPipeline3Apply(filterPipeline3Data* data, const Axis3f* samples, uint32_t count, Axis3f* out);
+
+#endif //BIQUAD_CASCADE_H_
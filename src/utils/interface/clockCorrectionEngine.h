@@ -9,8 +9,28 @@ typedef struct {
   unsigned int clockCorrectionBucket;
 } clockCorrectionStorage_t;
 
+// Fixed point clock correction in Q3.60 format, 1.0 is represented by
+// CLOCK_CORRECTION_FIXED_ONE. Used instead of the double implementation when
+// built with CLOCK_CORRECTION_FIXED_POINT, to avoid software emulated double
+// arithmetic on the single precision FPU.
+#define CLOCK_CORRECTION_FIXED_FRACTION_BITS 60
+#define CLOCK_CORRECTION_FIXED_ONE ((int64_t)1 << CLOCK_CORRECTION_FIXED_FRACTION_BITS)
+typedef int64_t clockCorrectionFixed_t;
+
+typedef struct {
+  clockCorrectionFixed_t clockCorrection;
+  unsigned int clockCorrectionBucket;
+} clockCorrectionFixedStorage_t;
+
 double clockCorrectionEngineGet(const clockCorrectionStorage_t* storage);
 double clockCorrectionEngineCalculate(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
 bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double clockCorrectionCandidate);
 
+clockCorrectionFixed_t clockCorrectionEngineGetFixed(const clockCorrectionFixedStorage_t* storage);
+clockCorrectionFixed_t clockCorrectionEngineCalculateFixed(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
+clockCorrectionFixed_t clockCorrectionEngineRatioFixed(const uint64_t tickCount_in_cl_reference, const uint64_t tickCount_in_cl_x);
+bool clockCorrectionEngineUpdateFixed(clockCorrectionFixedStorage_t* storage, const clockCorrectionFixed_t clockCorrectionCandidate);
+int64_t clockCorrectionEngineApplyFixed(const int64_t ticks, const clockCorrectionFixed_t clockCorrection);
+float clockCorrectionEngineFixedToFloat(const clockCorrectionFixed_t clockCorrection);
+
 #endif /* clockCorrectionEngine_h */
@@ -0,0 +1,52 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cycle_counter.h - Cortex-M4 DWT cycle counter, for profiling
+ */
+#ifndef CYCLE_COUNTER_H_
+#define CYCLE_COUNTER_H_
+
+#include <stdint.h>
+
+#include "stm32fxxx.h"
+
+/**
+ * Start the DWT cycle counter. Safe to call more than once, and does not
+ * disturb a debugger that already enabled it.
+ */
+static inline void cycleCounterInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Current cycle count. Wraps every 2^32 cycles (25 s at 168 MHz), so only
+ * use the difference between two readings.
+ */
+static inline uint32_t cycleCounterGet(void)
+{
+  return DWT->CYCCNT;
+}
+
+#endif /* CYCLE_COUNTER_H_ */
@@ -0,0 +1,73 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * gyro_bias.h - Streaming gyro bias estimator
+ */
+#ifndef GYRO_BIAS_H_
+#define GYRO_BIAS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "imu_types.h"
+
+typedef struct
+{
+  // Settings
+  uint32_t windowSize;
+  float varianceThreshold;
+  float trackingVarianceThreshold;
+  float trackingMaxOffset;
+  float trackingGain;
+
+  // Running mean and variance (Welford) of the current window
+  uint32_t count;
+  float mean[3];
+  float m2[3];
+
+  // Result
+  Axis3f     bias;
+  Axis3f     variance;
+  bool       isBiasValueFound;
+  uint32_t   updateCount;
+} gyroBias_t;
+
+/**
+ * Initialize the estimator. The samples are processed in windows of
+ * windowSize samples. The bias is first set from a window where the variance
+ * of each axis, in LSB^2, is below varianceThreshold.
+ *
+ * Once found, windows with a variance below trackingVarianceThreshold and a
+ * mean within trackingMaxOffset LSB of the bias move the bias with
+ * trackingGain. The looser threshold lets the bias follow thermal drift
+ * while hovering, the offset limit rejects windows with real rotation.
+ */
+void gyroBiasInit(gyroBias_t* gb, uint32_t windowSize, float varianceThreshold,
+                  float trackingVarianceThreshold, float trackingMaxOffset, float trackingGain);
+
+/**
+ * Add a raw sample. Returns true when a bias value has been found.
+ */
+bool gyroBiasAdd(gyroBias_t* gb, int16_t x, int16_t y, int16_t z);
+
+#endif //GYRO_BIAS_H_
@@ -86,6 +86,7 @@ typedef struct pulseProcessor_s {
 typedef struct {
   float angles[2][2];
   float correctedAngles[2][2];
+  bool isAngleValid[2][2];
   int validCount;
 } pulseProcessorResult_t;
 
@@ -0,0 +1,65 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * static_mem.h - Statically allocated task stacks
+ *
+ * With STATIC_MEM the stacks of the tasks created with these macros are
+ * reserved at link time in the .bss of the module that creates them, instead
+ * of being allocated from the FreeRTOS heap when the task starts. Running out
+ * of RAM is then a link error, and "make ram_report" lists the RAM used by
+ * each module.
+ *
+ * This version of FreeRTOS can only take a static stack. The task control
+ * block and all queues and semaphores are still allocated from the heap.
+ * Tasks that delete themselves must not use a static stack, since the kernel
+ * would free it.
+ *
+ * Usage:
+ *   STATIC_MEM_TASK_ALLOC(myTask, MY_TASK_STACKSIZE);
+ *   ...
+ *   STATIC_MEM_TASK_CREATE(myTask, myTaskFunction, MY_TASK_NAME, NULL, MY_TASK_PRI, NULL);
+ */
+#ifndef STATIC_MEM_H_
+#define STATIC_MEM_H_
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifdef STATIC_MEM
+  #define STATIC_MEM_TASK_ALLOC(NAME, STACK_DEPTH) \
+    static StackType_t NAME ## StackBuffer[STACK_DEPTH]
+
+  #define STATIC_MEM_TASK_CREATE(NAME, FUNCTION, TASK_NAME, PARAMETERS, PRIORITY, HANDLE) \
+    xTaskGenericCreate(FUNCTION, TASK_NAME, sizeof(NAME ## StackBuffer) / sizeof(StackType_t), \
+                       PARAMETERS, PRIORITY, HANDLE, NAME ## StackBuffer, NULL)
+#else
+  #define STATIC_MEM_TASK_ALLOC(NAME, STACK_DEPTH) \
+    static const uint16_t NAME ## StackDepth = (STACK_DEPTH)
+
+  #define STATIC_MEM_TASK_CREATE(NAME, FUNCTION, TASK_NAME, PARAMETERS, PRIORITY, HANDLE) \
+    xTaskCreate(FUNCTION, TASK_NAME, NAME ## StackDepth, PARAMETERS, PRIORITY, HANDLE)
+#endif // STATIC_MEM
+
+#endif /* STATIC_MEM_H_ */
@@ -4,7 +4,13 @@
 #include "tdoaStorage.h"
 #include "tdoaStats.h"
 
-typedef void (*tdoaEngineSendTdoaToEstimator)(tdoaMeasurement_t* tdoaMeasurement);
+// Upper limit for the number of TDoA pairs computed from one received packet
+#ifndef TDOA_ENGINE_MAX_PAIRS_PER_PACKET
+#define TDOA_ENGINE_MAX_PAIRS_PER_PACKET 8
+#endif
+
+// Called with all TDoA measurements computed from one received packet
+typedef void (*tdoaEngineSendTdoaToEstimator)(tdoaMeasurement_t tdoaMeasurements[], const int count);
 
 typedef struct {
   // State
@@ -14,6 +20,8 @@ typedef struct {
   // Configuration
   tdoaEngineSendTdoaToEstimator sendTdoaToEstimator;
   double locodeckTsFreq;
+  float distancePerTick; // SPEED_OF_LIGHT / locodeckTsFreq, used with fixed point clock correction
+  uint8_t maxPairsPerPacket; // 1 for one TDoA per packet, up to TDOA_ENGINE_MAX_PAIRS_PER_PACKET
 } tdoaEngineState_t;
 
 void tdoaEngineInit(tdoaEngineState_t* state, const uint32_t now_ms, tdoaEngineSendTdoaToEstimator sendTdoaToEstimator, const double locodeckTsFreq);
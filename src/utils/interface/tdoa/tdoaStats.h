@@ -10,6 +10,7 @@ typedef struct {
   uint32_t contextMissCount;
   uint32_t timeIsGood;
   uint32_t suitableDataFound;
+  uint32_t pairsFound; // Number of TDoA pairs found, can be more than one per packet
 
   // Anchor ids to use for stats
   uint8_t anchorId; // The id of the anchor to log
@@ -32,6 +33,7 @@ typedef struct {
   uint16_t contextMissRate;
   uint16_t timeIsGoodRate;
   uint16_t suitableDataFoundRate;
+  uint16_t pairsFoundRate;
   uint16_t clockCorrectionRate;
 
   uint32_t nextStatisticsTime;
@@ -4,20 +4,52 @@
 #include "stabilizer_types.h"
 #include "clockCorrectionEngine.h"
 
+// The storage sizes can be set at build time, for instance
+// CFLAGS += -DANCHOR_STORAGE_COUNT=32
+// Each anchor uses roughly 1 kB of RAM with the default remote/tof counts.
+#ifndef ANCHOR_STORAGE_COUNT
 #define ANCHOR_STORAGE_COUNT 16
+#endif
+#ifndef REMOTE_ANCHOR_DATA_COUNT
 #define REMOTE_ANCHOR_DATA_COUNT 16
+#endif
+#ifndef TOF_PER_ANCHOR_COUNT
 #define TOF_PER_ANCHOR_COUNT 16
+#endif
 
+// Slots are indexed with uint8_t (slot + 1, 0 meaning none)
+#if ANCHOR_STORAGE_COUNT > 255 || REMOTE_ANCHOR_DATA_COUNT > 255 || TOF_PER_ANCHOR_COUNT > 255
+#error "tdoaStorage counts must not exceed 255"
+#endif
+
+// Lookups by id use a chained hash index embedded in the storage arrays. Entry
+// i holds the head of bucket i (bucketHead) as well as the link to the next
+// entry in the bucket it belongs to (bucketNext). Both are stored as slot + 1,
+// where 0 means none. The fields fit in padding, the slot order is not changed.
+
+
+// The clock correction implementation is selected at build time
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+typedef clockCorrectionFixedStorage_t tdoaClockCorrectionStorage_t;
+typedef clockCorrectionFixed_t tdoaClockCorrection_t;
+#else
+typedef clockCorrectionStorage_t tdoaClockCorrectionStorage_t;
+typedef double tdoaClockCorrection_t;
+#endif
 
 typedef struct {
   uint8_t id; // Id of remote remote anchor
   uint8_t seqNr; // Sequence number of the packet received in the remote anchor (7 bits)
+  uint8_t bucketHead;
+  uint8_t bucketNext;
   int64_t rxTime; // Receive time of packet from anchor id in the remote anchor, in remote DWM clock
   uint32_t endOfLife;
 } tdoaRemoteAnchorData_t;
 
 typedef struct {
   uint8_t id;
+  uint8_t bucketHead;
+  uint8_t bucketNext;
   int64_t tof;
   uint32_t endOfLife; // Time stamp when the tof data is outdated, local system time in ms
 } tdoaTimeOfFlight_t;
@@ -26,12 +58,14 @@ typedef struct {
   bool isInitialized;
   uint32_t lastUpdateTime; // The time when this anchor was updated the last time
   uint8_t id; // Anchor id
+  uint8_t bucketHead;
+  uint8_t bucketNext;
 
   int64_t txTime; // Transmit time of last packet, in remote DWM clock
   int64_t rxTime; // Receive time of last packet, in local DWM clock
   uint8_t seqNr; // Sequence nr of last packet (7 bits)
 
-  clockCorrectionStorage_t clockCorrectionStorage;
+  tdoaClockCorrectionStorage_t clockCorrectionStorage;
 
   point_t position; // The coordinates of the anchor
 
@@ -63,11 +97,11 @@ int64_t tdoaStorageGetRxTime(const tdoaAnchorContext_t* anchorCtx);
 int64_t tdoaStorageGetTxTime(const tdoaAnchorContext_t* anchorCtx);
 uint8_t tdoaStorageGetSeqNr(const tdoaAnchorContext_t* anchorCtx);
 uint32_t tdoaStorageGetLastUpdateTime(const tdoaAnchorContext_t* anchorCtx);
-clockCorrectionStorage_t* tdoaStorageGetClockCorrectionStorage(const tdoaAnchorContext_t* anchorCtx);
+tdoaClockCorrectionStorage_t* tdoaStorageGetClockCorrectionStorage(const tdoaAnchorContext_t* anchorCtx);
 bool tdoaStorageGetAnchorPosition(const tdoaAnchorContext_t* anchorCtx, point_t* position);
 void tdoaStorageSetAnchorPosition(tdoaAnchorContext_t* anchorCtx, const float x, const float y, const float z);
 void tdoaStorageSetRxTxData(tdoaAnchorContext_t* anchorCtx, int64_t rxTime, int64_t txTime, uint8_t seqNr);
-double tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx);
+tdoaClockCorrection_t tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx);
 int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor);
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr);
 void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* remoteCount, uint8_t seqNr[], uint8_t id[]);
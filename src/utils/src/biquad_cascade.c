@@ -0,0 +1,209 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * biquad_cascade.c - Three axis Butterworth low pass and notch filters built on the
+ *                    CMSIS DSP biquad cascade, with optional decimation
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "biquad_cascade.h"
+
+#define M_PI_F (float)M_PI
+
+/**
+ * Low pass biquad from the bilinear transform with pre-warping, same as
+ * lpf2p for q = 1/sqrt(2). The CMSIS DF2T form uses negated feedback
+ * coefficients: {b0, b1, b2, -a1, -a2}.
+ */
+static void lowPassCoeffs(float* coeffs, float ohm, float q)
+{
+  float c = 1.0f + ohm / q + ohm * ohm;
+  float b0 = ohm * ohm / c;
+
+  coeffs[0] = b0;
+  coeffs[1] = 2.0f * b0;
+  coeffs[2] = b0;
+  coeffs[3] = -2.0f * (ohm * ohm - 1.0f) / c;
+  coeffs[4] = -(1.0f - ohm / q + ohm * ohm) / c;
+}
+
+void biquadCascade3Init(biquadCascade3Data* data, float sampleFreq, float cutoffFreq, uint8_t numStages)
+{
+  if (numStages > BIQUAD_CASCADE_MAX_STAGES) {
+    numStages = BIQUAD_CASCADE_MAX_STAGES;
+  }
+
+  if (cutoffFreq <= 0.0f || cutoffFreq >= sampleFreq / 2.0f) {
+    numStages = 0;
+  }
+
+  memset(data, 0, sizeof(biquadCascade3Data));
+  data->numStages = numStages;
+
+  // Butterworth pole pairs for a filter of order 2 * numStages
+  const float ohm = tanf(M_PI_F * cutoffFreq / sampleFreq);
+  const int order = 2 * numStages;
+  for (int stage = 0; stage < numStages; stage++) {
+    float q = 1.0f / (2.0f * cosf(M_PI_F * (2 * stage + 1) / (2 * order)));
+    lowPassCoeffs(&data->coeffs[5 * stage], ohm, q);
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    arm_biquad_cascade_df2T_init_f32(&data->instance[axis], numStages, data->coeffs, data->state[axis]);
+  }
+}
+
+void biquadCascade3InitNotch(biquadCascade3Data* data, uint8_t numStages)
+{
+  if (numStages > BIQUAD_CASCADE_MAX_STAGES) {
+    numStages = BIQUAD_CASCADE_MAX_STAGES;
+  }
+
+  memset(data, 0, sizeof(biquadCascade3Data));
+  data->numStages = numStages;
+
+  for (int stage = 0; stage < numStages; stage++) {
+    data->coeffs[5 * stage] = 1.0f;
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    arm_biquad_cascade_df2T_init_f32(&data->instance[axis], numStages, data->coeffs, data->state[axis]);
+  }
+}
+
+void biquadCascade3SetNotch(biquadCascade3Data* data, uint8_t stage, float sampleFreq, float centerFreq, float q)
+{
+  if (stage >= data->numStages) {
+    return;
+  }
+
+  float* coeffs = &data->coeffs[5 * stage];
+
+  if (centerFreq <= 0.0f || centerFreq >= sampleFreq / 2.0f) {
+    coeffs[0] = 1.0f;
+    coeffs[1] = 0.0f;
+    coeffs[2] = 0.0f;
+    coeffs[3] = 0.0f;
+    coeffs[4] = 0.0f;
+    return;
+  }
+
+  // Notch from the audio EQ cookbook, unity gain away from the center frequency
+  float omega = 2.0f * M_PI_F * centerFreq / sampleFreq;
+  float cosOmega = cosf(omega);
+  float alpha = sinf(omega) / (2.0f * q);
+  float a0 = 1.0f + alpha;
+
+  coeffs[0] = 1.0f / a0;
+  coeffs[1] = -2.0f * cosOmega / a0;
+  coeffs[2] = 1.0f / a0;
+  coeffs[3] = 2.0f * cosOmega / a0;
+  coeffs[4] = -(1.0f - alpha) / a0;
+}
+
+void biquadCascade3Apply(biquadCascade3Data* data, Axis3f* samples, uint32_t count)
+{
+  float buffer[3][BIQUAD_CASCADE_MAX_BLOCK_SIZE];
+
+  if (data->numStages == 0 || count == 0) {
+    return;
+  }
+
+  if (count > BIQUAD_CASCADE_MAX_BLOCK_SIZE) {
+    count = BIQUAD_CASCADE_MAX_BLOCK_SIZE;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    buffer[0][i] = samples[i].x;
+    buffer[1][i] = samples[i].y;
+    buffer[2][i] = samples[i].z;
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    arm_biquad_cascade_df2T_f32(&data->instance[axis], buffer[axis], buffer[axis], count);
+
+    if (!isfinite(buffer[axis][count - 1])) {
+      // don't allow bad values to propagate via the filter
+      memset(data->state[axis], 0, sizeof(data->state[axis]));
+      for (uint32_t i = 0; i < count; i++) {
+        buffer[axis][i] = samples[i].axis[axis];
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    samples[i].x = buffer[0][i];
+    samples[i].y = buffer[1][i];
+    samples[i].z = buffer[2][i];
+  }
+}
+
+void filterPipeline3Init(filterPipeline3Data* data, float outputFreq, uint8_t decimation,
+                         float antiAliasCutoffFreq, uint8_t antiAliasStages,
+                         float cutoffFreq, uint8_t stages)
+{
+  if (decimation < 1) {
+    decimation = 1;
+  }
+
+  if (decimation == 1) {
+    antiAliasStages = 0;
+  }
+
+  data->decimation = decimation;
+  data->phase = 0;
+  biquadCascade3Init(&data->antiAlias, outputFreq * decimation, antiAliasCutoffFreq, antiAliasStages);
+  biquadCascade3Init(&data->lowPass, outputFreq, cutoffFreq, stages);
+}
+
+bool filterPipeline3Apply(filterPipeline3Data* data, const Axis3f* samples, uint32_t count, Axis3f* out)
+{
+  Axis3f buffer[BIQUAD_CASCADE_MAX_BLOCK_SIZE];
+
+  if (count > BIQUAD_CASCADE_MAX_BLOCK_SIZE) {
+    count = BIQUAD_CASCADE_MAX_BLOCK_SIZE;
+  }
+
+  memcpy(buffer, samples, count * sizeof(Axis3f));
+  biquadCascade3Apply(&data->antiAlias, buffer, count);
+
+  uint32_t decimatedCount = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    data->phase++;
+    if (data->phase >= data->decimation) {
+      data->phase = 0;
+      buffer[decimatedCount++] = buffer[i];
+    }
+  }
+
+  if (decimatedCount == 0) {
+    return false;
+  }
+
+  biquadCascade3Apply(&data->lowPass, buffer, decimatedCount);
+  *out = buffer[decimatedCount - 1];
+
+  return true;
+}
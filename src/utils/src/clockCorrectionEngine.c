@@ -8,6 +8,13 @@
 #define CLOCK_CORRECTION_FILTER 0.1
 #define CLOCK_CORRECTION_BUCKET_MAX 4
 
+// The fixed point constants are folded at compile time
+#define CLOCK_CORRECTION_FIXED_SPEC_MIN (CLOCK_CORRECTION_FIXED_ONE - (int64_t)(MAX_CLOCK_DEVIATION_SPEC * 2 * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_SPEC_MAX (CLOCK_CORRECTION_FIXED_ONE + (int64_t)(MAX_CLOCK_DEVIATION_SPEC * 2 * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE ((int64_t)(CLOCK_CORRECTION_ACCEPTED_NOISE * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_FILTER ((int64_t)(CLOCK_CORRECTION_FILTER * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_MAX INT64_MAX
+
 /**
  Logging all the clock correction information requires scaling the values repeatedly, which is computer intense. Thus, the logging functionality is enabled at compile time with the CLOCK_CORRECTION_ENABLE_LOGGING flag.
  */
@@ -43,18 +50,18 @@ static uint64_t truncateTimeStamp(uint64_t timeStamp, uint64_t mask) {
 /**
  Implementation of the leaky bucket algorithm. See: https://en.wikipedia.org/wiki/Leaky_bucket
  */
-static void fillClockCorrectionBucket(clockCorrectionStorage_t* storage) {
-  if (storage->clockCorrectionBucket < CLOCK_CORRECTION_BUCKET_MAX) {
-    storage->clockCorrectionBucket++;
+static void fillClockCorrectionBucket(unsigned int* clockCorrectionBucket) {
+  if (*clockCorrectionBucket < CLOCK_CORRECTION_BUCKET_MAX) {
+    (*clockCorrectionBucket)++;
   }
 }
 
 /**
  Implementation of the leaky bucket algorithm. See: https://en.wikipedia.org/wiki/Leaky_bucket
  */
-static bool emptyClockCorrectionBucket(clockCorrectionStorage_t* storage) {
-  if (storage->clockCorrectionBucket > 0) {
-    storage->clockCorrectionBucket--;
+static bool emptyClockCorrectionBucket(unsigned int* clockCorrectionBucket) {
+  if (*clockCorrectionBucket > 0) {
+    (*clockCorrectionBucket)--;
     return false;
   }
 
@@ -106,10 +113,10 @@ bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double
     const double newClockCorrection = currentClockCorrection * CLOCK_CORRECTION_FILTER + clockCorrectionCandidate * (1.0 - CLOCK_CORRECTION_FILTER);
 
     sampleIsReliable = true;
-    fillClockCorrectionBucket(storage);
+    fillClockCorrectionBucket(&storage->clockCorrectionBucket);
     storage->clockCorrection = newClockCorrection;
   } else {
-    const bool shouldAcceptANewClockReference = emptyClockCorrectionBucket(storage);
+    const bool shouldAcceptANewClockReference = emptyClockCorrectionBucket(&storage->clockCorrectionBucket);
     if (shouldAcceptANewClockReference) {
       if (CLOCK_CORRECTION_SPEC_MIN < clockCorrectionCandidate && clockCorrectionCandidate < CLOCK_CORRECTION_SPEC_MAX) {
         // We do not fill the bucket and accept the clock correction sample as reliable: a sample is reliable when it is in the accepted noise level (which means that we already have two or more samples that are similar) and has been LP filtered. See: https://github.com/bitcraze/crazyflie-firmware/pull/328
@@ -121,6 +128,138 @@ bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double
   return sampleIsReliable;
 }
 
+/**
+ Obtains the fixed point clock correction from a clockCorrectionFixedStorage_t object.
+ */
+clockCorrectionFixed_t clockCorrectionEngineGetFixed(const clockCorrectionFixedStorage_t* storage) {
+  return storage->clockCorrection;
+}
+
+/**
+ Converts a fixed point clock correction to float, for logging.
+ */
+float clockCorrectionEngineFixedToFloat(const clockCorrectionFixed_t clockCorrection) {
+  // Convert the (small) deviation from 1.0 to keep the float precision
+  return 1.0f + (float)(clockCorrection - CLOCK_CORRECTION_FIXED_ONE) * (1.0f / (float)CLOCK_CORRECTION_FIXED_ONE);
+}
+
+/**
+ Calculates tickCount_in_cl_reference / tickCount_in_cl_x in Q3.60, rounded to nearest.
+
+ @return The ratio, saturated to CLOCK_CORRECTION_FIXED_MAX if it does not fit or tickCount_in_cl_x is 0
+ */
+clockCorrectionFixed_t clockCorrectionEngineRatioFixed(const uint64_t tickCount_in_cl_reference, const uint64_t tickCount_in_cl_x) {
+  if (tickCount_in_cl_x == 0) {
+    return CLOCK_CORRECTION_FIXED_MAX;
+  }
+
+  uint64_t quotient = tickCount_in_cl_reference / tickCount_in_cl_x;
+  uint64_t remainder = tickCount_in_cl_reference % tickCount_in_cl_x;
+  if (quotient >= ((uint64_t)CLOCK_CORRECTION_FIXED_MAX >> CLOCK_CORRECTION_FIXED_FRACTION_BITS)) {
+    return CLOCK_CORRECTION_FIXED_MAX;
+  }
+
+  // Long division, as many fraction bits per step as fits in the remainder
+  const int stepBits = __builtin_clzll(tickCount_in_cl_x) - 1;
+  if (stepBits < 1) {
+    // Only possible for timestamps wider than 62 bits, not supported
+    return CLOCK_CORRECTION_FIXED_MAX;
+  }
+
+  int bitsLeft = CLOCK_CORRECTION_FIXED_FRACTION_BITS;
+  while (bitsLeft > 0) {
+    const int bits = bitsLeft < stepBits ? bitsLeft : stepBits;
+    remainder <<= bits;
+    quotient = (quotient << bits) | (remainder / tickCount_in_cl_x);
+    remainder = remainder % tickCount_in_cl_x;
+    bitsLeft -= bits;
+  }
+
+  if (remainder >= tickCount_in_cl_x - remainder) {
+    quotient++;
+  }
+
+  return (clockCorrectionFixed_t)quotient;
+}
+
+/**
+ Fixed point version of clockCorrectionEngineCalculate().
+
+ @return The clock correction in Q3.60, or -CLOCK_CORRECTION_FIXED_ONE if it was not possible to perform the computation
+ */
+clockCorrectionFixed_t clockCorrectionEngineCalculateFixed(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask) {
+  const uint64_t tickCount_in_cl_reference = truncateTimeStamp(new_t_in_cl_reference - old_t_in_cl_reference, mask);
+  const uint64_t tickCount_in_cl_x = truncateTimeStamp(new_t_in_cl_x - old_t_in_cl_x, mask);
+
+  if (tickCount_in_cl_x == 0) {
+    return -CLOCK_CORRECTION_FIXED_ONE;
+  }
+
+  return clockCorrectionEngineRatioFixed(tickCount_in_cl_reference, tickCount_in_cl_x);
+}
+
+/**
+ Multiplies a tick count with a fixed point clock correction, ticks * clockCorrection rounded to nearest tick.
+ The 128 bit intermediate product is built from 32 bit partial products, which the Cortex-M4 does in hardware.
+ */
+int64_t clockCorrectionEngineApplyFixed(const int64_t ticks, const clockCorrectionFixed_t clockCorrection) {
+  const bool isNegative = (ticks < 0) != (clockCorrection < 0);
+  const uint64_t a = ticks < 0 ? -(uint64_t)ticks : (uint64_t)ticks;
+  const uint64_t b = clockCorrection < 0 ? -(uint64_t)clockCorrection : (uint64_t)clockCorrection;
+
+  const uint64_t a0 = a & 0xffffffff;
+  const uint64_t a1 = a >> 32;
+  const uint64_t b0 = b & 0xffffffff;
+  const uint64_t b1 = b >> 32;
+
+  const uint64_t p00 = a0 * b0;
+  const uint64_t p01 = a0 * b1;
+  const uint64_t p10 = a1 * b0;
+  const uint64_t p11 = a1 * b1;
+
+  const uint64_t middle = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+  uint64_t low = (middle << 32) | (p00 & 0xffffffff);
+  uint64_t high = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+
+  // Round to nearest
+  const uint64_t half = (uint64_t)1 << (CLOCK_CORRECTION_FIXED_FRACTION_BITS - 1);
+  low += half;
+  if (low < half) {
+    high++;
+  }
+
+  const uint64_t result = (high << (64 - CLOCK_CORRECTION_FIXED_FRACTION_BITS)) | (low >> CLOCK_CORRECTION_FIXED_FRACTION_BITS);
+  return isNegative ? -(int64_t)result : (int64_t)result;
+}
+
+/**
+ Fixed point version of clockCorrectionEngineUpdate(), with the same filtering and leaky bucket logic.
+ */
+bool clockCorrectionEngineUpdateFixed(clockCorrectionFixedStorage_t* storage, const clockCorrectionFixed_t clockCorrectionCandidate) {
+  bool sampleIsReliable = false;
+
+  const clockCorrectionFixed_t currentClockCorrection = storage->clockCorrection;
+  const int64_t difference = clockCorrectionCandidate - currentClockCorrection;
+
+  if (-CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE < difference && difference < CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE) {
+    // Simple low pass filter, current * filter + candidate * (1 - filter)
+    const clockCorrectionFixed_t newClockCorrection = clockCorrectionCandidate + clockCorrectionEngineApplyFixed(-difference, CLOCK_CORRECTION_FIXED_FILTER);
+
+    sampleIsReliable = true;
+    fillClockCorrectionBucket(&storage->clockCorrectionBucket);
+    storage->clockCorrection = newClockCorrection;
+  } else {
+    const bool shouldAcceptANewClockReference = emptyClockCorrectionBucket(&storage->clockCorrectionBucket);
+    if (shouldAcceptANewClockReference) {
+      if (CLOCK_CORRECTION_FIXED_SPEC_MIN < clockCorrectionCandidate && clockCorrectionCandidate < CLOCK_CORRECTION_FIXED_SPEC_MAX) {
+        storage->clockCorrection = clockCorrectionCandidate;
+      }
+    }
+  }
+
+  return sampleIsReliable;
+}
+
 #ifdef CLOCK_CORRECTION_ENABLE_LOGGING
 LOG_GROUP_START(CkCorrection)
 LOG_ADD(LOG_FLOAT, minNoise, &logMinAcceptedNoiseLimit)
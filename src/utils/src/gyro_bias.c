@@ -0,0 +1,110 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * gyro_bias.c - Streaming gyro bias estimator
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "gyro_bias.h"
+
+static void gyroBiasResetWindow(gyroBias_t* gb)
+{
+  gb->count = 0;
+  memset(gb->mean, 0, sizeof(gb->mean));
+  memset(gb->m2, 0, sizeof(gb->m2));
+}
+
+static void gyroBiasEndOfWindow(gyroBias_t* gb)
+{
+  float variance[3];
+  for (int i = 0; i < 3; i++)
+  {
+    variance[i] = gb->m2[i] / (gb->count - 1);
+    gb->variance.axis[i] = variance[i];
+  }
+
+  if (!gb->isBiasValueFound)
+  {
+    if (variance[0] < gb->varianceThreshold &&
+        variance[1] < gb->varianceThreshold &&
+        variance[2] < gb->varianceThreshold)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        gb->bias.axis[i] = gb->mean[i];
+      }
+      gb->isBiasValueFound = true;
+      gb->updateCount++;
+    }
+    return;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (variance[i] >= gb->trackingVarianceThreshold ||
+        fabsf(gb->mean[i] - gb->bias.axis[i]) > gb->trackingMaxOffset)
+    {
+      return;
+    }
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    gb->bias.axis[i] += (gb->mean[i] - gb->bias.axis[i]) * gb->trackingGain;
+  }
+  gb->updateCount++;
+}
+
+void gyroBiasInit(gyroBias_t* gb, uint32_t windowSize, float varianceThreshold,
+                  float trackingVarianceThreshold, float trackingMaxOffset, float trackingGain)
+{
+  memset(gb, 0, sizeof(gyroBias_t));
+  gb->windowSize = windowSize;
+  gb->varianceThreshold = varianceThreshold;
+  gb->trackingVarianceThreshold = trackingVarianceThreshold;
+  gb->trackingMaxOffset = trackingMaxOffset;
+  gb->trackingGain = trackingGain;
+}
+
+bool gyroBiasAdd(gyroBias_t* gb, int16_t x, int16_t y, int16_t z)
+{
+  const float sample[3] = {x, y, z};
+
+  gb->count++;
+  for (int i = 0; i < 3; i++)
+  {
+    float delta = sample[i] - gb->mean[i];
+    gb->mean[i] += delta / gb->count;
+    gb->m2[i] += delta * (sample[i] - gb->mean[i]);
+  }
+
+  if (gb->count >= gb->windowSize)
+  {
+    gyroBiasEndOfWindow(gb);
+    gyroBiasResetWindow(gb);
+  }
+
+  return gb->isBiasValueFound;
+}
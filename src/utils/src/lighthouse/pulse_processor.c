@@ -181,6 +181,7 @@ static bool processPreviousFrame(pulseProcessor_t *state, pulseProcessorResult_t
           *axis = state->currentAxis;
 
           result[sensor].angles[state->currentBaseStation][state->currentAxis] = angle;
+          result[sensor].isAngleValid[state->currentBaseStation][state->currentAxis] = true;
           result[sensor].validCount++;
 
           anglesMeasured = true;
@@ -60,6 +60,8 @@ void tdoaEngineInit(tdoaEngineState_t* engineState, const uint32_t now_ms, tdoaE
   tdoaStatsInit(&engineState->stats, now_ms);
   engineState->sendTdoaToEstimator = sendTdoaToEstimator;
   engineState->locodeckTsFreq = locodeckTsFreq;
+  engineState->distancePerTick = SPEED_OF_LIGHT / locodeckTsFreq;
+  engineState->maxPairsPerPacket = 1;
 }
 
 #define TRUNCATE_TO_ANCHOR_TS_BITMAP 0x00FFFFFFFF
@@ -67,17 +69,15 @@ static uint64_t truncateToAnchorTimeStamp(uint64_t fullTimeStamp) {
   return fullTimeStamp & TRUNCATE_TO_ANCHOR_TS_BITMAP;
 }
 
-static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorContext_t* anchorBCtx, double distanceDiff, tdoaEngineState_t* engineState) {
+static bool addTdoaToBatch(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorContext_t* anchorBCtx, float distanceDiff, tdoaEngineState_t* engineState, tdoaMeasurement_t* tdoa) {
   tdoaStats_t* stats = &engineState->stats;
 
-  tdoaMeasurement_t tdoa = {
-    .stdDev = MEASUREMENT_NOISE_STD,
-    .distanceDiff = distanceDiff
-  };
+  memset(tdoa, 0, sizeof(tdoaMeasurement_t));
+  tdoa->stdDev = MEASUREMENT_NOISE_STD;
+  tdoa->distanceDiff = distanceDiff;
 
-  if (tdoaStorageGetAnchorPosition(anchorACtx, &tdoa.anchorPosition[0]) && tdoaStorageGetAnchorPosition(anchorBCtx, &tdoa.anchorPosition[1])) {
+  if (tdoaStorageGetAnchorPosition(anchorACtx, &tdoa->anchorPosition[0]) && tdoaStorageGetAnchorPosition(anchorBCtx, &tdoa->anchorPosition[1])) {
       stats->packetsToEstimator++;
-      engineState->sendTdoaToEstimator(&tdoa);
 
       uint8_t idA = tdoaStorageGetId(anchorACtx);
       uint8_t idB = tdoaStorageGetId(anchorBCtx);
@@ -87,7 +87,11 @@ static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorC
       if (idB == stats->anchorId && idA == stats->remoteAnchorId) {
         stats->tdoa = -distanceDiff;
       }
+
+      return true;
   }
+
+  return false;
 }
 
 static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, tdoaStats_t* stats) {
@@ -97,12 +101,21 @@ static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t
   const int64_t latest_txAn_in_cl_An = tdoaStorageGetTxTime(anchorCtx);
 
   if (latest_rxAn_by_T_in_cl_T != 0 && latest_txAn_in_cl_An != 0) {
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+    clockCorrectionFixed_t clockCorrectionCandidate = clockCorrectionEngineCalculateFixed(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TRUNCATE_TO_ANCHOR_TS_BITMAP);
+    sampleIsReliable = clockCorrectionEngineUpdateFixed(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+#else
     double clockCorrectionCandidate = clockCorrectionEngineCalculate(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TRUNCATE_TO_ANCHOR_TS_BITMAP);
     sampleIsReliable = clockCorrectionEngineUpdate(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+#endif
 
     if (sampleIsReliable){
       if (tdoaStorageGetId(anchorCtx) == stats->anchorId) {
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+        stats->clockCorrection = clockCorrectionEngineFixedToFloat(tdoaStorageGetClockCorrection(anchorCtx));
+#else
         stats->clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
+#endif
         stats->clockCorrectionCount++;
       }
     }
@@ -116,28 +129,36 @@ static int64_t calcTDoA(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnc
 
   const int64_t tof_Ar_to_An_in_cl_An = tdoaStorageGetTimeOfFlight(anchorCtx, otherAnchorId);
   const int64_t rxAr_by_An_in_cl_An = tdoaStorageGetRemoteRxTime(anchorCtx, otherAnchorId);
-  const double clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
+  const tdoaClockCorrection_t clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
 
   const int64_t rxAr_by_T_in_cl_T = tdoaStorageGetRxTime(otherAnchorCtx);
 
   const int64_t delta_txAr_to_txAn_in_cl_An = (tof_Ar_to_An_in_cl_An + truncateToAnchorTimeStamp(txAn_in_cl_An - rxAr_by_An_in_cl_An));
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  const int64_t timeDiffOfArrival_in_cl_T =  truncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T) - clockCorrectionEngineApplyFixed(delta_txAr_to_txAn_in_cl_An, clockCorrection);
+#else
   const int64_t timeDiffOfArrival_in_cl_T =  truncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T) - delta_txAr_to_txAn_in_cl_An  * clockCorrection;
+#endif
 
   return timeDiffOfArrival_in_cl_T;
 }
 
-static double calcDistanceDiff(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const double locodeckTsFreq) {
+static float calcDistanceDiff(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const tdoaEngineState_t* engineState) {
   const int64_t tdoa = calcTDoA(otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T);
-  return SPEED_OF_LIGHT * tdoa / locodeckTsFreq;
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  return (float)tdoa * engineState->distancePerTick;
+#else
+  return SPEED_OF_LIGHT * tdoa / engineState->locodeckTsFreq;
+#endif
 }
 
-static bool findSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx) {
+static int findSuitableAnchors(tdoaEngineState_t* engineState, tdoaAnchorContext_t otherAnchorCtxs[], const int maxCount, const tdoaAnchorContext_t* anchorCtx) {
   static uint8_t seqNr[REMOTE_ANCHOR_DATA_COUNT];
   static uint8_t id[REMOTE_ANCHOR_DATA_COUNT];
   static uint8_t offset = 0;
 
-  if (tdoaStorageGetClockCorrection(anchorCtx) <= 0.0) {
-    return false;
+  if (tdoaStorageGetClockCorrection(anchorCtx) <= 0) {
+    return 0;
   }
 
   offset++;
@@ -145,22 +166,25 @@ static bool findSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext
   tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, seqNr, id);
 
   uint32_t now_ms = anchorCtx->currentTime_ms;
-
-  // Loop over the candidates and pick the first one that is useful
-  // An offset (updated for each call) is added to make sure we start at
-  // different positions in the list and vary which candidate to choose
-  for (int i = offset; i < (remoteCount + offset); i++) {
+  int count = 0;
+
+  // Loop over the candidates and pick the first ones that are useful, up to
+  // maxCount. An offset (updated for each call) is added to make sure we start
+  // at different positions in the list and vary which candidates to choose.
+  // Candidates that are not in the storage are skipped, looking them up must
+  // not create contexts and evict anchors that are in use.
+  for (int i = offset; i < (remoteCount + offset) && count < maxCount; i++) {
     uint8_t index = i % remoteCount;
     const uint8_t candidateAnchorId = id[index];
-    if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
+    tdoaAnchorContext_t* otherAnchorCtx = &otherAnchorCtxs[count];
+    if (tdoaStorageGetAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
       if (seqNr[index] == tdoaStorageGetSeqNr(otherAnchorCtx) && tdoaStorageGetTimeOfFlight(anchorCtx, candidateAnchorId)) {
-        return true;
+        count++;
       }
     }
   }
 
-  otherAnchorCtx->anchorInfo = 0;
-  return false;
+  return count;
 }
 
 void tdoaEngineGetAnchorCtxForPacketProcessing(tdoaEngineState_t* engineState, const uint8_t anchorId, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
@@ -176,11 +200,32 @@ void tdoaEngineProcessPacket(tdoaEngineState_t* engineState, tdoaAnchorContext_t
   if (timeIsGood) {
     engineState->stats.timeIsGood++;
 
-    tdoaAnchorContext_t otherAnchorCtx;
-    if (findSuitableAnchor(engineState, &otherAnchorCtx, anchorCtx)) {
+    int maxPairs = engineState->maxPairsPerPacket;
+    if (maxPairs < 1) {
+      maxPairs = 1;
+    }
+    if (maxPairs > TDOA_ENGINE_MAX_PAIRS_PER_PACKET) {
+      maxPairs = TDOA_ENGINE_MAX_PAIRS_PER_PACKET;
+    }
+
+    tdoaAnchorContext_t otherAnchorCtxs[TDOA_ENGINE_MAX_PAIRS_PER_PACKET];
+    const int pairCount = findSuitableAnchors(engineState, otherAnchorCtxs, maxPairs, anchorCtx);
+    if (pairCount > 0) {
       engineState->stats.suitableDataFound++;
-      double tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->locodeckTsFreq);
-      enqueueTDOA(&otherAnchorCtx, anchorCtx, tdoaDistDiff, engineState);
+      engineState->stats.pairsFound += pairCount;
+
+      tdoaMeasurement_t batch[TDOA_ENGINE_MAX_PAIRS_PER_PACKET];
+      int batchCount = 0;
+      for (int i = 0; i < pairCount; i++) {
+        float tdoaDistDiff = calcDistanceDiff(&otherAnchorCtxs[i], anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState);
+        if (addTdoaToBatch(&otherAnchorCtxs[i], anchorCtx, tdoaDistDiff, engineState, &batch[batchCount])) {
+          batchCount++;
+        }
+      }
+
+      if (batchCount > 0) {
+        engineState->sendTdoaToEstimator(batch, batchCount);
+      }
     }
   }
 }
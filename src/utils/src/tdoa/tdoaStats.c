@@ -42,6 +42,7 @@ static void clearStats(tdoaStats_t* tdoaStats) {
   tdoaStats->contextMissCount = 0;
   tdoaStats->timeIsGood = 0;
   tdoaStats->suitableDataFound = 0;
+  tdoaStats->pairsFound = 0;
 }
 
 void tdoaStatsInit(tdoaStats_t* tdoaStats, uint32_t now_ms) {
@@ -68,6 +69,7 @@ void tdoaStatsUpdate(tdoaStats_t* tdoaStats, uint32_t now_ms) {
       tdoaStats->contextMissRate = (uint16_t)(1000.0f * tdoaStats->contextMissCount / interval);
 
       tdoaStats->suitableDataFoundRate = (uint16_t)(1000.0f * tdoaStats->suitableDataFound / interval);
+      tdoaStats->pairsFoundRate = (uint16_t)(1000.0f * tdoaStats->pairsFound / interval);
       tdoaStats->timeIsGoodRate = (uint16_t)(1000.0f * tdoaStats->timeIsGood / interval);
     }
 
@@ -43,6 +43,12 @@ Data storage encapsulation for the TDoA engine
 
 
 static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor);
+static int findAnchorSlot(const tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor);
+static void unlinkAnchorSlot(tdoaAnchorInfo_t anchorStorage[], const int slot);
+static int findRemoteAnchorDataSlot(const tdoaAnchorInfo_t* anchorInfo, const uint8_t remoteAnchor);
+static void unlinkRemoteAnchorDataSlot(tdoaAnchorInfo_t* anchorInfo, const int slot);
+static int findTofSlot(const tdoaAnchorInfo_t* anchorInfo, const uint8_t remoteAnchor);
+static void unlinkTofSlot(tdoaAnchorInfo_t* anchorInfo, const int slot);
 
 void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
   memset(anchorStorage, 0, sizeof(tdoaAnchorInfo_t) * ANCHOR_STORAGE_COUNT);
@@ -50,33 +56,36 @@ void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
 
 bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
+
+  int slot = findAnchorSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage[slot];
+    return true;
+  }
+
+  // The anchor was not found in storage, use the first free slot or replace
+  // the least recently updated anchor
   uint32_t oldestUpdateTime = currentTime_ms;
   int firstUninitializedSlot = -1;
   int oldestSlot = 0;
 
   for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
     if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-
       if (anchorStorage[i].lastUpdateTime < oldestUpdateTime) {
         oldestUpdateTime = anchorStorage[i].lastUpdateTime;
         oldestSlot = i;
       }
     } else {
-      if (firstUninitializedSlot == -1) {
-        firstUninitializedSlot = i;
-      }
+      firstUninitializedSlot = i;
+      break;
     }
   }
 
-  // The anchor was not found in storage
   tdoaAnchorInfo_t* newAnchorInfo = 0;
   if (firstUninitializedSlot != -1) {
     newAnchorInfo = initializeSlot(anchorStorage, firstUninitializedSlot, anchor);
   } else {
+    unlinkAnchorSlot(anchorStorage, oldestSlot);
     newAnchorInfo = initializeSlot(anchorStorage, oldestSlot, anchor);
   }
 
@@ -87,13 +96,10 @@ bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8
 bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-    }
+  int slot = findAnchorSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage[slot];
+    return true;
   }
 
   anchorCtx->anchorInfo = 0;
@@ -147,7 +153,7 @@ uint32_t tdoaStorageGetLastUpdateTime(const tdoaAnchorContext_t* anchorCtx) {
   return anchorCtx->anchorInfo->lastUpdateTime;
 }
 
-clockCorrectionStorage_t* tdoaStorageGetClockCorrectionStorage(const tdoaAnchorContext_t* anchorCtx) {
+tdoaClockCorrectionStorage_t* tdoaStorageGetClockCorrectionStorage(const tdoaAnchorContext_t* anchorCtx) {
   return &anchorCtx->anchorInfo->clockCorrectionStorage;
 }
 
@@ -187,20 +193,22 @@ void tdoaStorageSetRxTxData(tdoaAnchorContext_t* anchorCtx, int64_t rxTime, int6
   anchorInfo->lastUpdateTime = now;
 }
 
-double tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx) {
+tdoaClockCorrection_t tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx) {
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  return clockCorrectionEngineGetFixed(&anchorCtx->anchorInfo->clockCorrectionStorage);
+#else
   return clockCorrectionEngineGet(&anchorCtx->anchorInfo->clockCorrectionStorage);
+#endif
 }
 
 int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor) {
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
-        return anchorInfo->remoteAnchorData[i].rxTime;
-      }
-      break;
+  int slot = findRemoteAnchorDataSlot(anchorInfo, remoteAnchor);
+  if (slot >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (anchorInfo->remoteAnchorData[slot].endOfLife > now) {
+      return anchorInfo->remoteAnchorData[slot].rxTime;
     }
   }
 
@@ -209,24 +217,26 @@ int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const u
 
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;
   uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      indexToUpdate = i;
-      break;
+  int indexToUpdate = findRemoteAnchorDataSlot(anchorInfo, remoteAnchor);
+  if (indexToUpdate < 0) {
+    uint32_t oldestTime = 0xFFFFFFFF;
+    for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
+      if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {
+        oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
+        indexToUpdate = i;
+      }
     }
 
-    if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
-      indexToUpdate = i;
-    }
+    unlinkRemoteAnchorDataSlot(anchorInfo, indexToUpdate);
+
+    tdoaRemoteAnchorData_t* bucket = &anchorInfo->remoteAnchorData[remoteAnchor % REMOTE_ANCHOR_DATA_COUNT];
+    anchorInfo->remoteAnchorData[indexToUpdate].id = remoteAnchor;
+    anchorInfo->remoteAnchorData[indexToUpdate].bucketNext = bucket->bucketHead;
+    bucket->bucketHead = indexToUpdate + 1;
   }
 
-  anchorInfo->remoteAnchorData[indexToUpdate].id = remoteAnchor;
   anchorInfo->remoteAnchorData[indexToUpdate].rxTime = remoteRxTime;
   anchorInfo->remoteAnchorData[indexToUpdate].seqNr = remoteSeqNr;
   anchorInfo->remoteAnchorData[indexToUpdate].endOfLife = now + REMOTE_DATA_VALIDITY_PERIOD;
@@ -252,13 +262,11 @@ void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* re
 int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor) {
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (otherAnchor == anchorInfo->tof[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->tof[i].endOfLife > now) {
-        return anchorInfo->tof[i].tof;
-      }
-      break;
+  int slot = findTofSlot(anchorInfo, otherAnchor);
+  if (slot >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (anchorInfo->tof[slot].endOfLife > now) {
+      return anchorInfo->tof[slot].tof;
     }
   }
 
@@ -267,44 +275,120 @@ int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const u
 
 void tdoaStorageSetTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;
   uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->tof[i].id) {
-      indexToUpdate = i;
-      break;
+  int indexToUpdate = findTofSlot(anchorInfo, remoteAnchor);
+  if (indexToUpdate < 0) {
+    uint32_t oldestTime = 0xFFFFFFFF;
+    for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
+      if (anchorInfo->tof[i].endOfLife < oldestTime) {
+        oldestTime = anchorInfo->tof[i].endOfLife;
+        indexToUpdate = i;
+      }
     }
 
-    if (anchorInfo->tof[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->tof[i].endOfLife;
-      indexToUpdate = i;
-    }
+    unlinkTofSlot(anchorInfo, indexToUpdate);
+
+    tdoaTimeOfFlight_t* bucket = &anchorInfo->tof[remoteAnchor % TOF_PER_ANCHOR_COUNT];
+    anchorInfo->tof[indexToUpdate].id = remoteAnchor;
+    anchorInfo->tof[indexToUpdate].bucketNext = bucket->bucketHead;
+    bucket->bucketHead = indexToUpdate + 1;
   }
 
-  anchorInfo->tof[indexToUpdate].id = remoteAnchor;
   anchorInfo->tof[indexToUpdate].tof = tof;
   anchorInfo->tof[indexToUpdate].endOfLife = now + TOF_VALIDITY_PERIOD;
 }
 
 bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return findAnchorSlot(anchorStorage, anchor) >= 0;
 }
 
 static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor) {
+  // The bucket head belongs to the index, not to the anchor in the slot
+  const uint8_t bucketHead = anchorStorage[slot].bucketHead;
   memset(&anchorStorage[slot], 0, sizeof(tdoaAnchorInfo_t));
+  anchorStorage[slot].bucketHead = bucketHead;
+
   anchorStorage[slot].id = anchor;
   anchorStorage[slot].isInitialized = true;
 
+  tdoaAnchorInfo_t* bucket = &anchorStorage[anchor % ANCHOR_STORAGE_COUNT];
+  anchorStorage[slot].bucketNext = bucket->bucketHead;
+  bucket->bucketHead = slot + 1;
+
   return &anchorStorage[slot];
 }
+
+static int findAnchorSlot(const tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
+  uint8_t link = anchorStorage[anchor % ANCHOR_STORAGE_COUNT].bucketHead;
+  while (link) {
+    const int slot = link - 1;
+    if (anchor == anchorStorage[slot].id) {
+      return slot;
+    }
+    link = anchorStorage[slot].bucketNext;
+  }
+
+  return -1;
+}
+
+static void unlinkAnchorSlot(tdoaAnchorInfo_t anchorStorage[], const int slot) {
+  uint8_t* link = &anchorStorage[anchorStorage[slot].id % ANCHOR_STORAGE_COUNT].bucketHead;
+  while (*link) {
+    if (*link == slot + 1) {
+      *link = anchorStorage[slot].bucketNext;
+      return;
+    }
+    link = &anchorStorage[*link - 1].bucketNext;
+  }
+}
+
+static int findRemoteAnchorDataSlot(const tdoaAnchorInfo_t* anchorInfo, const uint8_t remoteAnchor) {
+  uint8_t link = anchorInfo->remoteAnchorData[remoteAnchor % REMOTE_ANCHOR_DATA_COUNT].bucketHead;
+  while (link) {
+    const int slot = link - 1;
+    if (remoteAnchor == anchorInfo->remoteAnchorData[slot].id) {
+      return slot;
+    }
+    link = anchorInfo->remoteAnchorData[slot].bucketNext;
+  }
+
+  return -1;
+}
+
+static void unlinkRemoteAnchorDataSlot(tdoaAnchorInfo_t* anchorInfo, const int slot) {
+  tdoaRemoteAnchorData_t* data = anchorInfo->remoteAnchorData;
+  uint8_t* link = &data[data[slot].id % REMOTE_ANCHOR_DATA_COUNT].bucketHead;
+  while (*link) {
+    if (*link == slot + 1) {
+      *link = data[slot].bucketNext;
+      return;
+    }
+    link = &data[*link - 1].bucketNext;
+  }
+}
+
+static int findTofSlot(const tdoaAnchorInfo_t* anchorInfo, const uint8_t remoteAnchor) {
+  uint8_t link = anchorInfo->tof[remoteAnchor % TOF_PER_ANCHOR_COUNT].bucketHead;
+  while (link) {
+    const int slot = link - 1;
+    if (remoteAnchor == anchorInfo->tof[slot].id) {
+      return slot;
+    }
+    link = anchorInfo->tof[slot].bucketNext;
+  }
+
+  return -1;
+}
+
+static void unlinkTofSlot(tdoaAnchorInfo_t* anchorInfo, const int slot) {
+  tdoaTimeOfFlight_t* tof = anchorInfo->tof;
+  uint8_t* link = &tof[tof[slot].id % TOF_PER_ANCHOR_COUNT].bucketHead;
+  while (*link) {
+    if (*link == slot + 1) {
+      *link = tof[slot].bucketNext;
+      return;
+    }
+    link = &tof[*link - 1].bucketNext;
+  }
+}
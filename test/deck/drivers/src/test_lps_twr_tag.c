@@ -17,7 +17,8 @@
 // The mocking FW can not handle the cf_math.h/arm_math.h file, it crashes while parsing it. We have to use manual mocks instead.
 // Temporarily fix to make tests pass, add test code for the estimator part of rxcallback()
 #include "cf_math.h"
-void arm_std_f32( float32_t * pSrc, uint32_t blockSize, float32_t * pResult) { *pResult = 0.0; }
+static float32_t armStdResult;
+void arm_std_f32( float32_t * pSrc, uint32_t blockSize, float32_t * pResult) { *pResult = armStdResult; }
 void arm_mean_f32( float32_t * pSrc, uint32_t blockSize, float32_t * pResult) { *pResult = 0.0; }
 
 #include "mock_estimator.h"
@@ -38,6 +39,8 @@ static void mockEventPacketReceivedReportHandling(int dataLength, const packet_t
 static void mockSendLppShortHandling(const packet_t* expectedTxPacket, int datalength);
 
 static bool lpsGetLppShortCallbackForLppShortPacketSent(lpsLppShortPacket_t* shortPacket, int cmock_num_calls);
+static void dwSetTxRxTimeCallbackRecordTime(dwDevice_t* dev, const dwTime_t futureTime, int cmock_num_calls);
+static bool estimatorEnqueueDistanceCallbackRecord(const distanceMeasurement_t* dist, int cmock_num_calls);
 
 static lpsTwrAlgoOptions_t defaultOptions = {
   .tagAddress = 0xbccf000000000008,
@@ -58,7 +61,16 @@ static char * lppShortPacketData = "hello";
 static int lppShortPacketLength = 5;
 static int lppShortPacketDest = 3;
 
+static dwTime_t recordedTxRxTime;
+
+#define MAX_RECORDED_DISTANCES 2
+static distanceMeasurement_t recordedDistances[MAX_RECORDED_DISTANCES];
+static int recordedDistanceCount;
+
 void setUp(void) {
+  armStdResult = 0.0;
+  recordedDistanceCount = 0;
+
   dwGetData_resetMock();
   dwGetTransmitTimestamp_resetMock();
   dwGetReceiveTimestamp_resetMock();
@@ -338,6 +350,138 @@ void testThatWhenARangingHasHappenRangingIsReportedToBeOk() {
 }
 
 
+void testBroadcastPollRoundShouldGenerateDistancesForAllAnsweringAnchors() {
+  // Fixture
+  options.useBroadcastPoll = true;
+  for (int i = 0; i < 2; i++) {
+    options.anchorPosition[i] = (point_t){.timestamp = 1, .x = 1.0f + i, .y = 2.0f + i, .z = 3.0f + i};
+  }
+
+  // Let the distances pass the outlier rejection
+  armStdResult = 10.0;
+  estimatorEnqueueDistance_StubWithCallback(estimatorEnqueueDistanceCallbackRecord);
+
+  const int dataLength = sizeof(packet_t);
+  const uint8_t expectedSeqNr = 1;
+  const float expectedDistance[] = {5.0, 3.0};
+
+  dwIdle_Ignore();
+  dwNewTransmit_Ignore();
+  dwNewReceive_Ignore();
+  dwSetDefaults_Ignore();
+  dwSetData_Ignore();
+  dwSetReceiveWaitTimeout_Ignore();
+  dwWaitForResponse_Ignore();
+  dwStartTransmit_Ignore();
+  dwStartReceive_Ignore();
+  dwSetTxRxTime_StubWithCallback(dwSetTxRxTimeCallbackRecordTime);
+  lpsGetLppShort_IgnoreAndReturn(false);
+
+  dwTime_t pollDepartureTagTime = {.full = 123456};
+  dwTime_t pollArrivalAnchorTime[2];
+  dwTime_t answerDepartureAnchorTime[2];
+  dwTime_t answerArrivalTagTime[2];
+  for (int i = 0; i < 2; i++) {
+    const uint32_t distInTicks = expectedDistance[i] * LOCODECK_TS_FREQ / SPEED_OF_LIGHT;
+    pollArrivalAnchorTime[i].full = pollDepartureTagTime.full + distInTicks + defaultOptions.antennaDelay / 2;
+    answerDepartureAnchorTime[i].full = pollArrivalAnchorTime[i].full + (i + 1) * LPS_TWR_BROADCAST_SLOT_LEN;
+    answerArrivalTagTime[i].full = answerDepartureAnchorTime[i].full + distInTicks + defaultOptions.antennaDelay / 2;
+  }
+
+  // Test
+  uint32_t actualPoll = uwbTwrTagAlgorithm.onEvent(&dev, eventTimeout);
+
+  mockEventPacketSendHandling(&pollDepartureTagTime);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+
+  uint32_t actualAnswer[2];
+  for (int i = 0; i < 2; i++) {
+    packet_t rxPacket;
+    populatePacket(&rxPacket, expectedSeqNr, LPS_TWR_ANSWER, defaultOptions.anchorAddress[i], defaultOptions.tagAddress);
+    dwGetDataLength_ExpectAndReturn(&dev, dataLength);
+    dwGetData_ExpectAndCopyData(&dev, &rxPacket, dataLength);
+    dwGetReceiveTimestamp_ExpectAndCopyData(&dev, &answerArrivalTagTime[i]);
+    actualAnswer[i] = uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+  }
+
+  // No more answers, the final is scheduled
+  uint32_t actualFinal = uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+
+  dwTime_t finalDepartureTagTime = recordedTxRxTime;
+  mockEventPacketSendHandling(&finalDepartureTagTime);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+
+  uint32_t actualReport[2];
+  for (int i = 0; i < 2; i++) {
+    const uint32_t distInTicks = expectedDistance[i] * LOCODECK_TS_FREQ / SPEED_OF_LIGHT;
+    dwTime_t finalArrivalAnchorTime = {.full = finalDepartureTagTime.full + distInTicks + defaultOptions.antennaDelay / 2};
+
+    packet_t rxPacket;
+    populatePacket(&rxPacket, expectedSeqNr, LPS_TWR_REPORT, defaultOptions.anchorAddress[i], defaultOptions.tagAddress);
+    lpsTwrTagReportPayload_t *report = (lpsTwrTagReportPayload_t *)(rxPacket.payload + 2);
+    setTime(report->pollRx, &pollArrivalAnchorTime[i]);
+    setTime(report->answerTx, &answerDepartureAnchorTime[i]);
+    setTime(report->finalRx, &finalArrivalAnchorTime);
+    dwGetDataLength_ExpectAndReturn(&dev, dataLength);
+    dwGetData_ExpectAndCopyData(&dev, &rxPacket, dataLength);
+    actualReport[i] = uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+  }
+
+  const int distancesBeforeEndOfRound = recordedDistanceCount;
+  uint32_t actualEndOfRound = uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualPoll);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualAnswer[0]);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualAnswer[1]);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualFinal);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualReport[0]);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualReport[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, actualEndOfRound);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.01, expectedDistance[0], lpsTwrTagGetDistance(0));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, expectedDistance[1], lpsTwrTagGetDistance(1));
+  TEST_ASSERT_TRUE(uwbTwrTagAlgorithm.isRangingOk());
+
+  // All distances of the round are handed to the estimator when it ends
+  TEST_ASSERT_EQUAL_INT(0, distancesBeforeEndOfRound);
+  TEST_ASSERT_EQUAL_INT(2, recordedDistanceCount);
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01, expectedDistance[i], recordedDistances[i].distance);
+    TEST_ASSERT_EQUAL_FLOAT(options.anchorPosition[i].x, recordedDistances[i].x);
+    TEST_ASSERT_EQUAL_FLOAT(options.anchorPosition[i].y, recordedDistances[i].y);
+    TEST_ASSERT_EQUAL_FLOAT(options.anchorPosition[i].z, recordedDistances[i].z);
+  }
+}
+
+void testBroadcastPollWithoutAnswersShouldEndRoundWithoutFinal() {
+  // Fixture
+  options.useBroadcastPoll = true;
+
+  dwIdle_Ignore();
+  dwNewTransmit_Ignore();
+  dwSetDefaults_Ignore();
+  dwSetData_Ignore();
+  dwSetReceiveWaitTimeout_Ignore();
+  dwWaitForResponse_Ignore();
+  dwStartTransmit_Ignore();
+  lpsGetLppShort_IgnoreAndReturn(false);
+
+  dwTime_t pollDepartureTagTime = {.full = 123456};
+  mockEventPacketSendHandling(&pollDepartureTagTime);
+
+  // Test
+  uwbTwrTagAlgorithm.onEvent(&dev, eventTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+  uint32_t actual = uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+
+  // Assert
+  // dwSetTxRxTime is not expected, no final is scheduled
+  TEST_ASSERT_EQUAL_UINT32(0, actual);
+  TEST_ASSERT_FALSE(uwbTwrTagAlgorithm.isRangingOk());
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 static void setTime(uint8_t* data, const dwTime_t* time) {
@@ -410,3 +554,16 @@ static bool lpsGetLppShortCallbackForLppShortPacketSent(lpsLppShortPacket_t* sho
 
   return true;
 }
+
+static void dwSetTxRxTimeCallbackRecordTime(dwDevice_t* dev, const dwTime_t futureTime, int cmock_num_calls) {
+  recordedTxRxTime = futureTime;
+}
+
+static bool estimatorEnqueueDistanceCallbackRecord(const distanceMeasurement_t* dist, int cmock_num_calls) {
+  TEST_ASSERT_TRUE_MESSAGE(cmock_num_calls < MAX_RECORDED_DISTANCES, "Too many calls to estimatorEnqueueDistance()");
+
+  recordedDistances[cmock_num_calls] = *dist;
+  recordedDistanceCount++;
+
+  return true;
+}
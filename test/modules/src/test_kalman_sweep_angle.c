@@ -0,0 +1,205 @@
+// File under test kalman_sweep_angle.c
+#include "kalman_sweep_angle.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+
+static kalmanCoreData_t coreData;
+static sweepAngleMeasurement_t sweep;
+
+static const float noOffset[3] = {0.0f, 0.0f, 0.0f};
+
+static float capturedH[KC_STATE_DIM];
+static float capturedError;
+static float capturedStdDev;
+static int scalarUpdateCallCount;
+
+static void scalarUpdateCallback(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, int cmock_num_calls);
+static void fixtureSetState(const float x, const float y, const float z);
+static void fixtureSetBaseStationRotation(const float rot[3][3]);
+static void assertHEquals(const float expectedX, const float expectedY, const float expectedZ);
+
+void setUp(void) {
+  memset(&coreData, 0, sizeof(coreData));
+  coreData.R[0][0] = 1.0f;
+  coreData.R[1][1] = 1.0f;
+  coreData.R[2][2] = 1.0f;
+
+  // A base station 2 m above the origin, looking down along the global -z
+  memset(&sweep, 0, sizeof(sweep));
+  sweep.sensorPos = noOffset;
+  sweep.baseStationPos[2] = 2.0f;
+  sweep.baseStationRot[0][0] = 1.0f;
+  sweep.baseStationRot[1][1] = 1.0f;
+  sweep.baseStationRot[2][2] = 1.0f;
+  sweep.stdDev = 0.001f;
+
+  memset(capturedH, 0, sizeof(capturedH));
+  capturedError = 0.0f;
+  capturedStdDev = 0.0f;
+  scalarUpdateCallCount = 0;
+  kalmanCoreScalarUpdate_StubWithCallback(scalarUpdateCallback);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheHorizontalSweepInnovationIsTheMeasuredMinusThePredictedAngle() {
+  // Fixture
+  fixtureSetState(0.5f, 0.3f, 0.0f);
+  sweep.axis = 0;
+  sweep.angle = 0.1f;
+
+  // In the base station frame the sensor is at (0.5, 0.3, -2)
+  float expected = 0.1f - atan2f(-0.5f, 2.0f);
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, scalarUpdateCallCount);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected, capturedError);
+  TEST_ASSERT_EQUAL_FLOAT(0.001f, capturedStdDev);
+}
+
+void testThatTheHorizontalSweepHRowIsTheGradientOfTheAngle() {
+  // Fixture
+  fixtureSetState(0.5f, 0.3f, 0.0f);
+  sweep.axis = 0;
+
+  // d/dx atan2(-x, -z) = z / r2 and d/dz atan2(-x, -z) = -x / r2, r2 = x^2 + z^2
+  float r2 = 0.5f * 0.5f + 2.0f * 2.0f;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  assertHEquals(-2.0f / r2, 0.0f, -0.5f / r2);
+}
+
+void testThatTheVerticalSweepUsesTheBaseStationRotation() {
+  // Fixture
+  fixtureSetState(0.5f, 0.3f, 0.0f);
+  sweep.axis = 1;
+  sweep.angle = 0.0f;
+
+  // Base station yawed 90 degrees, the sensor is at (0.3, -0.5, -2) in the base station frame
+  const float rot[3][3] = {{0.0f, 1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  fixtureSetBaseStationRotation(rot);
+
+  float expectedError = 0.0f - atan2f(-0.5f, 2.0f);
+  float r2 = 0.5f * 0.5f + 2.0f * 2.0f;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedError, capturedError);
+  assertHEquals(-2.0f / r2, 0.0f, -0.5f / r2);
+}
+
+void testThatTheSensorOffsetIsRotatedWithTheAttitude() {
+  // Fixture
+  fixtureSetState(0.4f, 0.3f, 0.0f);
+  sweep.axis = 0;
+  sweep.angle = 0.0f;
+
+  // Yawed 90 degrees, a sensor 0.1 m forward on the deck ends up 0.1 m along the global y
+  const float offset[3] = {0.1f, 0.0f, 0.0f};
+  sweep.sensorPos = offset;
+  memset(coreData.R, 0, sizeof(coreData.R));
+  coreData.R[0][1] = -1.0f;
+  coreData.R[1][0] = 1.0f;
+  coreData.R[2][2] = 1.0f;
+
+  float expectedError = 0.0f - atan2f(-0.4f, 2.0f);
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedError, capturedError);
+}
+
+void testThatTheHRowMatchesANumericalDerivativeOfTheInnovation() {
+  // Fixture
+  const float rot[3][3] = {{0.8f, 0.0f, -0.6f}, {0.0f, 1.0f, 0.0f}, {0.6f, 0.0f, 0.8f}};
+  fixtureSetBaseStationRotation(rot);
+  sweep.axis = 1;
+  const float pos[3] = {-0.7f, 0.4f, 0.2f};
+  const float delta = 1e-3f;
+
+  fixtureSetState(pos[0], pos[1], pos[2]);
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+  float h[3] = {capturedH[KC_STATE_X], capturedH[KC_STATE_Y], capturedH[KC_STATE_Z]};
+  float error = capturedError;
+
+  for (int i = 0; i < 3; i++) {
+    // Test
+    fixtureSetState(pos[0], pos[1], pos[2]);
+    coreData.S[KC_STATE_X + i] += delta;
+    kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+    // Assert
+    // The innovation is measured minus predicted, it moves opposite to the angle
+    float numerical = -(capturedError - error) / delta;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, numerical, h[i]);
+  }
+}
+
+void testThatOnlyThePositionStatesAreInTheHRow() {
+  // Fixture
+  fixtureSetState(0.5f, 0.3f, 0.0f);
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  for (int i = KC_STATE_PX; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, capturedH[i]);
+  }
+}
+
+void testThatNoUpdateIsDoneForASensorBehindTheBaseStation() {
+  // Fixture
+  fixtureSetState(0.5f, 0.3f, 3.0f);
+
+  // Test
+  kalmanCoreUpdateWithSweepAngle(&coreData, &sweep);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, scalarUpdateCallCount);
+}
+
+// Helpers ///////////////////////////////////////////////
+
+static void scalarUpdateCallback(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_PTR(&coreData, this);
+  TEST_ASSERT_EQUAL_UINT16(1, Hm->numRows);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, Hm->numCols);
+
+  memcpy(capturedH, Hm->pData, sizeof(capturedH));
+  capturedError = error;
+  capturedStdDev = stdMeasNoise;
+  scalarUpdateCallCount++;
+}
+
+static void fixtureSetState(const float x, const float y, const float z) {
+  coreData.S[KC_STATE_X] = x;
+  coreData.S[KC_STATE_Y] = y;
+  coreData.S[KC_STATE_Z] = z;
+}
+
+static void fixtureSetBaseStationRotation(const float rot[3][3]) {
+  memcpy(sweep.baseStationRot, rot, sizeof(sweep.baseStationRot));
+}
+
+static void assertHEquals(const float expectedX, const float expectedY, const float expectedZ) {
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedX, capturedH[KC_STATE_X]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedY, capturedH[KC_STATE_Y]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedZ, capturedH[KC_STATE_Z]);
+}
@@ -0,0 +1,310 @@
+// File under test worker.c
+#include "worker.h"
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "timers.h"
+
+#include "freertosMocks.h"
+
+// The worker uses a binary semaphore, a timer and critical sections. The
+// mocking FW can not handle the FreeRTOS headers, we use manual mocks instead.
+// Taking the semaphore when it is not given ends the worker loop, see
+// runWorkerLoop().
+static int semaphoreGiven;
+static jmp_buf workerLoopExit;
+static TimerCallbackFunction_t timerCallback;
+static int handle;
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType) { return (QueueHandle_t)&handle; }
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) { semaphoreGiven = 1; return pdTRUE; }
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait, const BaseType_t xJustPeek) {
+  if (!semaphoreGiven) {
+    longjmp(workerLoopExit, 1);
+  }
+  semaphoreGiven = 0;
+  return pdTRUE;
+}
+TimerHandle_t xTimerCreate(const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction) {
+  timerCallback = pxCallbackFunction;
+  return (TimerHandle_t)&handle;
+}
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer, const BaseType_t xCommandID, const TickType_t xOptionalValue, BaseType_t * const pxHigherPriorityTaskWoken, const TickType_t xTicksToWait) { return pdPASS; }
+void vPortEnterCritical(void) {}
+void vPortExitCritical(void) {}
+uint64_t usecTimestamp(void) { return 0; }
+int consolePutchar(int ch) { return ch; }
+int eprintf(int (*putcf)(int), char * fmt, ...) { return 0; }
+
+// Accounting in the worker, exposed in unit test mode
+extern uint32_t dropCount;
+extern uint32_t coalescedCount;
+extern uint8_t triggerReset;
+
+#define MAX_EXECUTED 40
+
+typedef struct {
+  void (*function)(void*);
+  intptr_t arg;
+} execution_t;
+
+static execution_t executed[MAX_EXECUTED];
+static int executedCount;
+
+static void recordWork(void* arg);
+static void recordOtherWork(void* arg);
+static void runWorkerLoop();
+static int fixtureFillPool();
+static void assertExecuted(const int index, void (*function)(void*), const intptr_t arg);
+
+void setUp(void) {
+  workerInit();
+
+  // Run any work left by a failing test
+  semaphoreGiven = 1;
+  runWorkerLoop();
+
+  executedCount = 0;
+  dropCount = 0;
+  coalescedCount = 0;
+  triggerReset = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatHighPriorityWorkRunsBeforeNormalAndLowPriorityWork() {
+  // Fixture
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityLow);
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityNormal);
+  workerSchedulePriority(recordWork, (void*)3, workerPriorityHigh);
+
+  // Test
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, executedCount);
+  assertExecuted(0, recordWork, 3);
+  assertExecuted(1, recordWork, 2);
+  assertExecuted(2, recordWork, 1);
+}
+
+void testThatWorkWithTheSamePriorityRunsInTheOrderItWasScheduled() {
+  // Fixture
+  workerSchedule(recordWork, (void*)1);
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityLow);
+  workerSchedule(recordWork, (void*)3);
+  workerSchedulePriority(recordWork, (void*)4, workerPriorityLow);
+  workerSchedule(recordWork, (void*)5);
+
+  // Test
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(5, executedCount);
+  assertExecuted(0, recordWork, 1);
+  assertExecuted(1, recordWork, 3);
+  assertExecuted(2, recordWork, 5);
+  assertExecuted(3, recordWork, 2);
+  assertExecuted(4, recordWork, 4);
+}
+
+void testThatPendingWorkWithTheSameFunctionAndArgumentIsCoalesced() {
+  // Fixture
+  workerSchedule(recordWork, (void*)1);
+  workerSchedule(recordWork, (void*)2);
+  workerSchedule(recordOtherWork, (void*)1);
+
+  // Test
+  int actual = workerSchedule(recordWork, (void*)1);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(3, executedCount);
+  assertExecuted(0, recordWork, 1);
+  assertExecuted(1, recordWork, 2);
+  assertExecuted(2, recordOtherWork, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, coalescedCount);
+}
+
+void testThatWorkIsNotCoalescedOnceItHasRun() {
+  // Fixture
+  workerSchedule(recordWork, (void*)1);
+  runWorkerLoop();
+
+  // Test
+  workerSchedule(recordWork, (void*)1);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, executedCount);
+  TEST_ASSERT_EQUAL_UINT32(0, coalescedCount);
+}
+
+void testThatCoalescingWithAHigherPriorityPromotesThePendingWork() {
+  // Fixture
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityLow);
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityNormal);
+
+  // Test
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityHigh);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, executedCount);
+  assertExecuted(0, recordWork, 1);
+  assertExecuted(1, recordWork, 2);
+}
+
+void testThatCoalescingWithALowerPriorityKeepsThePendingPriority() {
+  // Fixture
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityHigh);
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityNormal);
+
+  // Test
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityLow);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, executedCount);
+  assertExecuted(0, recordWork, 1);
+  assertExecuted(1, recordWork, 2);
+}
+
+void testThatWorkIsAppendedCorrectlyAfterTheLastPendingWorkIsPromoted() {
+  // Fixture
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityLow);
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityLow);
+  // Removes the tail of the low priority list
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityHigh);
+
+  // Test
+  workerSchedulePriority(recordWork, (void*)3, workerPriorityLow);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, executedCount);
+  assertExecuted(0, recordWork, 2);
+  assertExecuted(1, recordWork, 1);
+  assertExecuted(2, recordWork, 3);
+}
+
+void testThatWorkIsAppendedCorrectlyAfterTheOnlyPendingWorkIsPromoted() {
+  // Fixture
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityLow);
+  // Empties the low priority list
+  workerSchedulePriority(recordWork, (void*)1, workerPriorityHigh);
+
+  // Test
+  workerSchedulePriority(recordWork, (void*)2, workerPriorityLow);
+  workerSchedulePriority(recordWork, (void*)3, workerPriorityHigh);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, executedCount);
+  assertExecuted(0, recordWork, 1);
+  assertExecuted(1, recordWork, 3);
+  assertExecuted(2, recordWork, 2);
+}
+
+void testThatSchedulingFailsWithENOMEMAndCountsTheDropWhenThePoolIsFull() {
+  // Fixture
+  int scheduled = fixtureFillPool();
+
+  // Test
+  int actual = workerSchedule(recordOtherWork, (void*)1);
+
+  // Assert
+  TEST_ASSERT_TRUE(scheduled > 0);
+  TEST_ASSERT_EQUAL_INT(ENOMEM, actual);
+  TEST_ASSERT_EQUAL_UINT32(1, dropCount);
+}
+
+void testThatThePoolIsAvailableAgainWhenTheWorkHasRun() {
+  // Fixture
+  int scheduled = fixtureFillPool();
+  runWorkerLoop();
+
+  // Test
+  int actual = workerSchedule(recordOtherWork, (void*)1);
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(scheduled + 1, executedCount);
+  assertExecuted(scheduled, recordOtherWork, 1);
+}
+
+void testThatTheAccountingIsResetByTheWorkerLoop() {
+  // Fixture
+  workerSchedule(recordWork, (void*)1);
+  workerSchedule(recordWork, (void*)1);
+  runWorkerLoop();
+  triggerReset = 1;
+
+  // Test
+  timerCallback(NULL);
+  const uint32_t coalescedBeforeWorkerLoop = coalescedCount;
+  runWorkerLoop();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1, coalescedBeforeWorkerLoop);
+  TEST_ASSERT_EQUAL_UINT32(0, coalescedCount);
+  TEST_ASSERT_EQUAL_UINT8(0, triggerReset);
+}
+
+// Helpers ///////////////////////////////////////////////
+
+static void record(void (*function)(void*), void* arg) {
+  if (executedCount < MAX_EXECUTED) {
+    executed[executedCount].function = function;
+    executed[executedCount].arg = (intptr_t)arg;
+  }
+  executedCount++;
+}
+
+static void recordWork(void* arg) {
+  record(recordWork, arg);
+}
+
+static void recordOtherWork(void* arg) {
+  record(recordOtherWork, arg);
+}
+
+// Runs the pending work and returns when the worker loop waits for more
+static void runWorkerLoop() {
+  if (setjmp(workerLoopExit) == 0) {
+    workerLoop();
+  }
+}
+
+// Schedules distinct work until the pool is full, returns the number of work
+// items that were scheduled
+static int fixtureFillPool() {
+  int scheduled = 0;
+  while (scheduled < MAX_EXECUTED) {
+    if (workerSchedule(recordWork, (void*)(intptr_t)scheduled) != 0) {
+      break;
+    }
+    scheduled++;
+  }
+
+  TEST_ASSERT_TRUE(scheduled < MAX_EXECUTED);
+  // The attempt that found the pool full
+  dropCount = 0;
+  return scheduled;
+}
+
+static void assertExecuted(const int index, void (*function)(void*), const intptr_t arg) {
+  TEST_ASSERT_TRUE(index < executedCount);
+  TEST_ASSERT_TRUE(function == executed[index].function);
+  TEST_ASSERT_EQUAL_INT(arg, executed[index].arg);
+}
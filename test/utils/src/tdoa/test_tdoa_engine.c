@@ -0,0 +1,246 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2019 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * TestTdoaEngine.c - Unit tests for pair selection in the tdoa engine
+ */
+
+// File under test
+#include "tdoaEngine.h"
+
+#include "unity.h"
+
+#include <string.h>
+#include "mock_clockCorrectionEngine.h"
+
+
+#define TS_FREQ (499.2e6 * 128)
+
+#define ANCHOR_ID 1
+#define SEQ_NR 7
+#define TOF 1000
+
+#define NOW_MS 5000
+// Remote data is valid for 30 ms after it was stored
+#define STALE_TIME_MS (NOW_MS - 100)
+
+#define MAX_CAPTURED (2 * TDOA_ENGINE_MAX_PAIRS_PER_PACKET)
+
+
+static tdoaEngineState_t engineState;
+
+static tdoaMeasurement_t capturedMeasurements[MAX_CAPTURED];
+static int capturedCount;
+static int sendCallCount;
+
+static void captureMeasurements(tdoaMeasurement_t tdoaMeasurements[], const int count);
+static void fixtureAddAnchor(const uint8_t id, const uint32_t time_ms, const uint8_t seqNr);
+static void fixtureAddRemoteAnchor(const uint8_t remoteId, const uint32_t time_ms, const uint8_t remoteSeqNr, const uint8_t seqNrInAnchor);
+static void fixtureProcessPacket(const uint8_t maxPairs);
+static bool isRemoteAnchorInMeasurements(const uint8_t remoteId);
+
+void setUp(void) {
+  tdoaEngineInit(&engineState, 0, captureMeasurements, TS_FREQ);
+
+  memset(capturedMeasurements, 0, sizeof(capturedMeasurements));
+  capturedCount = 0;
+  sendCallCount = 0;
+
+  clockCorrectionEngineCalculate_IgnoreAndReturn(1.0);
+  clockCorrectionEngineUpdate_IgnoreAndReturn(true);
+  clockCorrectionEngineGet_IgnoreAndReturn(1.0);
+
+  fixtureAddAnchor(ANCHOR_ID, NOW_MS, SEQ_NR);
+}
+
+void testThatOnePairIsUsedByDefault() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+  fixtureAddRemoteAnchor(3, NOW_MS, 11, 11);
+  fixtureAddRemoteAnchor(4, NOW_MS, 12, 12);
+
+  // Test
+  fixtureProcessPacket(engineState.maxPairsPerPacket);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sendCallCount);
+  TEST_ASSERT_EQUAL_INT(1, capturedCount);
+  TEST_ASSERT_EQUAL_UINT32(1, engineState.stats.pairsFound);
+}
+
+void testThatAllValidPairsAreSentInOneBatch() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+  fixtureAddRemoteAnchor(3, NOW_MS, 11, 11);
+  fixtureAddRemoteAnchor(4, NOW_MS, 12, 12);
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sendCallCount);
+  TEST_ASSERT_EQUAL_INT(3, capturedCount);
+  TEST_ASSERT_EQUAL_UINT32(3, engineState.stats.pairsFound);
+  TEST_ASSERT_EQUAL_UINT32(3, engineState.stats.packetsToEstimator);
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(2));
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(3));
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(4));
+}
+
+void testThatTheNumberOfPairsIsCappedByMaxPairs() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+  fixtureAddRemoteAnchor(3, NOW_MS, 11, 11);
+  fixtureAddRemoteAnchor(4, NOW_MS, 12, 12);
+  fixtureAddRemoteAnchor(5, NOW_MS, 13, 13);
+
+  // Test
+  fixtureProcessPacket(2);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sendCallCount);
+  TEST_ASSERT_EQUAL_INT(2, capturedCount);
+  TEST_ASSERT_EQUAL_UINT32(2, engineState.stats.pairsFound);
+}
+
+void testThatMaxPairsAboveTheBuildLimitIsCappedToTheBuildLimit() {
+  // Fixture
+  for (int i = 0; i < TDOA_ENGINE_MAX_PAIRS_PER_PACKET + 2; i++) {
+    fixtureAddRemoteAnchor(2 + i, NOW_MS, 10 + i, 10 + i);
+  }
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET + 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(TDOA_ENGINE_MAX_PAIRS_PER_PACKET, capturedCount);
+}
+
+void testThatRemoteAnchorsWithOldSequenceNumbersAreSkipped() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+  // The last packet received from anchor 3 is not the one anchor 1 refers to
+  fixtureAddRemoteAnchor(3, NOW_MS, 11, 12);
+  fixtureAddRemoteAnchor(4, NOW_MS, 12, 12);
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, capturedCount);
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(2));
+  TEST_ASSERT_FALSE(isRemoteAnchorInMeasurements(3));
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(4));
+}
+
+void testThatExpiredRemoteAnchorDataIsSkipped() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+  fixtureAddRemoteAnchor(3, STALE_TIME_MS, 11, 11);
+  fixtureAddRemoteAnchor(4, NOW_MS, 12, 12);
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, capturedCount);
+  TEST_ASSERT_FALSE(isRemoteAnchorInMeasurements(3));
+}
+
+void testThatRemoteAnchorsNotInStorageAreSkippedAndNotCreated() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 10);
+
+  tdoaAnchorContext_t anchorCtx;
+  tdoaStorageGetCreateAnchorCtx(engineState.anchorInfoArray, ANCHOR_ID, NOW_MS, &anchorCtx);
+  tdoaStorageSetRemoteRxTime(&anchorCtx, 3, 123456, 11);
+  tdoaStorageSetTimeOfFlight(&anchorCtx, 3, TOF);
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, capturedCount);
+  TEST_ASSERT_TRUE(isRemoteAnchorInMeasurements(2));
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(engineState.anchorInfoArray, 3));
+}
+
+void testThatNothingIsSentWhenNoPairIsValid() {
+  // Fixture
+  fixtureAddRemoteAnchor(2, NOW_MS, 10, 11);
+  fixtureAddRemoteAnchor(3, STALE_TIME_MS, 11, 11);
+
+  // Test
+  fixtureProcessPacket(TDOA_ENGINE_MAX_PAIRS_PER_PACKET);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, sendCallCount);
+  TEST_ASSERT_EQUAL_UINT32(0, engineState.stats.suitableDataFound);
+}
+
+// Helpers ///////////////////////////////////////////////
+
+static void captureMeasurements(tdoaMeasurement_t tdoaMeasurements[], const int count) {
+  sendCallCount++;
+  for (int i = 0; i < count && capturedCount < MAX_CAPTURED; i++) {
+    capturedMeasurements[capturedCount] = tdoaMeasurements[i];
+    capturedCount++;
+  }
+}
+
+// The anchor position encodes the id, x = id
+static void fixtureAddAnchor(const uint8_t id, const uint32_t time_ms, const uint8_t seqNr) {
+  tdoaAnchorContext_t anchorCtx;
+  tdoaStorageGetCreateAnchorCtx(engineState.anchorInfoArray, id, time_ms, &anchorCtx);
+  tdoaStorageSetRxTxData(&anchorCtx, 100000 * id, 200000 * id, seqNr);
+  tdoaStorageSetAnchorPosition(&anchorCtx, id, 0.0f, 0.0f);
+}
+
+// Adds a remote anchor to the storage with seqNr as the sequence number of
+// the last packet received from it, and data in the anchor under test that
+// refers to its packet with sequence number seqNrInAnchor
+static void fixtureAddRemoteAnchor(const uint8_t remoteId, const uint32_t time_ms, const uint8_t seqNr, const uint8_t seqNrInAnchor) {
+  fixtureAddAnchor(remoteId, NOW_MS, seqNr);
+
+  tdoaAnchorContext_t anchorCtx;
+  tdoaStorageGetCreateAnchorCtx(engineState.anchorInfoArray, ANCHOR_ID, time_ms, &anchorCtx);
+  tdoaStorageSetRemoteRxTime(&anchorCtx, remoteId, 123456, seqNrInAnchor);
+  tdoaStorageSetTimeOfFlight(&anchorCtx, remoteId, TOF);
+}
+
+static void fixtureProcessPacket(const uint8_t maxPairs) {
+  engineState.maxPairsPerPacket = maxPairs;
+
+  tdoaAnchorContext_t anchorCtx;
+  tdoaEngineGetAnchorCtxForPacketProcessing(&engineState, ANCHOR_ID, NOW_MS, &anchorCtx);
+  tdoaEngineProcessPacket(&engineState, &anchorCtx, 300000, 400000);
+}
+
+static bool isRemoteAnchorInMeasurements(const uint8_t remoteId) {
+  for (int i = 0; i < capturedCount; i++) {
+    if (capturedMeasurements[i].anchorPosition[0].x == (float)remoteId) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -37,6 +37,8 @@
 #define REMOTE_DATA_VALIDITY_PERIOD 30
 #define ANCHOR_POSITION_VALIDITY_PERIOD (2 * 1000)
 
+#define REPEATED_LOOKUP_COUNT 10000
+
 
 static tdaoAnchorInfoArray_t storage;
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr);
@@ -647,6 +649,155 @@ void testThatTofReplacesTheOldestEntryWhenStorageIsFull() {
 }
 
 
+void testThatAnchorsWithCollidingIdsAreAllFound() {
+  // Fixture
+  // All ids end up in the same bucket of the index
+  const uint8_t firstId = 3;
+  const uint32_t currentTime = 1234;
+  const int count = ANCHOR_STORAGE_COUNT < (256 / ANCHOR_STORAGE_COUNT) ? ANCHOR_STORAGE_COUNT : (256 / ANCHOR_STORAGE_COUNT);
+
+  tdoaAnchorContext_t context;
+  for (int i = 0; i < count; i++) {
+    const uint8_t id = firstId + i * ANCHOR_STORAGE_COUNT;
+    tdoaStorageGetCreateAnchorCtx(storage, id, currentTime, &context);
+    tdoaStorageSetRxTxData(&context, 0, 0, i);
+  }
+
+  // Test
+  // Assert
+  for (int i = 0; i < count; i++) {
+    const uint8_t id = firstId + i * ANCHOR_STORAGE_COUNT;
+    TEST_ASSERT_TRUE(tdoaStorageGetAnchorCtx(storage, id, currentTime, &context));
+    TEST_ASSERT_EQUAL_UINT8(id, tdoaStorageGetId(&context));
+    TEST_ASSERT_EQUAL_UINT8(i, tdoaStorageGetSeqNr(&context));
+  }
+}
+
+
+void testThatTheMostRecentAnchorsAreKeptWhenCyclingThroughAllIds() {
+  // Fixture
+  const int rounds = 3;
+  uint32_t currentTime = 1000;
+
+  tdoaAnchorContext_t context;
+  uint8_t anchorList[ANCHOR_STORAGE_COUNT + 1];
+
+  // Test
+  for (int i = 0; i < rounds * 256; i++) {
+    const uint8_t id = (i * 37) & 0xff;
+    currentTime++;
+    tdoaStorageGetCreateAnchorCtx(storage, id, currentTime, &context);
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+
+    // Assert
+    for (int back = 0; back < ANCHOR_STORAGE_COUNT && back <= i; back++) {
+      const uint8_t recentId = ((i - back) * 37) & 0xff;
+      TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(storage, recentId));
+    }
+
+    if (i >= ANCHOR_STORAGE_COUNT) {
+      const uint8_t evictedId = ((i - ANCHOR_STORAGE_COUNT) * 37) & 0xff;
+      TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(storage, evictedId));
+    }
+  }
+
+  const uint8_t actualCount = tdoaStorageGetListOfAnchorIds(storage, anchorList, ANCHOR_STORAGE_COUNT + 1);
+  TEST_ASSERT_EQUAL_UINT8(ANCHOR_STORAGE_COUNT, actualCount);
+  for (int i = 0; i < actualCount; i++) {
+    TEST_ASSERT_TRUE(tdoaStorageGetAnchorCtx(storage, anchorList[i], currentTime, &context));
+    for (int j = i + 1; j < actualCount; j++) {
+      TEST_ASSERT_TRUE(anchorList[i] != anchorList[j]);
+    }
+  }
+}
+
+
+void testThatTheMostRecentRemoteRxTimesAreKeptWhenCyclingThroughAllIds() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  const uint8_t anchor = 17;
+  uint32_t currentTime = 1000;
+
+  // Test
+  for (int i = 0; i < 2 * 256; i++) {
+    const uint8_t remoteAnchor = (i * 11) & 0xff;
+    currentTime++;
+    fixtureSetRemoteRxTime(&context, anchor, currentTime, remoteAnchor, i + 1, 0);
+  }
+
+  // Assert
+  // Remote data is only valid for a short time
+  const int expectedCount = REMOTE_ANCHOR_DATA_COUNT < REMOTE_DATA_VALIDITY_PERIOD ? REMOTE_ANCHOR_DATA_COUNT : REMOTE_DATA_VALIDITY_PERIOD;
+  for (int back = 0; back < expectedCount; back++) {
+    const int i = 2 * 256 - 1 - back;
+    const uint8_t remoteAnchor = (i * 11) & 0xff;
+    TEST_ASSERT_EQUAL_INT64(i + 1, tdoaStorageGetRemoteRxTime(&context, remoteAnchor));
+  }
+
+  int actualRemoteCount;
+  uint8_t actualSequenceNumbers[REMOTE_ANCHOR_DATA_COUNT];
+  uint8_t actualIds[REMOTE_ANCHOR_DATA_COUNT];
+  tdoaStorageGetRemoteSeqNrList(&context, &actualRemoteCount, actualSequenceNumbers, actualIds);
+  TEST_ASSERT_EQUAL_INT32(expectedCount, actualRemoteCount);
+}
+
+
+void testThatTheMostRecentTofsAreKeptWhenCyclingThroughAllIds() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  const uint8_t anchor = 17;
+  uint32_t currentTime = 1000;
+
+  // Test
+  for (int i = 0; i < 2 * 256; i++) {
+    const uint8_t remoteAnchor = (i * 13) & 0xff;
+    currentTime++;
+    fixtureSetTof(&context, anchor, currentTime, remoteAnchor, i + 1);
+  }
+
+  // Assert
+  for (int back = 0; back < TOF_PER_ANCHOR_COUNT; back++) {
+    const int i = 2 * 256 - 1 - back;
+    const uint8_t remoteAnchor = (i * 13) & 0xff;
+    TEST_ASSERT_EQUAL_INT64(i + 1, tdoaStorageGetTimeOfFlight(&context, remoteAnchor));
+  }
+
+  const uint8_t evictedRemoteAnchor = ((2 * 256 - 1 - TOF_PER_ANCHOR_COUNT) * 13) & 0xff;
+  TEST_ASSERT_EQUAL_INT64(0, tdoaStorageGetTimeOfFlight(&context, evictedRemoteAnchor));
+}
+
+
+// Correctness test only, the lookup cost is not measured. Every anchor
+// context, remote data and ToF entry of a full storage is looked up many
+// times in a row and the sum of the returned data is checked.
+void testThatRepeatedLookupsReturnTheStoredDataWithAFullStorage() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  const uint32_t currentTime = 1234;
+
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    fixtureSetTof(&context, id, currentTime, id + 1, id + 1);
+    tdoaStorageSetRemoteRxTime(&context, id + 1, id + 1, 0);
+  }
+
+  // Test
+  int64_t sum = 0;
+  for (int i = 0; i < REPEATED_LOOKUP_COUNT; i++) {
+    const uint8_t id = i % ANCHOR_STORAGE_COUNT;
+    tdoaStorageGetCreateAnchorCtx(storage, id, currentTime, &context);
+    sum += tdoaStorageGetTimeOfFlight(&context, id + 1);
+    sum += tdoaStorageGetRemoteRxTime(&context, id + 1);
+  }
+
+  // Assert
+  int64_t expectedSum = 0;
+  for (int i = 0; i < REPEATED_LOOKUP_COUNT; i++) {
+    expectedSum += 2 * (i % ANCHOR_STORAGE_COUNT + 1);
+  }
+  TEST_ASSERT_EQUAL_INT64(expectedSum, sum);
+}
+
+
 // Helpers ///////////////
 
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr) {
@@ -3,6 +3,8 @@
 
 #include "unity.h"
 
+#include <math.h>
+
 #define MAX_CLOCK_DEVIATION_SPEC 10e-6
 #define CLOCK_CORRECTION_SPEC_MAX (1.0 + MAX_CLOCK_DEVIATION_SPEC * 2)
 
@@ -200,3 +202,138 @@ void testUpdateClockCorrectionWithSampleInTheInnerLimitOfTheAcceptableNoise() {
   TEST_ASSERT_EQUAL_DOUBLE(expectedClockCorrection, clockCorrectionStorage.clockCorrection);
   TEST_ASSERT_EQUAL_UINT(expectedClockCorrectionBucket, clockCorrectionStorage.clockCorrectionBucket);
 }
+
+void testCalculateClockCorrectionFixedMatchesDoubleReference() {
+  // Fixture
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+  const double clockCorrections[] = {1.0, 1.0057, 1.0 + 10e-6, 1.0 - 10e-6, 0.99999999, 3.5};
+  const uint64_t differences_in_cl_x[] = {10000, 12345678, 998877665544};
+
+  for (int i = 0; i < (int)(sizeof(clockCorrections) / sizeof(clockCorrections[0])); i++) {
+    for (int j = 0; j < (int)(sizeof(differences_in_cl_x) / sizeof(differences_in_cl_x[0])); j++) {
+      const uint64_t old_t_in_cl_x = 1000;
+      const uint64_t new_t_in_cl_x = old_t_in_cl_x + differences_in_cl_x[j];
+      const uint64_t old_t_in_cl_reference = 56789;
+      const uint64_t new_t_in_cl_reference = (old_t_in_cl_reference + (uint64_t)(clockCorrections[i] * differences_in_cl_x[j])) & mask;
+
+      // Test
+      const double reference = clockCorrectionEngineCalculate(new_t_in_cl_reference, old_t_in_cl_reference, new_t_in_cl_x, old_t_in_cl_x, mask);
+      const clockCorrectionFixed_t result = clockCorrectionEngineCalculateFixed(new_t_in_cl_reference, old_t_in_cl_reference, new_t_in_cl_x, old_t_in_cl_x, mask);
+
+      // Assert
+      // Within the resolution of the double reference
+      TEST_ASSERT_DOUBLE_WITHIN(reference * 4e-16, reference, (double)result / CLOCK_CORRECTION_FIXED_ONE);
+    }
+  }
+}
+
+void testCalculateClockCorrectionFixedWithValidInputDataWithWrapAround() {
+  // Fixture
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+  const uint64_t difference_in_cl_x = 10000;
+  const uint64_t difference_in_cl_reference = 10057;
+
+  const uint64_t old_t_in_cl_x = mask - difference_in_cl_x / 2;
+  const uint64_t new_t_in_cl_x = (old_t_in_cl_x + difference_in_cl_x) & mask; // Wraps around
+  const uint64_t old_t_in_cl_reference = 56789;
+  const uint64_t new_t_in_cl_reference = old_t_in_cl_reference + difference_in_cl_reference;
+
+  // Test
+  const clockCorrectionFixed_t result = clockCorrectionEngineCalculateFixed(new_t_in_cl_reference, old_t_in_cl_reference, new_t_in_cl_x, old_t_in_cl_x, mask);
+
+  // Assert
+  const clockCorrectionFixed_t expected = clockCorrectionEngineRatioFixed(difference_in_cl_reference, difference_in_cl_x);
+  TEST_ASSERT_EQUAL_INT64(expected, result);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-15, 1.0057, (double)result / CLOCK_CORRECTION_FIXED_ONE);
+}
+
+void testCalculateClockCorrectionFixedWithInvalidInputData() {
+  // Fixture
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+
+  // Test
+  const clockCorrectionFixed_t result = clockCorrectionEngineCalculateFixed(56789, 56789, 1000, 1000, mask);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(-CLOCK_CORRECTION_FIXED_ONE, result);
+}
+
+void testRatioFixedIsRoundedToNearest() {
+  // Fixture
+  // 1/3 = 0.0101... in binary, the bit after the 60 fraction bits is 0
+  // 2/3 = 0.1010... in binary, the bit after the 60 fraction bits is 1
+  const clockCorrectionFixed_t truncatedThird = (CLOCK_CORRECTION_FIXED_ONE - 1) / 3;
+
+  // Test
+  const clockCorrectionFixed_t third = clockCorrectionEngineRatioFixed(1, 3);
+  const clockCorrectionFixed_t twoThirds = clockCorrectionEngineRatioFixed(2, 3);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(truncatedThird, third);
+  TEST_ASSERT_EQUAL_INT64(2 * truncatedThird + 1, twoThirds);
+}
+
+void testApplyClockCorrectionFixedMatchesDoubleReference() {
+  // Fixture
+  const clockCorrectionFixed_t clockCorrections[] = {
+    CLOCK_CORRECTION_FIXED_ONE,
+    clockCorrectionEngineRatioFixed(100001, 100000),
+    clockCorrectionEngineRatioFixed(99999, 100000),
+    clockCorrectionEngineRatioFixed(1000000000123, 1000000000000),
+  };
+  const int64_t ticks[] = {0, 1, -1, 12345, -12345, 63897600000, -63897600000, 0xFFFFFFFFFF, -0xFFFFFFFFFF};
+
+  for (int i = 0; i < (int)(sizeof(clockCorrections) / sizeof(clockCorrections[0])); i++) {
+    for (int j = 0; j < (int)(sizeof(ticks) / sizeof(ticks[0])); j++) {
+      // Test
+      const int64_t result = clockCorrectionEngineApplyFixed(ticks[j], clockCorrections[i]);
+
+      // Assert
+      const double reference = ticks[j] * ((double)clockCorrections[i] / CLOCK_CORRECTION_FIXED_ONE);
+      TEST_ASSERT_INT64_WITHIN(1, llround(reference), result);
+    }
+  }
+}
+
+void testApplyClockCorrectionFixedIsExactForExactInput() {
+  // Fixture
+  const clockCorrectionFixed_t oneAndAHalf = CLOCK_CORRECTION_FIXED_ONE + CLOCK_CORRECTION_FIXED_ONE / 2;
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(1000, clockCorrectionEngineApplyFixed(1000, CLOCK_CORRECTION_FIXED_ONE));
+  TEST_ASSERT_EQUAL_INT64(-1500, clockCorrectionEngineApplyFixed(-1000, oneAndAHalf));
+  TEST_ASSERT_EQUAL_INT64(2, clockCorrectionEngineApplyFixed(1, oneAndAHalf)); // 1.5 rounds up
+  TEST_ASSERT_EQUAL_INT64(-1500, clockCorrectionEngineApplyFixed(1000, -oneAndAHalf));
+}
+
+void testUpdateClockCorrectionFixedFollowsDoubleReference() {
+  // Fixture
+  clockCorrectionStorage_t reference = {.clockCorrection = 0, .clockCorrectionBucket = 0};
+  clockCorrectionFixedStorage_t storage = {.clockCorrection = 0, .clockCorrectionBucket = 0};
+  const double trueClockCorrection = 1.0 + 5e-6;
+  uint32_t seed = 12345;
+
+  for (int i = 0; i < 1000; i++) {
+    // Noise within +-0.01e-6, with an outlier now and then
+    seed = seed * 1103515245 + 12345;
+    double noise = (((seed >> 8) & 0xffff) / 65535.0 - 0.5) * 0.02e-6;
+    if ((i % 37) == 0) {
+      noise += 2e-6;
+    }
+    const uint64_t tickCount_in_cl_x = 1000000000;
+    const uint64_t tickCount_in_cl_reference = llround(tickCount_in_cl_x * (trueClockCorrection + noise));
+
+    const double candidate = (double)tickCount_in_cl_reference / (double)tickCount_in_cl_x;
+    const clockCorrectionFixed_t candidateFixed = clockCorrectionEngineRatioFixed(tickCount_in_cl_reference, tickCount_in_cl_x);
+
+    // Test
+    const bool referenceIsReliable = clockCorrectionEngineUpdate(&reference, candidate);
+    const bool isReliable = clockCorrectionEngineUpdateFixed(&storage, candidateFixed);
+
+    // Assert
+    TEST_ASSERT_EQUAL(referenceIsReliable, isReliable);
+    TEST_ASSERT_EQUAL_UINT(reference.clockCorrectionBucket, storage.clockCorrectionBucket);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-15, reference.clockCorrection, (double)storage.clockCorrection / CLOCK_CORRECTION_FIXED_ONE);
+  }
+}
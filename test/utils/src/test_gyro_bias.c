@@ -0,0 +1,141 @@
+// File under test
+#include "gyro_bias.h"
+
+#include "unity.h"
+
+#define WINDOW 256
+#define VARIANCE_THRESHOLD 20.0f
+#define TRACKING_VARIANCE_THRESHOLD 10000.0f
+#define TRACKING_MAX_OFFSET 8.0f
+#define TRACKING_GAIN 0.5f
+
+static gyroBias_t gb;
+
+static void addSamples(int count, int16_t x, int16_t y, int16_t z, int16_t amplitude);
+
+void setUp(void) {
+  gyroBiasInit(&gb, WINDOW, VARIANCE_THRESHOLD, TRACKING_VARIANCE_THRESHOLD, TRACKING_MAX_OFFSET, TRACKING_GAIN);
+}
+
+void tearDown(void) {
+}
+
+void testThatBiasIsNotFoundBeforeFirstWindowIsFull() {
+  // Fixture
+
+  // Test
+  addSamples(WINDOW - 1, 10, -20, 30, 1);
+
+  // Assert
+  TEST_ASSERT_FALSE(gb.isBiasValueFound);
+}
+
+void testThatBiasIsFoundAfterOneStationaryWindow() {
+  // Fixture
+
+  // Test
+  addSamples(WINDOW, 10, -20, 30, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(gb.isBiasValueFound);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, gb.bias.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -20.0f, gb.bias.y);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, gb.bias.z);
+}
+
+void testThatAddReturnsTrueWhenBiasIsFound() {
+  // Fixture
+  addSamples(WINDOW - 1, 10, -20, 30, 1);
+
+  // Test
+  bool actual = gyroBiasAdd(&gb, 10, -20, 30);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatBiasIsNotFoundWhenMoving() {
+  // Fixture
+
+  // Test
+  addSamples(WINDOW, 10, -20, 30, 100);
+
+  // Assert
+  TEST_ASSERT_FALSE(gb.isBiasValueFound);
+}
+
+void testThatBiasIsFoundInFirstStationaryWindowAfterMoving() {
+  // Fixture
+  addSamples(WINDOW, 10, -20, 30, 100);
+
+  // Test
+  addSamples(WINDOW, 11, -21, 31, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(gb.isBiasValueFound);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 11.0f, gb.bias.x);
+}
+
+void testThatVarianceIsCalculatedPerSample() {
+  // Fixture
+
+  // Test
+  addSamples(WINDOW, 0, 0, 0, 2);
+
+  // Assert
+  // Alternating +-2 gives a variance of 4
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 4.0f, gb.variance.x);
+}
+
+void testThatBiasTracksSlowDrift() {
+  // Fixture
+  addSamples(WINDOW, 10, -20, 30, 1);
+
+  // Test
+  addSamples(WINDOW, 14, -20, 30, 1);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 12.0f, gb.bias.x);
+}
+
+void testThatBiasTracksInNoisyHover() {
+  // Fixture
+  addSamples(WINDOW, 10, -20, 30, 1);
+
+  // Test
+  addSamples(WINDOW, 14, -20, 30, 50);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 12.0f, gb.bias.x);
+}
+
+void testThatBiasIsNotTrackedWhenRotating() {
+  // Fixture
+  addSamples(WINDOW, 10, -20, 30, 1);
+
+  // Test
+  addSamples(WINDOW, 10 + TRACKING_MAX_OFFSET + 10, -20, 30, 1);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, gb.bias.x);
+}
+
+void testThatBiasIsNotTrackedWhenVarianceIsTooHigh() {
+  // Fixture
+  addSamples(WINDOW, 10, -20, 30, 1);
+
+  // Test
+  addSamples(WINDOW, 14, -20, 30, 200);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, gb.bias.x);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void addSamples(int count, int16_t x, int16_t y, int16_t z, int16_t amplitude) {
+  for (int i = 0; i < count; i++) {
+    int16_t noise = (i % 2) ? amplitude : -amplitude;
+    gyroBiasAdd(&gb, x + noise, y - noise, z + noise);
+  }
+}
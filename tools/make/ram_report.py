@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+#
+# Print the RAM used by each module (object file) from the linker map file,
+# largest first. With STATIC_MEM the task stacks are included in the module
+# that creates the task, the rest of the dynamic allocations are in the
+# FreeRTOS heap (heap_4.o).
+#
+# Usage: ram_report.py cf2.map [number of modules to list]
+
+from __future__ import print_function
+
+import os
+import re
+import sys
+
+RAM_OUTPUT_SECTIONS = ('.data', '.bss', '.nzds')
+
+input_re = re.compile(r'^ (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S+)')
+memory_re = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+
+
+def module_name(path):
+    # bin/log.o or /path/libarm_math.a(arm_sin_f32.o)
+    match = re.match(r'(.*\.a)\((.*)\)', path)
+    if match:
+        return os.path.basename(match.group(1)) + '(' + match.group(2) + ')'
+    return os.path.basename(path)
+
+
+def parse(map_file):
+    ram_size = None
+    modules = {}
+    output_section = None
+    wrapped_section = None
+    in_memory_config = False
+    in_memory_map = False
+
+    for line in open(map_file):
+        line = line.rstrip('\n')
+
+        if line.startswith('Memory Configuration'):
+            in_memory_config = True
+            continue
+        if line.startswith('Linker script and memory map'):
+            in_memory_config = False
+            in_memory_map = True
+            continue
+
+        if in_memory_config:
+            match = memory_re.match(line)
+            if match and match.group(1) == 'RAM':
+                ram_size = int(match.group(3), 16)
+            continue
+
+        if not in_memory_map or not line:
+            continue
+
+        if not line.startswith(' '):
+            name = line.split()[0]
+            output_section = name if name in RAM_OUTPUT_SECTIONS else None
+            continue
+
+        if output_section is None:
+            continue
+
+        # Long input section names are wrapped to the next line
+        if re.match(r'^ \S+$', line):
+            wrapped_section = line.strip()
+            continue
+
+        match = input_re.match(line)
+        if not match:
+            wrapped_section = None
+            continue
+
+        section = match.group(1) or wrapped_section
+        wrapped_section = None
+        size = int(match.group(3), 16)
+        if size == 0 or section is None or section == '*fill*':
+            continue
+
+        module = modules.setdefault(module_name(match.group(4)), {'data': 0, 'bss': 0})
+        if output_section == '.data':
+            module['data'] += size
+        else:
+            module['bss'] += size
+
+    return ram_size, modules
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('Usage: %s <map file> [number of modules]' % sys.argv[0])
+        sys.exit(1)
+
+    ram_size, modules = parse(sys.argv[1])
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else len(modules)
+
+    rows = sorted(modules.items(), key=lambda item: item[1]['data'] + item[1]['bss'], reverse=True)
+    total_data = sum(module['data'] for module in modules.values())
+    total_bss = sum(module['bss'] for module in modules.values())
+
+    print('RAM usage per module (bytes)')
+    print('%-32s %8s %8s %8s' % ('Module', 'data', 'bss', 'total'))
+    for name, module in rows[:count]:
+        print('%-32s %8d %8d %8d' % (name, module['data'], module['bss'], module['data'] + module['bss']))
+    if count < len(rows):
+        rest = rows[count:]
+        rest_data = sum(module['data'] for _, module in rest)
+        rest_bss = sum(module['bss'] for _, module in rest)
+        print('%-32s %8d %8d %8d' % ('(%d more)' % len(rest), rest_data, rest_bss, rest_data + rest_bss))
+    print('%-32s %8d %8d %8d' % ('Total', total_data, total_bss, total_data + total_bss))
+    if ram_size:
+        print('%-32s %26d' % ('Not in data or bss', ram_size - total_data - total_bss))
+
+
+if __name__ == '__main__':
+    main()
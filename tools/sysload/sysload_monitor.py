@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+# Live per-task CPU load and stack headroom of a Crazyflie, from the sysload
+# log group. Enables the system.loadLog parameter, reads the task names from a
+# task dump on the console and prints a table every second.
+#
+# Usage: sysload_monitor.py [uri]
+
+import re
+import sys
+import time
+
+import cflib.crtp
+from cflib.crazyflie import Crazyflie
+from cflib.crazyflie.log import LogConfig
+from cflib.crazyflie.syncCrazyflie import SyncCrazyflie
+
+SLOT_COUNT = 32
+SLOTS_PER_BLOCK = 6  # 6 x uint32 fits in one log packet
+PERIOD_MS = 1000
+
+uri = sys.argv[1] if len(sys.argv) > 1 else 'radio://0/80/2M/E7E7E7E7E7'
+
+task_names = {}
+slots = [0] * SLOT_COUNT
+summary = {}
+console_line = ''
+
+# Task dump line: load, stack left, task number, name
+DUMP_LINE = re.compile(r'^SYSLOAD: [\d.]+ \t\d+ \t(\d+) \t(.+)$')
+
+
+def console_cb(text):
+    global console_line
+    console_line += text
+    while '\n' in console_line:
+        line, console_line = console_line.split('\n', 1)
+        match = DUMP_LINE.match(line)
+        if match:
+            task_names[int(match.group(1))] = match.group(2)
+
+
+def slots_cb(first):
+    def cb(timestamp, data, logconf):
+        for i in range(SLOTS_PER_BLOCK):
+            name = 'sysload.t{:02d}'.format(first + i)
+            if name in data:
+                slots[first + i] = data[name]
+    return cb
+
+
+def summary_cb(timestamp, data, logconf):
+    summary.update(data)
+
+
+def print_table():
+    print('\033[2J\033[H', end='')
+    print('CPU {:5.1f} %   tasks {}   not monitored {}'.format(
+        summary.get('sysload.cpu', 0) / 10.0,
+        summary.get('sysload.tasks', 0),
+        summary.get('sysload.lost', 0)))
+    print('{:>4} {:<12} {:>7} {:>12}'.format('Nbr', 'Name', 'Load %', 'Stack words'))
+    rows = []
+    for slot in slots:
+        if slot == 0:
+            continue
+        number = slot >> 24
+        load = (slot >> 12) & 0xfff
+        stack = slot & 0xfff
+        rows.append((load, number, stack))
+    for load, number, stack in sorted(rows, reverse=True):
+        print('{:>4} {:<12} {:>7.1f} {:>12}'.format(
+            number, task_names.get(number, '?'), load / 10.0, stack))
+
+
+cflib.crtp.init_drivers(enable_debug_driver=False)
+
+with SyncCrazyflie(uri, cf=Crazyflie(rw_cache='./cache')) as scf:
+    cf = scf.cf
+    cf.console.receivedChar.add_callback(console_cb)
+
+    cf.param.set_value('system.loadLog', '1')
+    cf.param.set_value('system.taskDump', '1')
+
+    configs = []
+    summary_conf = LogConfig(name='sysload', period_in_ms=PERIOD_MS)
+    summary_conf.add_variable('sysload.cpu', 'uint16_t')
+    summary_conf.add_variable('sysload.tasks', 'uint8_t')
+    summary_conf.add_variable('sysload.lost', 'uint8_t')
+    summary_conf.data_received_cb.add_callback(summary_cb)
+    configs.append(summary_conf)
+
+    for first in range(0, SLOT_COUNT, SLOTS_PER_BLOCK):
+        conf = LogConfig(name='sysload{}'.format(first), period_in_ms=PERIOD_MS)
+        for i in range(first, min(first + SLOTS_PER_BLOCK, SLOT_COUNT)):
+            conf.add_variable('sysload.t{:02d}'.format(i), 'uint32_t')
+        conf.data_received_cb.add_callback(slots_cb(first))
+        configs.append(conf)
+
+    for conf in configs:
+        cf.log.add_config(conf)
+        conf.start()
+
+    try:
+        while True:
+            time.sleep(PERIOD_MS / 1000.0)
+            print_table()
+    except KeyboardInterrupt:
+        pass
+
+    for conf in configs:
+        conf.stop()
+    cf.param.set_value('system.loadLog', '0')
@@ -0,0 +1,717 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie firmware.
+ *
+ * Copyright 2019, Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tdoa_replay.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tdoa_replay.c. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Host side replay of TDoA3 packet traces through the firmware TDoA engine
+(tdoaEngine, tdoaStorage, tdoaStats and clockCorrectionEngine), reporting
+engine statistics, processing throughput and the emitted measurements.
+
+  tdoa_replay [-m maxPairs] [-b loops] [-o measurements.csv] trace
+  tdoa_replay -g anchors [-l layout] [-t seconds] [-f rate] [-r range]
+              [-p loss] [-n noise] [-S seed] [-w trace] [-m maxPairs] [-b loops] [-o measurements.csv]
+
+Trace format, one event per line, '#' starts a comment:
+
+  A <id> <x> <y> <z>
+      Anchor layout, only used by the synthetic generator (-l)
+  T <time_ms> <x> <y> <z>
+      True tag position, used to compute the error of emitted measurements
+  P <time_ms> <anchorId> <seq> <txTime> <rxTime> <remoteCount>
+    [<remoteId> <remoteSeq> <remoteRxTime> <tof>]... [<x> <y> <z>]
+      A TDoA3 packet from anchorId received at rxTime (tag clock, 40 bits).
+      txTime and remoteRxTime are in the anchor clock (32 bits), tof is in
+      anchor clock ticks (0 if not included). The anchor position is optional
+      and is handled as an LPP anchor position packet.
+
+The storage size and clock correction implementation are selected at build
+time, see the Makefile.
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tdoaEngine.h"
+#include "tdoaStats.h"
+#include "physicalConstants.h"
+
+#define LOCODECK_TS_FREQ (499.2e6 * 128)
+#define TAG_TIMESTAMP_MASK 0xFFFFFFFFFFull
+#define ANCHOR_TIMESTAMP_MASK 0xFFFFFFFFull
+
+// Synthetic traces start some time after boot, as a real flight would
+#define SYNTHETIC_START_TIME_MS 10000
+
+#define MAX_REMOTE_COUNT 8
+#define MAX_ANCHORS 256
+#define MAX_LINE_LENGTH 1024
+
+typedef struct {
+  uint8_t id;
+  uint8_t seq;
+  uint32_t rxTime;
+  uint16_t tof;
+} remoteData_t;
+
+typedef struct {
+  uint32_t time_ms;
+  uint8_t anchorId;
+  uint8_t seq;
+  uint32_t txTime;
+  uint64_t rxTime;
+  uint8_t remoteCount;
+  remoteData_t remote[MAX_REMOTE_COUNT];
+  bool hasPosition;
+  float position[3];
+} tracePacket_t;
+
+typedef struct {
+  uint32_t time_ms;
+  float position[3];
+} traceTagPosition_t;
+
+typedef struct {
+  tracePacket_t* packets;
+  int packetCount;
+  int packetCapacity;
+
+  traceTagPosition_t* tagPositions;
+  int tagPositionCount;
+  int tagPositionCapacity;
+} trace_t;
+
+typedef struct {
+  bool isUsed;
+  float position[3];
+} layoutAnchor_t;
+
+typedef struct {
+  // Synthetic trace generation
+  int anchorCount;
+  const char* layoutFile;
+  double duration_s;
+  double txRate_hz;
+  double range_m;
+  double packetLoss;
+  double noise_ns;
+  unsigned int seed;
+  const char* writeFile;
+
+  // Replay
+  int maxPairs;
+  int loops;
+  const char* outputFile;
+} options_t;
+
+// Replay state, the engine callback has no user data pointer
+static tdoaEngineState_t engineState;
+static FILE* measurementOutput;
+static const trace_t* replayTrace;
+static int tagPositionIndex;
+static uint32_t currentTime_ms;
+static uint32_t measurementCount;
+static double errorSum;
+static double errorSquareSum;
+static uint32_t errorCount;
+
+
+static void* growArray(void* array, int* capacity, const int count, const size_t elementSize) {
+  if (count < *capacity) {
+    return array;
+  }
+
+  *capacity = *capacity ? *capacity * 2 : 1024;
+  void* result = realloc(array, *capacity * elementSize);
+  if (!result) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  return result;
+}
+
+static void addPacket(trace_t* trace, const tracePacket_t* packet) {
+  trace->packets = growArray(trace->packets, &trace->packetCapacity, trace->packetCount, sizeof(tracePacket_t));
+  trace->packets[trace->packetCount++] = *packet;
+}
+
+static void addTagPosition(trace_t* trace, const uint32_t time_ms, const float position[3]) {
+  trace->tagPositions = growArray(trace->tagPositions, &trace->tagPositionCapacity, trace->tagPositionCount, sizeof(traceTagPosition_t));
+  traceTagPosition_t* tagPosition = &trace->tagPositions[trace->tagPositionCount++];
+  tagPosition->time_ms = time_ms;
+  memcpy(tagPosition->position, position, sizeof(tagPosition->position));
+}
+
+static bool parsePacket(char* line, tracePacket_t* packet) {
+  char* next = line;
+  unsigned long long rxTime;
+  unsigned int anchorId, seq, remoteCount;
+  unsigned long txTime, time_ms;
+  int consumed = 0;
+
+  if (sscanf(next, " %lu %u %u %lu %llu %u%n", &time_ms, &anchorId, &seq, &txTime, &rxTime, &remoteCount, &consumed) != 6) {
+    return false;
+  }
+  next += consumed;
+
+  if (remoteCount > MAX_REMOTE_COUNT) {
+    return false;
+  }
+
+  memset(packet, 0, sizeof(tracePacket_t));
+  packet->time_ms = time_ms;
+  packet->anchorId = anchorId;
+  packet->seq = seq;
+  packet->txTime = txTime;
+  packet->rxTime = rxTime & TAG_TIMESTAMP_MASK;
+  packet->remoteCount = remoteCount;
+
+  for (unsigned int i = 0; i < remoteCount; i++) {
+    unsigned int remoteId, remoteSeq, tof;
+    unsigned long remoteRxTime;
+    if (sscanf(next, " %u %u %lu %u%n", &remoteId, &remoteSeq, &remoteRxTime, &tof, &consumed) != 4) {
+      return false;
+    }
+    next += consumed;
+
+    packet->remote[i].id = remoteId;
+    packet->remote[i].seq = remoteSeq;
+    packet->remote[i].rxTime = remoteRxTime;
+    packet->remote[i].tof = tof;
+  }
+
+  float* p = packet->position;
+  packet->hasPosition = (sscanf(next, " %f %f %f", &p[0], &p[1], &p[2]) == 3);
+
+  return true;
+}
+
+static bool readTrace(const char* fileName, trace_t* trace, layoutAnchor_t layout[]) {
+  FILE* file = fopen(fileName, "r");
+  if (!file) {
+    perror(fileName);
+    return false;
+  }
+
+  char line[MAX_LINE_LENGTH];
+  int lineNr = 0;
+  while (fgets(line, sizeof(line), file)) {
+    lineNr++;
+
+    char* comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+
+    char type = '\0';
+    int consumed = 0;
+    if (sscanf(line, " %c%n", &type, &consumed) != 1) {
+      continue;
+    }
+
+    bool isOk = false;
+    float position[3];
+    unsigned long time_ms;
+    unsigned int id;
+    switch (type) {
+      case 'P':
+        {
+          tracePacket_t packet;
+          isOk = parsePacket(line + consumed, &packet);
+          if (isOk) {
+            addPacket(trace, &packet);
+          }
+        }
+        break;
+      case 'T':
+        isOk = (sscanf(line + consumed, " %lu %f %f %f", &time_ms, &position[0], &position[1], &position[2]) == 4);
+        if (isOk) {
+          addTagPosition(trace, time_ms, position);
+        }
+        break;
+      case 'A':
+        isOk = (sscanf(line + consumed, " %u %f %f %f", &id, &position[0], &position[1], &position[2]) == 4) && id < MAX_ANCHORS;
+        if (isOk && layout) {
+          layout[id].isUsed = true;
+          memcpy(layout[id].position, position, sizeof(position));
+        }
+        break;
+      default:
+        break;
+    }
+
+    if (!isOk) {
+      fprintf(stderr, "%s:%d: invalid line\n", fileName, lineNr);
+      fclose(file);
+      return false;
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+static bool writeTrace(const char* fileName, const trace_t* trace, const layoutAnchor_t layout[]) {
+  FILE* file = fopen(fileName, "w");
+  if (!file) {
+    perror(fileName);
+    return false;
+  }
+
+  fprintf(file, "# Synthetic TDoA3 trace\n");
+  for (int id = 0; id < MAX_ANCHORS; id++) {
+    if (layout[id].isUsed) {
+      fprintf(file, "A %d %.3f %.3f %.3f\n", id, layout[id].position[0], layout[id].position[1], layout[id].position[2]);
+    }
+  }
+
+  int tagIndex = 0;
+  for (int i = 0; i < trace->packetCount; i++) {
+    const tracePacket_t* packet = &trace->packets[i];
+
+    while (tagIndex < trace->tagPositionCount && trace->tagPositions[tagIndex].time_ms <= packet->time_ms) {
+      const traceTagPosition_t* tagPosition = &trace->tagPositions[tagIndex++];
+      fprintf(file, "T %u %.4f %.4f %.4f\n", tagPosition->time_ms, tagPosition->position[0], tagPosition->position[1], tagPosition->position[2]);
+    }
+
+    fprintf(file, "P %u %u %u %u %llu %u", packet->time_ms, packet->anchorId, packet->seq, packet->txTime, (unsigned long long)packet->rxTime, packet->remoteCount);
+    for (int r = 0; r < packet->remoteCount; r++) {
+      const remoteData_t* remote = &packet->remote[r];
+      fprintf(file, " %u %u %u %u", remote->id, remote->seq, remote->rxTime, remote->tof);
+    }
+    if (packet->hasPosition) {
+      fprintf(file, " %.3f %.3f %.3f", packet->position[0], packet->position[1], packet->position[2]);
+    }
+    fprintf(file, "\n");
+  }
+
+  fclose(file);
+  return true;
+}
+
+
+// Synthetic trace generation ////////////////
+
+typedef struct {
+  double clockOffset; // s
+  double clockDrift; // relative
+  uint8_t seq;
+  double nextTxTime; // s
+  uint32_t txCount;
+
+  // Latest packet received from other anchors
+  struct {
+    bool isValid;
+    uint8_t seq;
+    uint32_t rxTime;
+    double time;
+  } heard[MAX_ANCHORS];
+} simAnchor_t;
+
+static double uniform(void) {
+  return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+static double gaussian(void) {
+  // Box-Muller
+  const double u1 = uniform() + 1e-12;
+  const double u2 = uniform();
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double distance(const float a[3], const float b[3]) {
+  const double dx = a[0] - b[0];
+  const double dy = a[1] - b[1];
+  const double dz = a[2] - b[2];
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+static uint64_t clockTicks(const double time, const double clockOffset, const double clockDrift) {
+  return (uint64_t)llround((time + clockOffset) * LOCODECK_TS_FREQ * (1.0 + clockDrift));
+}
+
+static void gridLayout(layoutAnchor_t layout[], const int anchorCount) {
+  // Rows of 4 anchors, 4 m apart, alternating between floor and ceiling
+  for (int i = 0; i < anchorCount && i < MAX_ANCHORS; i++) {
+    layout[i].isUsed = true;
+    layout[i].position[0] = (i % 4) * 4.0f;
+    layout[i].position[1] = (i / 4) * 4.0f;
+    layout[i].position[2] = (i % 2) ? 2.7f : 0.3f;
+  }
+}
+
+static void tagPositionAt(const double time, const layoutAnchor_t layout[], float position[3]) {
+  // A loop over the area spanned by the anchors, about 1 m/s
+  float min[2] = {1e9f, 1e9f};
+  float max[2] = {-1e9f, -1e9f};
+  for (int id = 0; id < MAX_ANCHORS; id++) {
+    if (layout[id].isUsed) {
+      for (int axis = 0; axis < 2; axis++) {
+        min[axis] = fminf(min[axis], layout[id].position[axis]);
+        max[axis] = fmaxf(max[axis], layout[id].position[axis]);
+      }
+    }
+  }
+
+  const double rx = fmax((max[0] - min[0]) / 2.0 - 1.0, 0.5);
+  const double ry = fmax((max[1] - min[1]) / 2.0 - 1.0, 0.5);
+  const double omega = 1.0 / fmax(rx, ry);
+  position[0] = (min[0] + max[0]) / 2.0 + rx * cos(omega * time);
+  position[1] = (min[1] + max[1]) / 2.0 + ry * sin(omega * time);
+  position[2] = 1.5f;
+}
+
+static void generateTrace(const options_t* options, const layoutAnchor_t layout[], trace_t* trace) {
+  static simAnchor_t anchors[MAX_ANCHORS];
+  memset(anchors, 0, sizeof(anchors));
+  srand(options->seed);
+
+  const double tagClockOffset = uniform() * 10.0;
+  const double tagClockDrift = (uniform() - 0.5) * 20e-6;
+  const double txPeriod = 1.0 / options->txRate_hz;
+
+  for (int id = 0; id < MAX_ANCHORS; id++) {
+    anchors[id].clockOffset = uniform() * 10.0;
+    anchors[id].clockDrift = (uniform() - 0.5) * 20e-6;
+    anchors[id].seq = rand() & 0x7f;
+    anchors[id].nextTxTime = uniform() * txPeriod;
+  }
+
+  double nextTagPositionTime = 0.0;
+  while (true) {
+    // Next anchor to transmit
+    int txId = -1;
+    for (int id = 0; id < MAX_ANCHORS; id++) {
+      if (layout[id].isUsed && (txId < 0 || anchors[id].nextTxTime < anchors[txId].nextTxTime)) {
+        txId = id;
+      }
+    }
+    if (txId < 0) {
+      return;
+    }
+
+    simAnchor_t* anchor = &anchors[txId];
+    const double txTime = anchor->nextTxTime;
+    if (txTime > options->duration_s) {
+      return;
+    }
+
+    // Random TX times, +-10 %
+    anchor->nextTxTime += txPeriod * (0.9 + 0.2 * uniform());
+    anchor->seq = (anchor->seq + 1) & 0x7f;
+    anchor->txCount++;
+
+    float tagPosition[3];
+    tagPositionAt(txTime, layout, tagPosition);
+    while (nextTagPositionTime <= txTime) {
+      float position[3];
+      tagPositionAt(nextTagPositionTime, layout, position);
+      addTagPosition(trace, SYNTHETIC_START_TIME_MS + (uint32_t)(nextTagPositionTime * 1000.0), position);
+      nextTagPositionTime += 0.01;
+    }
+
+    tracePacket_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.anchorId = txId;
+    packet.seq = anchor->seq;
+    packet.txTime = clockTicks(txTime, anchor->clockOffset, anchor->clockDrift) & ANCHOR_TIMESTAMP_MASK;
+
+    // Remote data for the anchors heard since the previous transmission
+    for (int id = 0; id < MAX_ANCHORS && packet.remoteCount < MAX_REMOTE_COUNT; id++) {
+      if (anchor->heard[id].isValid && (txTime - anchor->heard[id].time) < 1.5 * txPeriod) {
+        remoteData_t* remote = &packet.remote[packet.remoteCount++];
+        remote->id = id;
+        remote->seq = anchor->heard[id].seq;
+        remote->rxTime = anchor->heard[id].rxTime;
+        remote->tof = (uint16_t)llround(distance(layout[txId].position, layout[id].position) / SPEED_OF_LIGHT * LOCODECK_TS_FREQ * (1.0 + anchor->clockDrift));
+      }
+    }
+
+    // Position in every 10th packet, as an LPP packet
+    if ((anchor->txCount % 10) == 1) {
+      packet.hasPosition = true;
+      memcpy(packet.position, layout[txId].position, sizeof(packet.position));
+    }
+
+    // Other anchors within range receive the packet
+    for (int id = 0; id < MAX_ANCHORS; id++) {
+      if (id != txId && layout[id].isUsed) {
+        const double d = distance(layout[txId].position, layout[id].position);
+        if (d < options->range_m && uniform() >= options->packetLoss) {
+          const double rxTime = txTime + d / SPEED_OF_LIGHT;
+          anchors[id].heard[txId].isValid = true;
+          anchors[id].heard[txId].seq = anchor->seq;
+          anchors[id].heard[txId].rxTime = clockTicks(rxTime, anchors[id].clockOffset, anchors[id].clockDrift) & ANCHOR_TIMESTAMP_MASK;
+          anchors[id].heard[txId].time = rxTime;
+        }
+      }
+    }
+
+    // The tag
+    const double d = distance(layout[txId].position, tagPosition);
+    if (d < options->range_m && uniform() >= options->packetLoss) {
+      const double rxTime = txTime + d / SPEED_OF_LIGHT + gaussian() * options->noise_ns * 1e-9;
+      packet.time_ms = SYNTHETIC_START_TIME_MS + (uint32_t)(rxTime * 1000.0);
+      packet.rxTime = clockTicks(rxTime, tagClockOffset, tagClockDrift) & TAG_TIMESTAMP_MASK;
+      addPacket(trace, &packet);
+    }
+  }
+}
+
+
+// Replay ////////////////
+
+static void sendTdoaToEstimator(tdoaMeasurement_t tdoaMeasurements[], const int count) {
+  // The true tag position, the latest one at the current time
+  const traceTagPosition_t* tagPosition = 0;
+  if (replayTrace->tagPositionCount > 0) {
+    while (tagPositionIndex + 1 < replayTrace->tagPositionCount && replayTrace->tagPositions[tagPositionIndex + 1].time_ms <= currentTime_ms) {
+      tagPositionIndex++;
+    }
+    tagPosition = &replayTrace->tagPositions[tagPositionIndex];
+  }
+
+  for (int i = 0; i < count; i++) {
+    const tdoaMeasurement_t* tdoa = &tdoaMeasurements[i];
+    measurementCount++;
+
+    double error = NAN;
+    if (tagPosition) {
+      const float p0[3] = {tdoa->anchorPosition[0].x, tdoa->anchorPosition[0].y, tdoa->anchorPosition[0].z};
+      const float p1[3] = {tdoa->anchorPosition[1].x, tdoa->anchorPosition[1].y, tdoa->anchorPosition[1].z};
+      const double expected = distance(tagPosition->position, p1) - distance(tagPosition->position, p0);
+      error = tdoa->distanceDiff - expected;
+
+      errorSum += error;
+      errorSquareSum += error * error;
+      errorCount++;
+    }
+
+    if (measurementOutput) {
+      fprintf(measurementOutput, "%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,%.4f\n", currentTime_ms,
+        (double)tdoa->anchorPosition[0].x, (double)tdoa->anchorPosition[0].y, (double)tdoa->anchorPosition[0].z,
+        (double)tdoa->anchorPosition[1].x, (double)tdoa->anchorPosition[1].y, (double)tdoa->anchorPosition[1].z,
+        (double)tdoa->distanceDiff, error);
+    }
+  }
+}
+
+static void processPacket(const tracePacket_t* packet) {
+  tdoaAnchorContext_t anchorCtx;
+  currentTime_ms = packet->time_ms;
+  engineState.stats.packetsReceived++;
+
+  // Same sequence as in the TDoA3 tag
+  tdoaEngineGetAnchorCtxForPacketProcessing(&engineState, packet->anchorId, packet->time_ms, &anchorCtx);
+
+  for (int i = 0; i < packet->remoteCount; i++) {
+    const remoteData_t* remote = &packet->remote[i];
+    if (remote->rxTime != 0) {
+      tdoaStorageSetRemoteRxTime(&anchorCtx, remote->id, remote->rxTime, remote->seq & 0x7f);
+    }
+    if (remote->tof != 0) {
+      tdoaStorageSetTimeOfFlight(&anchorCtx, remote->id, remote->tof);
+    }
+  }
+
+  tdoaEngineProcessPacket(&engineState, &anchorCtx, packet->txTime, packet->rxTime);
+  tdoaStorageSetRxTxData(&anchorCtx, packet->rxTime, packet->txTime, packet->seq);
+
+  if (packet->hasPosition) {
+    tdoaStorageSetAnchorPosition(&anchorCtx, packet->position[0], packet->position[1], packet->position[2]);
+  }
+}
+
+static double replay(const trace_t* trace, const options_t* options) {
+  replayTrace = trace;
+  tagPositionIndex = 0;
+  measurementCount = 0;
+  errorSum = errorSquareSum = 0.0;
+  errorCount = 0;
+
+  const uint32_t startTime_ms = trace->packetCount > 0 ? trace->packets[0].time_ms : 0;
+  tdoaEngineInit(&engineState, startTime_ms, sendTdoaToEstimator, LOCODECK_TS_FREQ);
+  engineState.maxPairsPerPacket = options->maxPairs;
+
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < trace->packetCount; i++) {
+    processPacket(&trace->packets[i]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  return (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+static void printReport(const trace_t* trace, const double processingTime_s, const options_t* options) {
+  const tdoaStats_t* stats = &engineState.stats;
+  const double packets = stats->packetsReceived > 0 ? stats->packetsReceived : 1;
+  const uint32_t firstTime_ms = trace->packetCount > 0 ? trace->packets[0].time_ms : 0;
+  const uint32_t lastTime_ms = trace->packetCount > 0 ? trace->packets[trace->packetCount - 1].time_ms : 0;
+  const double traceTime_s = (lastTime_ms - firstTime_ms) / 1000.0;
+
+  printf("Configuration\n");
+  printf("  anchor storage      %d anchors, %d remote, %d tof\n", ANCHOR_STORAGE_COUNT, REMOTE_ANCHOR_DATA_COUNT, TOF_PER_ANCHOR_COUNT);
+#ifdef CLOCK_CORRECTION_FIXED_POINT
+  printf("  clock correction    fixed point\n");
+#else
+  printf("  clock correction    double\n");
+#endif
+  printf("  max pairs/packet    %d\n", options->maxPairs);
+  printf("Trace\n");
+  printf("  packets             %u in %.1f s (%.0f packets/s)\n", stats->packetsReceived, traceTime_s, traceTime_s > 0 ? stats->packetsReceived / traceTime_s : 0.0);
+  printf("Engine\n");
+  printf("  context hit rate    %.1f %%\n", 100.0 * stats->contextHitCount / packets);
+  printf("  context miss rate   %.1f %%\n", 100.0 * stats->contextMissCount / packets);
+  printf("  time is good        %.1f %%\n", 100.0 * stats->timeIsGood / packets);
+  printf("  suitable data       %.1f %%\n", 100.0 * stats->suitableDataFound / packets);
+  printf("  pairs found         %u (%.2f per packet)\n", stats->pairsFound, stats->pairsFound / packets);
+  printf("  to estimator        %u (%.0f /s)\n", stats->packetsToEstimator, traceTime_s > 0 ? stats->packetsToEstimator / traceTime_s : 0.0);
+  if (errorCount > 0) {
+    const double mean = errorSum / errorCount;
+    printf("  tdoa error          mean %.4f m, std %.4f m\n", mean, sqrt(fmax(errorSquareSum / errorCount - mean * mean, 0.0)));
+  }
+  printf("Throughput (best of %d)\n", options->loops);
+  printf("  processing time     %.3f ms\n", processingTime_s * 1000.0);
+  printf("  packets/s           %.0f\n", stats->packetsReceived / processingTime_s);
+  printf("  us/packet           %.3f\n", processingTime_s * 1e6 / packets);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+    "Usage: %s [-m maxPairs] [-b loops] [-o measurements.csv] trace\n"
+    "       %s -g anchors [-l layout] [-t seconds] [-f rate] [-r range] [-p loss] [-n noise]\n"
+    "          [-S seed] [-w trace] [-m maxPairs] [-b loops] [-o measurements.csv]\n"
+    "  -m  max TDoA pairs per packet (default 1)\n"
+    "  -b  number of replays, the fastest is reported (default 10)\n"
+    "  -o  write emitted measurements as csv\n"
+    "  -g  generate a synthetic trace with anchors in a grid, 0 to use -l\n"
+    "  -l  anchor layout file, A lines in the trace format\n"
+    "  -t  trace duration in seconds (default 10)\n"
+    "  -f  TX rate per anchor in Hz (default 50)\n"
+    "  -r  radio range in m (default 10)\n"
+    "  -p  packet loss probability (default 0.05)\n"
+    "  -n  tag RX time noise in ns (default 0.1)\n"
+    "  -S  random seed (default 1)\n"
+    "  -w  write the synthetic trace\n", name, name);
+}
+
+int main(int argc, char* argv[]) {
+  options_t options = {
+    .anchorCount = -1,
+    .duration_s = 10.0,
+    .txRate_hz = 50.0,
+    .range_m = 10.0,
+    .packetLoss = 0.05,
+    .noise_ns = 0.1,
+    .seed = 1,
+    .maxPairs = 1,
+    .loops = 10,
+  };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "m:b:o:g:l:t:f:r:p:n:S:w:h")) != -1) {
+    switch (opt) {
+      case 'm': options.maxPairs = atoi(optarg); break;
+      case 'b': options.loops = atoi(optarg); break;
+      case 'o': options.outputFile = optarg; break;
+      case 'g': options.anchorCount = atoi(optarg); break;
+      case 'l': options.layoutFile = optarg; break;
+      case 't': options.duration_s = atof(optarg); break;
+      case 'f': options.txRate_hz = atof(optarg); break;
+      case 'r': options.range_m = atof(optarg); break;
+      case 'p': options.packetLoss = atof(optarg); break;
+      case 'n': options.noise_ns = atof(optarg); break;
+      case 'S': options.seed = strtoul(optarg, 0, 0); break;
+      case 'w': options.writeFile = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (options.loops < 1 || options.txRate_hz <= 0.0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  trace_t trace;
+  memset(&trace, 0, sizeof(trace));
+  static layoutAnchor_t layout[MAX_ANCHORS];
+
+  if (options.anchorCount >= 0) {
+    if (options.layoutFile) {
+      trace_t layoutTrace;
+      memset(&layoutTrace, 0, sizeof(layoutTrace));
+      if (!readTrace(options.layoutFile, &layoutTrace, layout)) {
+        return 1;
+      }
+    } else {
+      gridLayout(layout, options.anchorCount);
+    }
+
+    generateTrace(&options, layout, &trace);
+    if (options.writeFile && !writeTrace(options.writeFile, &trace, layout)) {
+      return 1;
+    }
+  } else {
+    if (optind >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (!readTrace(argv[optind], &trace, 0)) {
+      return 1;
+    }
+  }
+
+  // Warm up and find the best processing time, the output is only written once
+  double bestTime_s = INFINITY;
+  for (int loop = 0; loop < options.loops; loop++) {
+    bestTime_s = fmin(bestTime_s, replay(&trace, &options));
+  }
+
+  if (options.outputFile) {
+    measurementOutput = fopen(options.outputFile, "w");
+    if (!measurementOutput) {
+      perror(options.outputFile);
+      return 1;
+    }
+    fprintf(measurementOutput, "time_ms,x0,y0,z0,x1,y1,z1,distanceDiff,error\n");
+  }
+
+  // Final replay for the statistics and measurement output
+  replay(&trace, &options);
+  if (measurementOutput) {
+    fclose(measurementOutput);
+  }
+
+  printReport(&trace, bestTime_s, &options);
+
+  free(trace.packets);
+  free(trace.tagPositions);
+  return 0;
+}
@@ -0,0 +1,71 @@
+# -*- coding: utf-8 -*-
+"""
+decode: native decoder for binary logged sensor data from crazyflie2 with
+uSD-Card-Deck. Drop in replacement for CF_functions.decode, backed by
+libusdlog (build with make in this directory).
+"""
+import ctypes
+import os
+
+import numpy as np
+
+_lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                'libusdlog.so'))
+
+_lib.usdlogOpen.restype = ctypes.c_void_p
+_lib.usdlogOpen.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+_lib.usdlogClose.argtypes = [ctypes.c_void_p]
+_lib.usdlogGetColumnCount.restype = ctypes.c_int
+_lib.usdlogGetColumnCount.argtypes = [ctypes.c_void_p]
+_lib.usdlogGetColumnName.restype = ctypes.c_char_p
+_lib.usdlogGetColumnName.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.usdlogIsHeaderCrcOk.restype = ctypes.c_bool
+_lib.usdlogIsHeaderCrcOk.argtypes = [ctypes.c_void_p]
+_lib.usdlogCountRecords.restype = ctypes.c_size_t
+_lib.usdlogCountRecords.argtypes = [ctypes.c_void_p]
+_lib.usdlogDecodeColumns.restype = ctypes.c_size_t
+_lib.usdlogDecodeColumns.argtypes = [ctypes.c_void_p,
+                                     ctypes.POINTER(ctypes.c_void_p),
+                                     ctypes.c_size_t, ctypes.c_bool]
+_lib.usdlogGetCrcErrorCount.restype = ctypes.c_uint32
+_lib.usdlogGetCrcErrorCount.argtypes = [ctypes.c_void_p]
+_lib.usdlogStatusToString.restype = ctypes.c_char_p
+_lib.usdlogStatusToString.argtypes = [ctypes.c_int]
+
+
+def decode(filName, dropCorrupt=False, verbose=True):
+    status = ctypes.c_int(0)
+    log = _lib.usdlogOpen(os.fsencode(filName), ctypes.byref(status))
+    if not log:
+        raise IOError("{0}: {1}".format(
+            filName, _lib.usdlogStatusToString(status.value).decode()))
+
+    try:
+        if verbose:
+            print("[CRC] of file header:", end="")
+            print("\tOK" if _lib.usdlogIsHeaderCrcOk(log) else "\tERROR")
+
+        width = _lib.usdlogGetColumnCount(log)
+        names = [_lib.usdlogGetColumnName(log, ii).decode("utf-8").strip()
+                 for ii in range(width)]
+
+        # all columns in one block, same layout as CF_functions.decode
+        capacity = _lib.usdlogCountRecords(log)
+        setCon = np.zeros((width, capacity))
+        pointers = (ctypes.c_void_p * width)(
+            *[setCon[ii].ctypes.data for ii in range(width)])
+        rows = _lib.usdlogDecodeColumns(log, pointers, capacity, dropCorrupt)
+
+        crcErrors = _lib.usdlogGetCrcErrorCount(log)
+        if verbose:
+            if not crcErrors:
+                print("[CRC] no errors occurred:\tOK")
+            else:
+                print("[CRC] {0} errors occurred:\tERROR".format(crcErrors))
+    finally:
+        _lib.usdlogClose(log)
+
+    output = {}
+    for ii in range(width):
+        output[names[ii]] = setCon[ii, :rows]
+    return output
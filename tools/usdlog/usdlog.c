@@ -0,0 +1,576 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie firmware.
+ *
+ * Copyright 2019, Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * usdlog.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with usdlog.c. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "usdlog.h"
+
+#define CRC_SIZE 4
+#define BATCH_HEADER_SIZE 1
+#define MAX_COLUMNS 255
+
+// Size of the write buffer used per column when writing columnar files
+#define COLUMN_BUFFER_SIZE (64 * 1024)
+
+#define COLUMNAR_MAGIC "CFUL"
+#define COLUMNAR_VERSION 1
+
+struct usdlog_s {
+  int fd;
+  const uint8_t* data;
+  size_t size;
+
+  int columnCount;
+  usdlogColumn_t columns[MAX_COLUMNS];
+  size_t recordSize;
+  size_t dataStart;
+  bool headerCrcOk;
+
+  uint32_t crcErrorCount;
+  bool truncated;
+};
+
+static uint32_t crcTable[256];
+static bool crcTableIsInitialized = false;
+
+static void crcTableInit() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t remainder = i;
+    for (int bit = 0; bit < 8; bit++) {
+      remainder = (remainder & 1) ? (remainder >> 1) ^ 0xEDB88320 : (remainder >> 1);
+    }
+    crcTable[i] = remainder;
+  }
+
+  crcTableIsInitialized = true;
+}
+
+// The firmware appends the crc register, which means that the register is
+// zero after running the crc over a block including its crc.
+static bool isCrcOk(const uint8_t* data, size_t length) {
+  uint32_t remainder = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    remainder = crcTable[(remainder ^ data[i]) & 0xff] ^ (remainder >> 8);
+  }
+
+  return remainder == 0;
+}
+
+static int typeSize(char type) {
+  switch (type) {
+    case 'b':
+    case 'B':
+      return 1;
+    case 'h':
+    case 'H':
+      return 2;
+    case 'i':
+    case 'I':
+    case 'f':
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+static usdlogStatus_t parseHeader(usdlog_t* log) {
+  if (log->size < BATCH_HEADER_SIZE + CRC_SIZE) {
+    return usdlogErrorFormat;
+  }
+
+  log->columnCount = log->data[0];
+  log->recordSize = 0;
+
+  size_t idx = 1;
+  for (int i = 0; i < log->columnCount; i++) {
+    const size_t start = idx;
+    while (idx < log->size && log->data[idx] != ',') {
+      idx++;
+    }
+    if (idx >= log->size) {
+      return usdlogErrorFormat;
+    }
+
+    // "group.name(T)"
+    const size_t length = idx - start;
+    const char* entry = (const char*)&log->data[start];
+    if (length < 4 || entry[length - 3] != '(' || entry[length - 1] != ')') {
+      return usdlogErrorFormat;
+    }
+
+    usdlogColumn_t* column = &log->columns[i];
+    const size_t nameLength = length - 3;
+    if (nameLength >= USDLOG_MAX_NAME_LENGTH) {
+      return usdlogErrorFormat;
+    }
+    memcpy(column->name, entry, nameLength);
+    column->name[nameLength] = '\0';
+
+    column->type = entry[length - 2];
+    column->size = typeSize(column->type);
+    if (column->size == 0) {
+      return usdlogErrorFormat;
+    }
+    column->offset = log->recordSize;
+    log->recordSize += column->size;
+
+    idx++;
+  }
+
+  if (idx + CRC_SIZE > log->size) {
+    return usdlogErrorFormat;
+  }
+
+  log->headerCrcOk = isCrcOk(log->data, idx + CRC_SIZE);
+  log->dataStart = idx + CRC_SIZE;
+
+  return usdlogOk;
+}
+
+usdlog_t* usdlogOpen(const char* fileName, usdlogStatus_t* status) {
+  usdlogStatus_t result = usdlogOk;
+
+  if (!crcTableIsInitialized) {
+    crcTableInit();
+  }
+
+  usdlog_t* log = calloc(1, sizeof(usdlog_t));
+  if (!log) {
+    result = usdlogErrorMemory;
+    goto fail;
+  }
+  log->fd = open(fileName, O_RDONLY);
+  if (log->fd < 0) {
+    result = usdlogErrorOpen;
+    goto fail;
+  }
+
+  struct stat info;
+  if (fstat(log->fd, &info) != 0) {
+    result = usdlogErrorIo;
+    goto fail;
+  }
+  log->size = info.st_size;
+
+  if (log->size > 0) {
+    void* data = mmap(NULL, log->size, PROT_READ, MAP_PRIVATE, log->fd, 0);
+    if (data == MAP_FAILED) {
+      result = usdlogErrorIo;
+      goto fail;
+    }
+    log->data = data;
+    madvise(data, log->size, MADV_SEQUENTIAL);
+  }
+
+  result = parseHeader(log);
+  if (result != usdlogOk) {
+    goto fail;
+  }
+
+  if (status) {
+    *status = usdlogOk;
+  }
+  return log;
+
+fail:
+  usdlogClose(log);
+  if (status) {
+    *status = result;
+  }
+  return NULL;
+}
+
+void usdlogClose(usdlog_t* log) {
+  if (!log) {
+    return;
+  }
+
+  if (log->data) {
+    munmap((void*)log->data, log->size);
+  }
+  if (log->fd >= 0) {
+    close(log->fd);
+  }
+  free(log);
+}
+
+int usdlogGetColumnCount(const usdlog_t* log) {
+  return log->columnCount;
+}
+
+const usdlogColumn_t* usdlogGetColumn(const usdlog_t* log, int column) {
+  return &log->columns[column];
+}
+
+const char* usdlogGetColumnName(const usdlog_t* log, int column) {
+  return log->columns[column].name;
+}
+
+char usdlogGetColumnType(const usdlog_t* log, int column) {
+  return log->columns[column].type;
+}
+
+size_t usdlogGetRecordSize(const usdlog_t* log) {
+  return log->recordSize;
+}
+
+bool usdlogIsHeaderCrcOk(const usdlog_t* log) {
+  return log->headerCrcOk;
+}
+
+uint32_t usdlogGetCrcErrorCount(const usdlog_t* log) {
+  return log->crcErrorCount;
+}
+
+bool usdlogIsTruncated(const usdlog_t* log) {
+  return log->truncated;
+}
+
+static size_t batchSize(const usdlog_t* log, uint8_t count) {
+  return BATCH_HEADER_SIZE + count * log->recordSize + CRC_SIZE;
+}
+
+size_t usdlogCountRecords(usdlog_t* log) {
+  size_t records = 0;
+  size_t offset = log->dataStart;
+
+  while (offset < log->size) {
+    const uint8_t count = log->data[offset];
+    const size_t size = batchSize(log, count);
+    if (offset + size > log->size) {
+      break;
+    }
+
+    records += count;
+    offset += size;
+  }
+
+  return records;
+}
+
+uint32_t usdlogForEachBatch(usdlog_t* log, usdlogBatchCallback_t callback, void* arg) {
+  uint32_t batches = 0;
+  size_t offset = log->dataStart;
+
+  log->crcErrorCount = 0;
+  log->truncated = false;
+
+  while (offset < log->size) {
+    const uint8_t count = log->data[offset];
+    const size_t size = batchSize(log, count);
+    if (offset + size > log->size) {
+      // The last batch is incomplete, typically power was lost while writing
+      log->truncated = true;
+      break;
+    }
+
+    const bool crcOk = isCrcOk(&log->data[offset], size);
+    if (!crcOk) {
+      log->crcErrorCount++;
+    }
+
+    callback(log, &log->data[offset + BATCH_HEADER_SIZE], count, crcOk, arg);
+
+    batches++;
+    offset += size;
+  }
+
+  return batches;
+}
+
+double usdlogGetValue(const usdlog_t* log, const uint8_t* record, int column) {
+  const usdlogColumn_t* col = &log->columns[column];
+  const uint8_t* src = record + col->offset;
+
+  // The log is little endian, as are all hosts we care about
+  switch (col->type) {
+    case 'b': { int8_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'B': { uint8_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'h': { int16_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'H': { uint16_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'i': { int32_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'I': { uint32_t v; memcpy(&v, src, sizeof(v)); return v; }
+    case 'f': { float v; memcpy(&v, src, sizeof(v)); return v; }
+    default:
+      return 0.0;
+  }
+}
+
+
+typedef struct {
+  double** columns;
+  size_t capacity;
+  size_t rows;
+  bool dropCorrupt;
+} decodeContext_t;
+
+static void decodeBatch(const usdlog_t* log, const uint8_t* records, uint32_t count, bool crcOk, void* arg) {
+  decodeContext_t* ctx = arg;
+
+  if (!crcOk && ctx->dropCorrupt) {
+    return;
+  }
+
+  for (uint32_t r = 0; r < count && ctx->rows < ctx->capacity; r++) {
+    const uint8_t* record = records + r * log->recordSize;
+    for (int c = 0; c < log->columnCount; c++) {
+      ctx->columns[c][ctx->rows] = usdlogGetValue(log, record, c);
+    }
+    ctx->rows++;
+  }
+}
+
+size_t usdlogDecodeColumns(usdlog_t* log, double* columns[], size_t capacity, bool dropCorrupt) {
+  decodeContext_t ctx = {
+    .columns = columns,
+    .capacity = capacity,
+    .rows = 0,
+    .dropCorrupt = dropCorrupt,
+  };
+
+  usdlogForEachBatch(log, decodeBatch, &ctx);
+  return ctx.rows;
+}
+
+
+typedef struct {
+  FILE* file;
+  bool dropCorrupt;
+} csvContext_t;
+
+static void writeCsvBatch(const usdlog_t* log, const uint8_t* records, uint32_t count, bool crcOk, void* arg) {
+  csvContext_t* ctx = arg;
+
+  if (!crcOk && ctx->dropCorrupt) {
+    return;
+  }
+
+  for (uint32_t r = 0; r < count; r++) {
+    const uint8_t* record = records + r * log->recordSize;
+    for (int c = 0; c < log->columnCount; c++) {
+      const double value = usdlogGetValue(log, record, c);
+      const char separator = (c == log->columnCount - 1) ? '\n' : ',';
+      if (log->columns[c].type == 'f') {
+        fprintf(ctx->file, "%.9g%c", value, separator);
+      } else {
+        fprintf(ctx->file, "%.0f%c", value, separator);
+      }
+    }
+  }
+}
+
+usdlogStatus_t usdlogWriteCsv(usdlog_t* log, const char* fileName, bool dropCorrupt) {
+  csvContext_t ctx = {
+    .dropCorrupt = dropCorrupt,
+  };
+
+  ctx.file = strcmp(fileName, "-") == 0 ? stdout : fopen(fileName, "w");
+  if (!ctx.file) {
+    return usdlogErrorOpen;
+  }
+  setvbuf(ctx.file, NULL, _IOFBF, COLUMN_BUFFER_SIZE);
+
+  for (int c = 0; c < log->columnCount; c++) {
+    fprintf(ctx.file, "%s%c", log->columns[c].name, (c == log->columnCount - 1) ? '\n' : ',');
+  }
+
+  usdlogForEachBatch(log, writeCsvBatch, &ctx);
+
+  bool ok = !ferror(ctx.file);
+  if (ctx.file == stdout) {
+    ok = (fflush(ctx.file) == 0) && ok;
+  } else {
+    ok = (fclose(ctx.file) == 0) && ok;
+  }
+
+  return ok ? usdlogOk : usdlogErrorIo;
+}
+
+
+/*
+Columnar file layout (little endian):
+  char[4] magic "CFUL", uint8 version, uint8 columnCount, uint16 reserved,
+  uint64 rowCount,
+  per column: uint8 type, uint8 nameLength, char[nameLength] name
+  per column: rowCount values of the column type, in column order
+The raw log values are copied without conversion.
+*/
+
+typedef struct {
+  int fd;
+  bool dropCorrupt;
+  bool ioError;
+  off_t fileOffset[MAX_COLUMNS];
+  uint8_t* buffer[MAX_COLUMNS];
+  size_t fill[MAX_COLUMNS];
+} columnarContext_t;
+
+static void flushColumn(columnarContext_t* ctx, int c) {
+  if (ctx->fill[c] == 0) {
+    return;
+  }
+
+  ssize_t written = pwrite(ctx->fd, ctx->buffer[c], ctx->fill[c], ctx->fileOffset[c]);
+  if (written != (ssize_t)ctx->fill[c]) {
+    ctx->ioError = true;
+  }
+
+  ctx->fileOffset[c] += ctx->fill[c];
+  ctx->fill[c] = 0;
+}
+
+static void writeColumnarBatch(const usdlog_t* log, const uint8_t* records, uint32_t count, bool crcOk, void* arg) {
+  columnarContext_t* ctx = arg;
+
+  if (!crcOk && ctx->dropCorrupt) {
+    return;
+  }
+
+  for (uint32_t r = 0; r < count; r++) {
+    const uint8_t* record = records + r * log->recordSize;
+    for (int c = 0; c < log->columnCount; c++) {
+      const usdlogColumn_t* col = &log->columns[c];
+      if (ctx->fill[c] + col->size > COLUMN_BUFFER_SIZE) {
+        flushColumn(ctx, c);
+      }
+      memcpy(&ctx->buffer[c][ctx->fill[c]], record + col->offset, col->size);
+      ctx->fill[c] += col->size;
+    }
+  }
+}
+
+static void countValidBatch(const usdlog_t* log, const uint8_t* records, uint32_t count, bool crcOk, void* arg) {
+  if (crcOk) {
+    *(size_t*)arg += count;
+  }
+}
+
+usdlogStatus_t usdlogWriteColumnar(usdlog_t* log, const char* fileName, bool dropCorrupt) {
+  usdlogStatus_t result = usdlogOk;
+
+  // Without dropping batches the row count is given by the batch headers
+  // alone, otherwise the crcs must be checked first.
+  uint64_t rowCount = 0;
+  if (dropCorrupt) {
+    size_t validRows = 0;
+    usdlogForEachBatch(log, countValidBatch, &validRows);
+    rowCount = validRows;
+  } else {
+    rowCount = usdlogCountRecords(log);
+  }
+
+  columnarContext_t* ctx = calloc(1, sizeof(columnarContext_t));
+  if (!ctx) {
+    return usdlogErrorMemory;
+  }
+  ctx->dropCorrupt = dropCorrupt;
+
+  ctx->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (ctx->fd < 0) {
+    free(ctx);
+    return usdlogErrorOpen;
+  }
+
+  uint8_t header[16] = COLUMNAR_MAGIC;
+  header[4] = COLUMNAR_VERSION;
+  header[5] = log->columnCount;
+  for (int i = 0; i < 8; i++) {
+    header[8 + i] = (rowCount >> (8 * i)) & 0xff;
+  }
+  off_t offset = 0;
+  if (pwrite(ctx->fd, header, sizeof(header), offset) != sizeof(header)) {
+    ctx->ioError = true;
+  }
+  offset += sizeof(header);
+
+  for (int c = 0; c < log->columnCount; c++) {
+    const usdlogColumn_t* col = &log->columns[c];
+    uint8_t description[2 + USDLOG_MAX_NAME_LENGTH];
+    const size_t nameLength = strlen(col->name);
+    description[0] = col->type;
+    description[1] = nameLength;
+    memcpy(&description[2], col->name, nameLength);
+    if (pwrite(ctx->fd, description, 2 + nameLength, offset) != (ssize_t)(2 + nameLength)) {
+      ctx->ioError = true;
+    }
+    offset += 2 + nameLength;
+  }
+
+  for (int c = 0; c < log->columnCount; c++) {
+    ctx->fileOffset[c] = offset;
+    offset += rowCount * log->columns[c].size;
+
+    ctx->buffer[c] = malloc(COLUMN_BUFFER_SIZE);
+    if (!ctx->buffer[c]) {
+      result = usdlogErrorMemory;
+      goto done;
+    }
+  }
+
+  usdlogForEachBatch(log, writeColumnarBatch, ctx);
+  for (int c = 0; c < log->columnCount; c++) {
+    flushColumn(ctx, c);
+  }
+
+  if (ctx->ioError) {
+    result = usdlogErrorIo;
+  }
+
+done:
+  for (int c = 0; c < log->columnCount; c++) {
+    free(ctx->buffer[c]);
+  }
+  if (close(ctx->fd) != 0 && result == usdlogOk) {
+    result = usdlogErrorIo;
+  }
+  free(ctx);
+
+  return result;
+}
+
+const char* usdlogStatusToString(usdlogStatus_t status) {
+  switch (status) {
+    case usdlogOk:
+      return "ok";
+    case usdlogErrorOpen:
+      return "could not open file";
+    case usdlogErrorFormat:
+      return "invalid file header";
+    case usdlogErrorMemory:
+      return "out of memory";
+    case usdlogErrorIo:
+      return "i/o error";
+    default:
+      return "unknown error";
+  }
+}
@@ -0,0 +1,105 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie firmware.
+ *
+ * Copyright 2019, Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * usdlog.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with usdlog.h. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Host side decoder for the binary log files written by the uSD-card deck
+(usdWriteTask in usddeck.c).
+
+File layout (all values little endian):
+  header: uint8 width, width * "group.name(T),", uint32 crc
+  batch:  uint8 n, n * (uint32 tick + values), uint32 crc
+The type character T is a python struct format character. The crc is a
+CRC-32 over the block such that the crc of the block including the trailing
+crc bytes equals 0xffffffff.
+
+The file is memory mapped and decoded in a single streaming pass. Records
+have a fixed layout derived from the header so no per record parsing is
+needed.
+*/
+
+#ifndef __USDLOG_H__
+#define __USDLOG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define USDLOG_MAX_NAME_LENGTH 64
+
+typedef enum {
+  usdlogOk = 0,
+  usdlogErrorOpen,
+  usdlogErrorFormat,
+  usdlogErrorMemory,
+  usdlogErrorIo,
+} usdlogStatus_t;
+
+typedef struct {
+  char name[USDLOG_MAX_NAME_LENGTH]; // "group.name", type suffix removed
+  char type; // python struct format character
+  uint8_t size; // size in bytes
+  uint16_t offset; // offset from start of record
+} usdlogColumn_t;
+
+typedef struct usdlog_s usdlog_t;
+
+// Called once per batch with a pointer to the first record of the batch.
+// Records are recordSize bytes apart and are not aligned.
+typedef void (*usdlogBatchCallback_t)(const usdlog_t* log, const uint8_t* records, uint32_t count, bool crcOk, void* arg);
+
+usdlog_t* usdlogOpen(const char* fileName, usdlogStatus_t* status);
+void usdlogClose(usdlog_t* log);
+
+int usdlogGetColumnCount(const usdlog_t* log);
+const usdlogColumn_t* usdlogGetColumn(const usdlog_t* log, int column);
+const char* usdlogGetColumnName(const usdlog_t* log, int column);
+char usdlogGetColumnType(const usdlog_t* log, int column);
+size_t usdlogGetRecordSize(const usdlog_t* log);
+bool usdlogIsHeaderCrcOk(const usdlog_t* log);
+
+// Walks the batch headers only, without touching record data
+size_t usdlogCountRecords(usdlog_t* log);
+
+// Single pass over all batches, validating the crc of each batch.
+// Returns the number of batches.
+uint32_t usdlogForEachBatch(usdlog_t* log, usdlogBatchCallback_t callback, void* arg);
+
+// Statistics from the last pass
+uint32_t usdlogGetCrcErrorCount(const usdlog_t* log);
+bool usdlogIsTruncated(const usdlog_t* log);
+
+double usdlogGetValue(const usdlog_t* log, const uint8_t* record, int column);
+
+// Decode all records into one double array per column, each with room for
+// capacity rows. Batches with crc errors are skipped if dropCorrupt is set.
+// Returns the number of rows written.
+size_t usdlogDecodeColumns(usdlog_t* log, double* columns[], size_t capacity, bool dropCorrupt);
+
+usdlogStatus_t usdlogWriteCsv(usdlog_t* log, const char* fileName, bool dropCorrupt);
+usdlogStatus_t usdlogWriteColumnar(usdlog_t* log, const char* fileName, bool dropCorrupt);
+
+const char* usdlogStatusToString(usdlogStatus_t status);
+
+#endif // __USDLOG_H__
@@ -0,0 +1,117 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie firmware.
+ *
+ * Copyright 2019, Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * usdlog_convert.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with usdlog_convert.c. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Command line converter for uSD-card deck log files.
+
+  usdlog_convert [-f csv|columnar] [-d] [-q] [-o output] log
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "usdlog.h"
+
+static void usage(const char* name) {
+  fprintf(stderr, "Usage: %s [-f csv|columnar] [-d] [-q] [-o output] log\n", name);
+  fprintf(stderr, "  -f  output format, default csv\n");
+  fprintf(stderr, "  -d  drop batches with crc errors\n");
+  fprintf(stderr, "  -q  do not print the crc summary\n");
+  fprintf(stderr, "  -o  output file, default stdout for csv\n");
+}
+
+int main(int argc, char* argv[]) {
+  const char* format = "csv";
+  const char* output = NULL;
+  bool dropCorrupt = false;
+  bool quiet = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "f:o:dqh")) != -1) {
+    switch (opt) {
+      case 'f':
+        format = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'd':
+        dropCorrupt = true;
+        break;
+      case 'q':
+        quiet = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  usdlogStatus_t status;
+  usdlog_t* log = usdlogOpen(argv[optind], &status);
+  if (!log) {
+    fprintf(stderr, "%s: %s\n", argv[optind], usdlogStatusToString(status));
+    return 1;
+  }
+
+  if (strcmp(format, "csv") == 0) {
+    status = usdlogWriteCsv(log, output ? output : "-", dropCorrupt);
+  } else if (strcmp(format, "columnar") == 0) {
+    if (!output) {
+      fprintf(stderr, "Columnar output requires -o\n");
+      usdlogClose(log);
+      return 2;
+    }
+    status = usdlogWriteColumnar(log, output, dropCorrupt);
+  } else {
+    usage(argv[0]);
+    usdlogClose(log);
+    return 2;
+  }
+
+  if (status != usdlogOk) {
+    fprintf(stderr, "%s: %s\n", output ? output : "stdout", usdlogStatusToString(status));
+  }
+
+  if (!quiet) {
+    fprintf(stderr, "[CRC] of file header:\t%s\n", usdlogIsHeaderCrcOk(log) ? "OK" : "ERROR");
+    fprintf(stderr, "[CRC] %u errors occurred:\t%s\n", usdlogGetCrcErrorCount(log), usdlogGetCrcErrorCount(log) ? "ERROR" : "OK");
+    if (usdlogIsTruncated(log)) {
+      fprintf(stderr, "Incomplete last batch ignored\n");
+    }
+  }
+
+  usdlogClose(log);
+  return status == usdlogOk ? 0 : 1;
+}